@@ -0,0 +1,407 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ECompactGraph.h: Graph storage specialised at compile time through a traits struct.
+// Nodes and connections are plain structs stored by value in arrays, without vtable pointers or heap allocations per element.
+// The connections of all nodes are arcs in one array (like GraphCSR), the arcs of node i are [GetFirstArc(i), GetLastArc(i)).
+// Colors are only needed to render the graph and live in side arrays that stay empty until a color is set.
+// Removed nodes keep their index and are flagged invalid, like in IGraph. Searches run on a GraphCSR built from it
+// (GraphCSR(compactGraph, nodePos)), with AStarSearch.
+//
+// The traits define:
+//	NodeData		payload per node (a struct, can be empty)
+//	ConnectionData	payload per connection (a struct, can be empty, costs no memory then)
+//	CostType		float or FixedCost16<fractionBits>
+// With an empty ConnectionData an arc is 8 bytes: a 32 bit target and the cost (padded when the cost is 16 bits).
+/*=============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+#include "EGraphCSR.h"
+
+namespace Elite
+{
+	// Unsigned 16 bit fixed point cost: cost = value / 2^T_FractionBits, costs out of range are clamped
+	// With 8 fraction bits costs go from 0 to 255.99 in steps of 1/256
+	template<int T_FractionBits>
+	struct FixedCost16
+	{
+		uint16_t value;
+	};
+
+	// Conversion of the stored cost to and from float
+	template<class T_CostType>
+	struct CostConverter;
+
+	template<>
+	struct CostConverter<float>
+	{
+		static float ToFloat(float cost) { return cost; }
+		static float FromFloat(float cost) { return cost; }
+	};
+
+	template<int T_FractionBits>
+	struct CostConverter<FixedCost16<T_FractionBits>>
+	{
+		static float ToFloat(FixedCost16<T_FractionBits> cost) { return float(cost.value) / float(1 << T_FractionBits); }
+		static FixedCost16<T_FractionBits> FromFloat(float cost)
+		{
+			const float value = Clamp(cost * float(1 << T_FractionBits) + 0.5f, 0.f, 65535.f);
+			return FixedCost16<T_FractionBits>{ uint16_t(value) };
+		}
+	};
+
+	// Float costs without payloads
+	struct DefaultGraphTraits
+	{
+		struct NodeData {};
+		struct ConnectionData {};
+		typedef float CostType;
+	};
+
+	// Grid workloads: the terrain per cell and 16 bit costs
+	struct GridGraphTraits
+	{
+		struct NodeData
+		{
+			TerrainType terrain;
+		};
+		struct ConnectionData {};
+		typedef FixedCost16<8> CostType;
+	};
+
+	template<class T_Traits>
+	class CompactGraph final
+	{
+	public:
+		typedef typename T_Traits::NodeData NodeData;
+		typedef typename T_Traits::ConnectionData ConnectionData;
+		typedef typename T_Traits::CostType CostType;
+
+		static_assert(std::is_trivially_copyable<NodeData>::value, "CompactGraph: NodeData has to be a plain struct");
+		static_assert(std::is_trivially_copyable<ConnectionData>::value, "CompactGraph: ConnectionData has to be a plain struct");
+
+		explicit CompactGraph(bool isDirectionalGraph);
+
+		// Topology: nodes and connections are added first, Build lays them out
+		int AddNode(const NodeData& data = NodeData{});
+		// An undirected connection is stored in both directions
+		void AddConnection(int from, int to, float cost, const ConnectionData& data = ConnectionData{});
+		// The node stays in place as an invalid node, its arcs and the arcs to it are dropped by the next Build
+		void RemoveNode(int idx);
+		// The arcs of a node keep the order in which the connections were added
+		void Build();
+		void Clear();
+
+		// Every node and every connection of the graph, converted with nodeFunc(T_NodeType*) -> NodeData and conFunc(T_ConnectionType*) -> ConnectionData
+		// Removed nodes are kept as invalid nodes (without arcs) so the node indices stay the same
+		template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator, typename T_NodeFunc, typename T_ConnectionFunc>
+		void BuildFrom(const IGraph<T_NodeType, T_ConnectionType, T_Allocator>& graph, T_NodeFunc nodeFunc, T_ConnectionFunc conFunc);
+
+		bool IsDirectionalGraph() const { return m_IsDirectionalGraph; }
+
+		// Nodes
+		int GetNrOfNodes() const { return int(m_Nodes.size()); }
+		int GetNrOfActiveNodes() const { return m_NrOfActiveNodes; }
+		bool IsNodeValid(int idx) const { return idx >= 0 && idx < GetNrOfNodes() && m_Valid[idx]; }
+		const NodeData& GetNodeData(int idx) const { return m_Nodes[idx]; }
+		NodeData& GetNodeData(int idx) { return m_Nodes[idx]; }
+		int GetDegree(int idx) const { return int(m_Offsets[idx + 1] - m_Offsets[idx]); }
+
+		// Arcs, only valid after Build
+		int GetNrOfArcs() const { return int(m_Arcs.size()); }
+		int GetFirstArc(int idx) const { return int(m_Offsets[idx]); }
+		int GetLastArc(int idx) const { return int(m_Offsets[idx + 1]); }
+		int GetArcTarget(int arc) const { return int(m_Arcs[arc].to); }
+		float GetArcCost(int arc) const { return CostConverter<CostType>::ToFloat(m_Arcs[arc].cost); }
+		void SetArcCost(int arc, float cost) { m_Arcs[arc].cost = CostConverter<CostType>::FromFloat(cost); }
+		const ConnectionData& GetArcData(int arc) const { return m_Arcs[arc]; }
+		ConnectionData& GetArcData(int arc) { return m_Arcs[arc]; }
+		// Linear search over the arcs of 'from', returns invalid_arc_index if there is no connection
+		int FindArc(int from, int to) const;
+
+		// Rendering data, DEFAULT_NODE_COLOR/DEFAULT_CONNECTION_COLOR until a color is set
+		bool HasColors() const { return !m_NodeColors.empty() || !m_ArcColors.empty(); }
+		Color GetNodeColor(int idx) const { return m_NodeColors.empty() ? DEFAULT_NODE_COLOR : m_NodeColors[idx]; }
+		void SetNodeColor(int idx, const Color& color);
+		Color GetArcColor(int arc) const { return m_ArcColors.empty() ? DEFAULT_CONNECTION_COLOR : m_ArcColors[arc]; }
+		void SetArcColor(int arc, const Color& color);
+		// Drops the side arrays
+		void ClearColors();
+
+		// Bytes in use by the nodes, arcs and colors (capacity not included)
+		size_t GetMemoryUsage() const;
+
+	private:
+		// The payload is a base, an empty ConnectionData takes no space
+		struct Arc : ConnectionData
+		{
+			uint32_t to;
+			CostType cost;
+		};
+
+		struct PendingArc
+		{
+			uint32_t from;
+			Arc arc;
+		};
+
+		std::vector<NodeData> m_Nodes;
+		std::vector<uint8_t> m_Valid;
+		std::vector<uint32_t> m_Offsets;
+		std::vector<Arc> m_Arcs;
+		// Connections added since the last Build
+		std::vector<PendingArc> m_PendingArcs;
+
+		std::vector<Color> m_NodeColors;
+		std::vector<Color> m_ArcColors;
+
+		int m_NrOfActiveNodes = 0;
+		bool m_IsDirectionalGraph;
+		// Nodes were removed since the last Build, their arcs are still laid out
+		bool m_HasRemovedNodes = false;
+	};
+
+	template<class T_Traits>
+	CompactGraph<T_Traits>::CompactGraph(bool isDirectionalGraph)
+		: m_Offsets(1, 0)
+		, m_IsDirectionalGraph(isDirectionalGraph)
+	{
+	}
+
+	template<class T_Traits>
+	int CompactGraph<T_Traits>::AddNode(const NodeData& data)
+	{
+		m_Nodes.push_back(data);
+		m_Valid.push_back(1);
+		++m_NrOfActiveNodes;
+		// The new node has no arcs until the next Build
+		m_Offsets.push_back(m_Offsets.back());
+		if (!m_NodeColors.empty())
+			m_NodeColors.push_back(DEFAULT_NODE_COLOR);
+
+		return int(m_Nodes.size()) - 1;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::AddConnection(int from, int to, float cost, const ConnectionData& data)
+	{
+		assert(IsNodeValid(from) && IsNodeValid(to) && "<CompactGraph::AddConnection>: invalid node index");
+
+		PendingArc pending{};
+		pending.from = uint32_t(from);
+		static_cast<ConnectionData&>(pending.arc) = data;
+		pending.arc.to = uint32_t(to);
+		pending.arc.cost = CostConverter<CostType>::FromFloat(cost);
+		m_PendingArcs.push_back(pending);
+
+		if (!m_IsDirectionalGraph)
+		{
+			pending.from = uint32_t(to);
+			pending.arc.to = uint32_t(from);
+			m_PendingArcs.push_back(pending);
+		}
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::RemoveNode(int idx)
+	{
+		assert(IsNodeValid(idx) && "<CompactGraph::RemoveNode>: invalid node index");
+
+		m_Valid[idx] = 0;
+		--m_NrOfActiveNodes;
+		m_HasRemovedNodes = true;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::Build()
+	{
+		const int nrOfNodes = GetNrOfNodes();
+
+		// Arcs from or to removed nodes are left out
+		auto isKept = [this](uint32_t from, const Arc& arc) { return !m_HasRemovedNodes || (m_Valid[from] && m_Valid[arc.to]); };
+
+		// Counting sort of the existing and the pending arcs on their source
+		std::vector<uint32_t> offsets(nrOfNodes + 1, 0);
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			for (int arc = GetFirstArc(idx); arc < GetLastArc(idx); ++arc)
+				offsets[idx + 1] += isKept(uint32_t(idx), m_Arcs[arc]) ? 1 : 0;
+		}
+		for (const PendingArc& pending : m_PendingArcs)
+			offsets[pending.from + 1] += isKept(pending.from, pending.arc) ? 1 : 0;
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+			offsets[idx + 1] += offsets[idx];
+
+		std::vector<Arc> arcs(offsets[nrOfNodes]);
+		std::vector<Color> arcColors(m_ArcColors.empty() ? 0 : arcs.size(), DEFAULT_CONNECTION_COLOR);
+		std::vector<uint32_t> cursors(offsets.begin(), offsets.end() - 1);
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			for (int arc = GetFirstArc(idx); arc < GetLastArc(idx); ++arc)
+			{
+				if (!isKept(uint32_t(idx), m_Arcs[arc]))
+					continue;
+
+				if (!arcColors.empty())
+					arcColors[cursors[idx]] = m_ArcColors[arc];
+				arcs[cursors[idx]++] = m_Arcs[arc];
+			}
+		}
+		for (const PendingArc& pending : m_PendingArcs)
+		{
+			if (isKept(pending.from, pending.arc))
+				arcs[cursors[pending.from]++] = pending.arc;
+		}
+
+		m_Offsets.swap(offsets);
+		m_Arcs.swap(arcs);
+		m_ArcColors.swap(arcColors);
+
+		m_PendingArcs.clear();
+		m_PendingArcs.shrink_to_fit();
+		m_HasRemovedNodes = false;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::Clear()
+	{
+		m_Nodes.clear();
+		m_Valid.clear();
+		m_NrOfActiveNodes = 0;
+		m_HasRemovedNodes = false;
+		m_Offsets.assign(1, 0);
+		m_Arcs.clear();
+		m_PendingArcs.clear();
+		ClearColors();
+	}
+
+	template<class T_Traits>
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator, typename T_NodeFunc, typename T_ConnectionFunc>
+	void CompactGraph<T_Traits>::BuildFrom(const IGraph<T_NodeType, T_ConnectionType, T_Allocator>& graph, T_NodeFunc nodeFunc, T_ConnectionFunc conFunc)
+	{
+		Clear();
+		m_IsDirectionalGraph = graph.IsDirectionalGraph();
+
+		const int nrOfNodes = graph.GetNrOfNodes();
+		m_Nodes.reserve(nrOfNodes);
+		m_Valid.reserve(nrOfNodes);
+		m_Offsets.reserve(nrOfNodes + 1);
+		m_Arcs.reserve(graph.GetNrOfConnections());
+
+		// The connections of the graph are listed per node already, they can be laid out directly
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			m_Nodes.push_back(nodeFunc(graph.GetNode(idx)));
+			m_Valid.push_back(graph.IsNodeValid(idx) ? 1 : 0);
+
+			if (graph.IsNodeValid(idx))
+			{
+				++m_NrOfActiveNodes;
+				for (auto pConnection : graph.GetNodeConnections(idx))
+				{
+					if (!graph.IsNodeValid(pConnection->GetTo()))
+						continue;
+
+					Arc arc{};
+					static_cast<ConnectionData&>(arc) = conFunc(pConnection);
+					arc.to = uint32_t(pConnection->GetTo());
+					arc.cost = CostConverter<CostType>::FromFloat(pConnection->GetCost());
+					m_Arcs.push_back(arc);
+				}
+			}
+			m_Offsets.push_back(uint32_t(m_Arcs.size()));
+		}
+	}
+
+	template<class T_Traits>
+	int CompactGraph<T_Traits>::FindArc(int from, int to) const
+	{
+		for (int arc = GetFirstArc(from); arc < GetLastArc(from); ++arc)
+		{
+			if (int(m_Arcs[arc].to) == to)
+				return arc;
+		}
+
+		return invalid_arc_index;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::SetNodeColor(int idx, const Color& color)
+	{
+		if (m_NodeColors.empty())
+			m_NodeColors.assign(m_Nodes.size(), DEFAULT_NODE_COLOR);
+		m_NodeColors[idx] = color;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::SetArcColor(int arc, const Color& color)
+	{
+		if (m_ArcColors.empty())
+			m_ArcColors.assign(m_Arcs.size(), DEFAULT_CONNECTION_COLOR);
+		m_ArcColors[arc] = color;
+	}
+
+	template<class T_Traits>
+	void CompactGraph<T_Traits>::ClearColors()
+	{
+		m_NodeColors.clear();
+		m_NodeColors.shrink_to_fit();
+		m_ArcColors.clear();
+		m_ArcColors.shrink_to_fit();
+	}
+
+	template<class T_Traits>
+	size_t CompactGraph<T_Traits>::GetMemoryUsage() const
+	{
+		return m_Nodes.size() * sizeof(NodeData) + m_Valid.size() * sizeof(uint8_t) + m_Offsets.size() * sizeof(uint32_t) + m_Arcs.size() * sizeof(Arc)
+			+ m_PendingArcs.size() * sizeof(PendingArc) + (m_NodeColors.size() + m_ArcColors.size()) * sizeof(Color);
+	}
+
+	template<class T_Traits, typename T_PositionFunc>
+	inline void GraphCSR::Build(const CompactGraph<T_Traits>& graph, T_PositionFunc nodePos)
+	{
+		const int nrOfNodes = graph.GetNrOfNodes();
+
+		m_Offsets.assign(nrOfNodes + 1, 0);
+		m_Targets.clear();
+		m_Costs.clear();
+		m_Positions.resize(nrOfNodes);
+		m_Valid.assign(nrOfNodes, 0);
+		m_Targets.reserve(graph.GetNrOfArcs());
+		m_Costs.reserve(graph.GetNrOfArcs());
+
+		// The arcs interleave their target and cost (a 16 bit cost has to be converted), so they are copied
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			m_Offsets[idx] = int(m_Targets.size());
+			m_Positions[idx] = nodePos(idx);
+
+			if (!graph.IsNodeValid(idx))
+				continue;
+
+			m_Valid[idx] = 1;
+
+			// Arcs to nodes removed since the last Build of the graph are left out
+			for (int arc = graph.GetFirstArc(idx); arc < graph.GetLastArc(idx); ++arc)
+			{
+				if (!graph.IsNodeValid(graph.GetArcTarget(arc)))
+					continue;
+
+				m_Targets.push_back(graph.GetArcTarget(arc));
+				m_Costs.push_back(graph.GetArcCost(arc));
+			}
+		}
+		m_Offsets[nrOfNodes] = int(m_Targets.size());
+
+		// A CompactGraph has no versions, the snapshot is taken again after changing it
+		m_NrOfActiveNodes = graph.GetNrOfActiveNodes();
+		m_IsDirectionalGraph = graph.IsDirectionalGraph();
+		m_Version = 0;
+		m_TopologyVersion = 0;
+
+		UseOwnArrays();
+		LinkTwins();
+	}
+}
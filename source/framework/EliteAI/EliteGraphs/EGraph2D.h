@@ -9,17 +9,19 @@
 #include "EIGraph.h"
 #include "EGraphConnectionTypes.h"
 #include "EGraphNodeTypes.h"
+#include "EGraphSpatialGrid.h"
 #include <iomanip>
 
 namespace Elite
 {
-	template<class T_NodeType, class T_ConnectionType>
-	class Graph2D : public IGraph<T_NodeType, T_ConnectionType>
+	// T_Allocator: allocation policy of the nodes and connections, forwarded to IGraph (see EGraphAllocators.h)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator = GraphPoolAllocator>
+	class Graph2D : public IGraph<T_NodeType, T_ConnectionType, T_Allocator>
 	{
 	public:
 		Graph2D(bool isDirectional);
 		Graph2D(const Graph2D& other);
-		virtual std::shared_ptr<IGraph<T_NodeType, T_ConnectionType>> Clone() const override;
+		virtual std::shared_ptr<IGraph<T_NodeType, T_ConnectionType, T_Allocator>> Clone() const override;
 
 		using IGraph::GetNodePos;
 		virtual Vector2 GetNodePos(T_NodeType* pNode) const override { return pNode->GetPosition(); }
@@ -27,65 +29,206 @@ namespace Elite
 		virtual int GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const override;
 		T_ConnectionType* GetConnectionAtPosition(const Vector2& pos) const;
 
+		// Call func(T_NodeType*) and func(T_ConnectionType*) for the nodes and connections near the rectangle [lower, upper],
+		// found through the spatial grid. The caller checks the actual positions. An undirected connection is visited once.
+		template<typename T_Func>
+		void ForEachNodeInRect(const Vector2& lower, const Vector2& upper, T_Func func) const;
+		template<typename T_Func>
+		void ForEachConnectionInRect(const Vector2& lower, const Vector2& upper, T_Func func) const;
+
+		// Moves the node and marks it dirty, the costs of its connections are left as they are
+		void SetNodePosition(int idx, const Vector2& pos);
+
 		void SetConnectionCostsToDistance();
+		// Only updates the connections leaving or arriving at the node
+		// Arriving connections in a directed graph are found by going over all connections
+		void SetConnectionCostsToDistance(int idx);
+		// Does nothing if the connection doesn't exist (anymore)
+		void SetConnectionCostToDistance(int from, int to);
 		void SetNodesColor(const std::vector<GraphNode2D*>& nodes, const Color& color);
 
+		// Replaces the nodes and connections with those of a snapshot (GraphCSR, also one of a graph file, see EGraphFile.h)
+		// in one go, the indices stay the same. The snapshot and the graph have to agree on being directional.
+		template<class T_Snapshot>
+		void Build(const T_Snapshot& snapshot);
+
+	protected:
+		virtual void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) override;
+		virtual void OnNodeModified(int idx) override;
+		virtual void OnConnectionModified(int from, int to) override;
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override { m_IsSpatialGridOutdated = true; }
+
 	private:
 		// variables
 		int m_SelectedNodeIdx = -1;
 		bool m_IsLeftMouseButtonDown = false;
 		Vector2 m_MousePos;
 		const float m_ConnectionSelectionOffset = 1.f;
+		const float m_NodeSelectionMargin = 1.5f;
+
+		// Spatial grid used by the lookups, brought up to date with the modifications since the previous lookup
+		// An undirected connection is stored once, from the lowest to the highest index
+		// The cell size follows the node spacing and the average connection length, the grid is rebuilt once they drift too far from it
+		mutable GraphSpatialGrid m_SpatialGrid;
+		mutable bool m_IsSpatialGridOutdated = true; // rebuilt from scratch on the next lookup
+		mutable std::vector<int> m_ModifiedNodes;
+		mutable std::vector<bool> m_IsNodeModified;
+		mutable std::vector<std::pair<int, int>> m_ModifiedConnections;
+		mutable std::vector<std::pair<int, int>> m_NodeConnectionsBuffer;
+		// Bounds of the node positions at the last rebuild, only growing in between
+		mutable Vector2 m_SpatialGridMin;
+		mutable Vector2 m_SpatialGridMax;
+
+		// Marks the connection dirty if its cost changed, the caller notifies once for all of them
+		bool SetConnectionCostToDistance(T_ConnectionType* pConnection);
+		void UpdateSpatialGrid() const;
+		void UpdateSpatialGridConnection(int from, int to) const;
+		float CalculateSpatialGridCellSize(float averageConnectionLength) const;
+		void GrowSpatialGridBounds(const Vector2& pos) const;
 	};
 
-	template<class T_NodeType, class T_ConnectionType>
-	Graph2D<T_NodeType, T_ConnectionType>::Graph2D(bool isDirectional)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::Graph2D(bool isDirectional)
 		: IGraph(isDirectional)
 	{
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline Graph2D<T_NodeType, T_ConnectionType>::Graph2D(const Graph2D& other)
-		: IGraph<T_NodeType, T_ConnectionType>(other)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::Graph2D(const Graph2D& other)
+		: IGraph<T_NodeType, T_ConnectionType, T_Allocator>(other)
 	{
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline std::shared_ptr<IGraph<T_NodeType, T_ConnectionType>> Graph2D<T_NodeType, T_ConnectionType>::Clone() const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline std::shared_ptr<IGraph<T_NodeType, T_ConnectionType, T_Allocator>> Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::Clone() const
 	{
 		return std::shared_ptr<Graph2D>(new Graph2D(*this));
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int Graph2D<T_NodeType, T_ConnectionType>::GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline int Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const
 	{
-		float posErrorMargin = 1.5f;
-		auto foundIt = find_if(m_Nodes.begin(), m_Nodes.end(),
-			[pos, posErrorMargin, this](T_NodeType* pNode)
-		{ return pNode->GetIndex() != invalid_node_index && (pNode->GetPosition() - pos).MagnitudeSquared() < pow(posErrorMargin * GetNodeRadius(pNode), 2); });
+		UpdateSpatialGrid();
 
-		if (foundIt != m_Nodes.end())
-			return (*foundIt)->GetIndex();
-		else
-			return invalid_node_index;
+		// GetNodeRadius is the same for every node, so it also bounds the search
+		const float searchRadius = m_NodeSelectionMargin * DEFAULT_NODE_RADIUS;
+
+		int closestIdx = invalid_node_index;
+		float closestDistanceSquared = FLT_MAX;
+		m_SpatialGrid.ForEachNodeNear(pos, searchRadius, [&](int idx)
+		{
+			const T_NodeType* pNode = m_Nodes[idx];
+			const float maxDistance = m_NodeSelectionMargin * GetNodeRadius(m_Nodes[idx]);
+			const float distanceSquared = (pNode->GetPosition() - pos).MagnitudeSquared();
+
+			if (distanceSquared < maxDistance * maxDistance && distanceSquared < closestDistanceSquared)
+			{
+				closestIdx = idx;
+				closestDistanceSquared = distanceSquared;
+			}
+		});
+
+		return closestIdx;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetNodePosition(int idx, const Vector2& pos)
+	{
+		GetNode(idx)->SetPosition(pos);
+		MarkNodeDirty(idx);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	void Graph2D<T_NodeType, T_ConnectionType>::SetConnectionCostsToDistance()
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetConnectionCostsToDistance()
 	{
+		bool isModified = false;
 		for (auto& connectionList : m_Connections)
 		{
 			for (auto& connection : connectionList)
+				isModified |= SetConnectionCostToDistance(connection);
+		}
+
+		if (isModified)
+			NotifyGraphModified(false, false);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetConnectionCostsToDistance(int idx)
+	{
+		if (!IsNodeValid(idx))
+			return;
+
+		bool isModified = false;
+		for (auto connection : m_Connections[idx])
+		{
+			isModified |= SetConnectionCostToDistance(connection);
+
+			// In an undirected graph every arriving connection is the opposite of a leaving one
+			if (!m_IsDirectionalGraph)
+			{
+				auto oppositeConnection = GetConnection(connection->GetTo(), idx);
+				if (oppositeConnection)
+					isModified |= SetConnectionCostToDistance(oppositeConnection);
+			}
+		}
+
+		if (m_IsDirectionalGraph)
+		{
+			for (auto& connectionList : m_Connections)
 			{
-				auto posFrom = GetNodePos(connection->GetFrom());
-				auto posTo = GetNodePos(connection->GetTo());
-				connection->SetCost(abs(Distance(posFrom, posTo)));
+				for (auto connection : connectionList)
+				{
+					if (connection->GetTo() == idx)
+						isModified |= SetConnectionCostToDistance(connection);
+				}
 			}
 		}
+
+		if (isModified)
+			NotifyGraphModified(false, false);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetConnectionCostToDistance(int from, int to)
+	{
+		if (!IsNodeValid(from) || !IsNodeValid(to))
+			return;
+
+		auto connection = GetConnection(from, to);
+		if (connection && SetConnectionCostToDistance(connection))
+			NotifyGraphModified(false, false);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline bool Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetConnectionCostToDistance(T_ConnectionType* pConnection)
+	{
+		auto posFrom = GetNodePos(pConnection->GetFrom());
+		auto posTo = GetNodePos(pConnection->GetTo());
+		const float cost = abs(Distance(posFrom, posTo));
+		if (pConnection->GetCost() == cost)
+			return false;
+
+		// Same as SetConnectionCost, so snapshots, caches and incremental searches see the change
+		pConnection->SetCost(cost);
+		AddDirtyConnection(pConnection->GetFrom(), pConnection->GetTo());
+		return true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<class T_Snapshot>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::Build(const T_Snapshot& snapshot)
+	{
+		assert(snapshot.IsDirectionalGraph() == m_IsDirectionalGraph && "<Graph2D::Build>: the snapshot and the graph are not both (un)directed");
+
+		Clear();
+		BulkBuild(snapshot, [this, &snapshot](const typename T_Allocator<T_NodeType>::Range& range, int idx)
+		{
+			return m_NodeAllocator.AllocateInRange(range, size_t(idx), idx, snapshot.GetNodePos(idx));
+		});
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	void Graph2D<T_NodeType, T_ConnectionType>::SetNodesColor(const std::vector<GraphNode2D*>& nodes, const Color& color)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::SetNodesColor(const std::vector<GraphNode2D*>& nodes, const Color& color)
 	{
 		for (auto& n : nodes)
 		{
@@ -94,24 +237,220 @@ namespace Elite
 		}
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	T_ConnectionType* Graph2D<T_NodeType, T_ConnectionType>::GetConnectionAtPosition(const Vector2& pos) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<typename T_Func>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::ForEachNodeInRect(const Vector2& lower, const Vector2& upper, T_Func func) const
+	{
+		UpdateSpatialGrid();
+		m_SpatialGrid.ForEachNodeInRect(lower, upper, [&](int idx) { func(m_Nodes[idx]); });
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<typename T_Func>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::ForEachConnectionInRect(const Vector2& lower, const Vector2& upper, T_Func func) const
+	{
+		UpdateSpatialGrid();
+		m_SpatialGrid.ForEachConnectionInRect(lower, upper, [&](int from, int to)
+		{
+			// The grid stores an undirected connection only once, either direction can exist in the graph
+			auto pConnection = GetConnection(from, to);
+			func(pConnection ? pConnection : GetConnection(to, from));
+		});
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	T_ConnectionType* Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::GetConnectionAtPosition(const Vector2& pos) const
+	{
+		UpdateSpatialGrid();
+
+		int closestFrom = invalid_node_index;
+		int closestTo = invalid_node_index;
+		float closestDistanceSquared = m_ConnectionSelectionOffset;
+		m_SpatialGrid.ForEachConnectionNear(pos, sqrtf(m_ConnectionSelectionOffset), [&](int from, int to)
+		{
+			auto segmentStart = GetNodePos(to);
+			auto segmentEnd = GetNodePos(from);
+
+			auto projectedPoint = ProjectOnLineSegment(segmentStart, segmentEnd, pos);
+
+			const float distanceSquared = DistanceSquared(projectedPoint, pos);
+			if (distanceSquared < closestDistanceSquared)
+			{
+				closestFrom = from;
+				closestTo = to;
+				closestDistanceSquared = distanceSquared;
+			}
+		});
+
+		if (closestFrom == invalid_node_index)
+			return nullptr;
+
+		// The grid stores an undirected connection only once, either direction can exist in the graph
+		auto result = GetConnection(closestFrom, closestTo);
+		return result ? result : GetConnection(closestTo, closestFrom);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged)
+	{
+		// Clear doesn't report the removed nodes one by one
+		if (m_Nodes.empty())
+			m_IsSpatialGridOutdated = true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::OnNodeModified(int idx)
+	{
+		if (m_IsSpatialGridOutdated)
+			return;
+
+		if (idx >= (int)m_IsNodeModified.size())
+			m_IsNodeModified.resize(idx + 1, false);
+
+		if (!m_IsNodeModified[idx])
+		{
+			m_IsNodeModified[idx] = true;
+			m_ModifiedNodes.push_back(idx);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::OnConnectionModified(int from, int to)
+	{
+		if (m_IsSpatialGridOutdated)
+			return;
+
+		// Building a whole graph between two lookups is faster done from scratch
+		if (m_ModifiedConnections.size() > m_Nodes.size() + 64)
+		{
+			m_IsSpatialGridOutdated = true;
+			return;
+		}
+
+		m_ModifiedConnections.push_back(std::make_pair(from, to));
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::UpdateSpatialGrid() const
 	{
-		T_ConnectionType* result = nullptr;
-		for (auto connectionList : m_Connections)
+		if (m_IsSpatialGridOutdated)
+		{
+			m_SpatialGridMin = Vector2{ FLT_MAX, FLT_MAX };
+			m_SpatialGridMax = Vector2{ -FLT_MAX, -FLT_MAX };
+			for (auto pNode : m_Nodes)
+			{
+				if (pNode->GetIndex() != invalid_node_index)
+					GrowSpatialGridBounds(pNode->GetPosition());
+			}
+
+			double totalLength = 0.0;
+			int nrOfConnections = 0;
+			for (auto& connectionList : m_Connections)
+			{
+				for (auto connection : connectionList)
+				{
+					totalLength += Distance(GetNodePos(connection->GetFrom()), GetNodePos(connection->GetTo()));
+					++nrOfConnections;
+				}
+			}
+
+			m_SpatialGrid.SetCellSize(CalculateSpatialGridCellSize(nrOfConnections > 0 ? float(totalLength / nrOfConnections) : 0.f));
+			for (auto pNode : m_Nodes)
+			{
+				if (pNode->GetIndex() != invalid_node_index)
+					m_SpatialGrid.InsertNode(pNode->GetIndex(), pNode->GetPosition());
+			}
+
+			for (auto& connectionList : m_Connections)
+			{
+				for (auto connection : connectionList)
+				{
+					if (m_IsDirectionalGraph || connection->GetFrom() < connection->GetTo())
+						UpdateSpatialGridConnection(connection->GetFrom(), connection->GetTo());
+				}
+			}
+
+			m_IsSpatialGridOutdated = false;
+		}
+		else
 		{
-			for (auto connection : connectionList)
+			// A moved node takes its connections along, a removed one is removed with its connections
+			for (int idx : m_ModifiedNodes)
 			{
-				auto segmentStart = GetNodePos(connection->GetTo());
-				auto segmentEnd =	GetNodePos(connection->GetFrom());
+				if (!IsNodeValid(idx))
+				{
+					m_SpatialGrid.RemoveNode(idx);
+					continue;
+				}
 
-				auto projectedPoint = ProjectOnLineSegment(segmentStart, segmentEnd, pos);
+				m_SpatialGrid.InsertNode(idx, m_Nodes[idx]->GetPosition());
+				GrowSpatialGridBounds(m_Nodes[idx]->GetPosition());
 
-				if (DistanceSquared(projectedPoint, pos) < m_ConnectionSelectionOffset)
-					result = connection;
+				m_NodeConnectionsBuffer.clear();
+				m_SpatialGrid.ForEachConnectionOfNode(idx, [this](int from, int to) { m_NodeConnectionsBuffer.push_back(std::make_pair(from, to)); });
+				for (const auto& connection : m_NodeConnectionsBuffer)
+					UpdateSpatialGridConnection(connection.first, connection.second);
 			}
+
+			for (const auto& connection : m_ModifiedConnections)
+				UpdateSpatialGridConnection(connection.first, connection.second);
+
+			// Cells much smaller than the connections make them pass through many cells, much larger ones fill up
+			const float idealCellSize = CalculateSpatialGridCellSize(m_SpatialGrid.GetAverageConnectionLength());
+			const float cellSize = m_SpatialGrid.GetCellSize();
+			if (idealCellSize > 2.f * cellSize || idealCellSize < 0.5f * cellSize)
+				m_IsSpatialGridOutdated = true;
 		}
 
-		return result;
+		for (int idx : m_ModifiedNodes)
+			m_IsNodeModified[idx] = false;
+		m_ModifiedNodes.clear();
+		m_ModifiedConnections.clear();
+
+		if (m_IsSpatialGridOutdated)
+			UpdateSpatialGrid();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::UpdateSpatialGridConnection(int from, int to) const
+	{
+		if (!m_IsDirectionalGraph && from > to)
+			std::swap(from, to);
+
+		const bool exists = IsNodeValid(from) && IsNodeValid(to)
+			&& (GetConnection(from, to) || (!m_IsDirectionalGraph && GetConnection(to, from)));
+
+		if (exists)
+			m_SpatialGrid.InsertConnection(from, to, m_Nodes[from]->GetPosition(), m_Nodes[to]->GetPosition());
+		else
+			m_SpatialGrid.RemoveConnection(from, to);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	float Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::CalculateSpatialGridCellSize(float averageConnectionLength) const
+	{
+		// The node spacing keeps about one node in a cell, the average connection length keeps a connection within a few cells,
+		// the smaller one wins so neither the nodes nor the connections pile up in the cells
+		const float minCellSize = 0.01f;
+
+		const int nrOfNodes = GetNrOfActiveNodes();
+		const float extent = std::max(m_SpatialGridMax.x - m_SpatialGridMin.x, m_SpatialGridMax.y - m_SpatialGridMin.y);
+		const float nodeSpacing = nrOfNodes > 1 && extent > 0.f ? extent / sqrtf(float(nrOfNodes)) : 0.f;
+
+		float cellSize = std::max(averageConnectionLength, nodeSpacing);
+		if (averageConnectionLength > 0.f && nodeSpacing > 0.f)
+			cellSize = std::min(averageConnectionLength, nodeSpacing);
+
+		if (cellSize <= 0.f)
+			return m_SpatialGrid.GetCellSize();
+
+		return std::max(cellSize, minCellSize);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void Graph2D<T_NodeType, T_ConnectionType, T_Allocator>::GrowSpatialGridBounds(const Vector2& pos) const
+	{
+		m_SpatialGridMin = Vector2{ std::min(m_SpatialGridMin.x, pos.x), std::min(m_SpatialGridMin.y, pos.y) };
+		m_SpatialGridMax = Vector2{ std::max(m_SpatialGridMax.x, pos.x), std::max(m_SpatialGridMax.y, pos.y) };
 	}
 }
@@ -0,0 +1,214 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphAllocators.h: Allocation policies used by IGraph to create its nodes and connections
+// A policy is a class template taking the allocated type, with the following interface:
+//	- T* Allocate(Args&&... args)	constructs a new object
+//	- void Deallocate(T* p)			destroys a single object and makes its memory available again
+//	- void Reserve(size_t count)	makes sure count objects can be allocated without growing
+//	- void Reset()					forgets all memory handed out, only valid once every object has been deallocated
+//	- Range AllocateRange(size_t count)							makes room for count objects at once
+//	- T* AllocateInRange(const Range& range, size_t i, Args&&... args)	constructs object i of the range, different objects
+//																		of a range can be constructed from different threads
+/*=============================================================================*/
+#pragma once
+
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Elite
+{
+	// Every object is a separate heap allocation (useful when tracking leaks per object with VLD)
+	template<class T>
+	class GraphHeapAllocator final
+	{
+	public:
+		template<typename... Args>
+		T* Allocate(Args&&... args) { return new T(std::forward<Args>(args)...); }
+		void Deallocate(T* p) { delete p; }
+		void Reserve(size_t) {}
+		void Reset() {}
+
+		struct Range {};
+		Range AllocateRange(size_t) { return Range{}; }
+		template<typename... Args>
+		T* AllocateInRange(const Range&, size_t, Args&&... args) { return new T(std::forward<Args>(args)...); }
+	};
+
+	// Objects are allocated contiguously in blocks that grow geometrically
+	// Deallocated objects are put on a free list and reused by the next allocation
+	// Reset rewinds to the first block, so a rebuilt graph is laid out contiguously again without touching the heap
+	template<class T>
+	class GraphPoolAllocator final
+	{
+	public:
+		GraphPoolAllocator() = default;
+		~GraphPoolAllocator() = default;
+
+		template<typename... Args>
+		T* Allocate(Args&&... args);
+		void Deallocate(T* p);
+		void Reserve(size_t count);
+		void Reset();
+
+		size_t GetCapacity() const;
+
+		// count never used slots from a single block, the rest of the current block is skipped when they don't fit in it
+		struct Range
+		{
+			void* pFirstSlot;
+			size_t count;
+		};
+		Range AllocateRange(size_t count);
+		template<typename... Args>
+		T* AllocateInRange(const Range& range, size_t i, Args&&... args);
+
+		//C++ make the class non-copyable (a copied graph gets its own pools)
+		GraphPoolAllocator(const GraphPoolAllocator&) = delete;
+		GraphPoolAllocator& operator=(const GraphPoolAllocator&) = delete;
+
+	private:
+		union Slot
+		{
+			Slot* pNextFree;
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+		};
+
+		struct Block
+		{
+			std::unique_ptr<Slot[]> pSlots;
+			size_t size;
+		};
+
+		static const size_t m_MinBlockSize = 64;
+		static const size_t m_MaxBlockSize = 16384;
+
+		std::vector<Block> m_Blocks;
+		size_t m_CurrentBlock = 0;		// block the next never used slot is taken from
+		size_t m_NextSlotInBlock = 0;	// first never used slot in the current block
+		Slot* m_pFreeList = nullptr;
+
+		Slot* GetSlot();
+		void AddBlock(size_t size);
+	};
+
+	template<class T>
+	template<typename... Args>
+	inline T* GraphPoolAllocator<T>::Allocate(Args&&... args)
+	{
+		return new (&GetSlot()->storage) T(std::forward<Args>(args)...);
+	}
+
+	template<class T>
+	inline typename GraphPoolAllocator<T>::Range GraphPoolAllocator<T>::AllocateRange(size_t count)
+	{
+		// Every block after the current one is unused, take the first one that is large enough or add one
+		while (m_CurrentBlock < m_Blocks.size() && m_Blocks[m_CurrentBlock].size - m_NextSlotInBlock < count)
+		{
+			++m_CurrentBlock;
+			m_NextSlotInBlock = 0;
+		}
+
+		if (m_CurrentBlock == m_Blocks.size())
+		{
+			AddBlock(std::max(count, size_t(m_MinBlockSize)));
+			m_NextSlotInBlock = 0;
+		}
+
+		Range range{ &m_Blocks[m_CurrentBlock].pSlots[m_NextSlotInBlock], count };
+		m_NextSlotInBlock += count;
+		return range;
+	}
+
+	template<class T>
+	template<typename... Args>
+	inline T* GraphPoolAllocator<T>::AllocateInRange(const Range& range, size_t i, Args&&... args)
+	{
+		assert(i < range.count && "<GraphPoolAllocator::AllocateInRange>: index outside of the range");
+		return new (&static_cast<Slot*>(range.pFirstSlot)[i].storage) T(std::forward<Args>(args)...);
+	}
+
+	template<class T>
+	inline void GraphPoolAllocator<T>::Deallocate(T* p)
+	{
+		if (!p)
+			return;
+
+		p->~T();
+
+		auto pSlot = reinterpret_cast<Slot*>(p);
+		pSlot->pNextFree = m_pFreeList;
+		m_pFreeList = pSlot;
+	}
+
+	template<class T>
+	inline void GraphPoolAllocator<T>::Reserve(size_t count)
+	{
+		// Count the slots that can still be handed out without growing (the free list is not taken into account)
+		size_t available = 0;
+		for (size_t b = m_CurrentBlock; b < m_Blocks.size(); ++b)
+			available += m_Blocks[b].size;
+		if (m_CurrentBlock < m_Blocks.size())
+			available -= m_NextSlotInBlock;
+
+		// One block for everything that is missing, the slots left in the existing blocks are handed out first,
+		// so the reserved objects can be spread over those blocks and the new one (use AllocateRange for a contiguous range)
+		if (count > available)
+			AddBlock(count - available);
+	}
+
+	template<class T>
+	inline void GraphPoolAllocator<T>::Reset()
+	{
+		m_CurrentBlock = 0;
+		m_NextSlotInBlock = 0;
+		m_pFreeList = nullptr;
+	}
+
+	template<class T>
+	inline size_t GraphPoolAllocator<T>::GetCapacity() const
+	{
+		size_t capacity = 0;
+		for (const auto& block : m_Blocks)
+			capacity += block.size;
+		return capacity;
+	}
+
+	template<class T>
+	inline typename GraphPoolAllocator<T>::Slot* GraphPoolAllocator<T>::GetSlot()
+	{
+		if (m_pFreeList)
+		{
+			Slot* pSlot = m_pFreeList;
+			m_pFreeList = pSlot->pNextFree;
+			return pSlot;
+		}
+
+		// Move on to the next block when the current one is used up, allocating a new one if needed
+		while (m_CurrentBlock < m_Blocks.size() && m_NextSlotInBlock == m_Blocks[m_CurrentBlock].size)
+		{
+			++m_CurrentBlock;
+			m_NextSlotInBlock = 0;
+		}
+
+		if (m_CurrentBlock == m_Blocks.size())
+		{
+			size_t newSize = m_Blocks.empty() ? size_t(m_MinBlockSize) : m_Blocks.back().size * 2;
+			if (newSize > m_MaxBlockSize)
+				newSize = m_MaxBlockSize;
+			AddBlock(newSize);
+		}
+
+		return &m_Blocks[m_CurrentBlock].pSlots[m_NextSlotInBlock++];
+	}
+
+	template<class T>
+	inline void GraphPoolAllocator<T>::AddBlock(size_t size)
+	{
+		Block block;
+		block.pSlots.reset(new Slot[size]);
+		block.size = size;
+		m_Blocks.push_back(std::move(block));
+	}
+}
@@ -0,0 +1,363 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphCSR.h: Compressed sparse row snapshot of a graph, for algorithms that only read the graph.
+// The connections of all nodes are stored as arcs in a single array, the arcs of node i are
+// [GetFirstArc(i), GetLastArc(i)). Node indices are the same as in the graph it was built from.
+// A snapshot of a graph file reads the arrays of the mapped file in place instead of copying them (see EGraphFile.h).
+/*=============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include "EIGraph.h"
+#include "EImplicitGridGraph.h"
+
+namespace Elite
+{
+	const int invalid_arc_index = -1;
+
+	class GraphFileView;
+	template<class T_Traits>
+	class CompactGraph;
+
+	class GraphCSR final
+	{
+	public:
+		GraphCSR() = default;
+		GraphCSR(const GraphCSR& other) { *this = other; }
+		GraphCSR& operator=(const GraphCSR& other);
+
+		template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+		explicit GraphCSR(const IGraph<T_NodeType, T_ConnectionType, T_Allocator>& graph) { Build(graph); }
+		explicit GraphCSR(const ImplicitGridGraph& graph) { Build(graph); }
+		explicit GraphCSR(const GraphFileView& file) { Build(file); }
+		template<class T_Traits, typename T_PositionFunc>
+		GraphCSR(const CompactGraph<T_Traits>& graph, T_PositionFunc nodePos) { Build(graph, nodePos); }
+
+		// Rebuilds the snapshot, the memory of the previous snapshot is reused
+		template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+		void Build(const IGraph<T_NodeType, T_ConnectionType, T_Allocator>& graph);
+		// Every cell is a valid node, the arcs are the connections ForEachConnection finds
+		void Build(const ImplicitGridGraph& graph);
+		// Points into the mapped file, nothing is copied: the file has to stay open while the snapshot is used (defined in EGraphFile.cpp)
+		// The arcs of an undirected file have no twins, GetArcTwin needs a snapshot built from a graph
+		void Build(const GraphFileView& file);
+		// A CompactGraph stores no positions, nodePos(int idx) -> Vector2 gives them (defined in ECompactGraph.h)
+		// Arcs added since the last CompactGraph::Build are left out
+		template<class T_Traits, typename T_PositionFunc>
+		void Build(const CompactGraph<T_Traits>& graph, T_PositionFunc nodePos);
+		// Snapshot with every arc reversed, so the arcs of node i are the connections arriving at it
+		void BuildTransposed(const GraphCSR& other);
+
+		// Version of the graph at the moment the snapshot was built
+		unsigned int GetVersion() const { return m_Version; }
+		unsigned int GetTopologyVersion() const { return m_TopologyVersion; }
+		bool IsDirectionalGraph() const { return m_IsDirectionalGraph; }
+
+		// Nodes
+		int GetNrOfNodes() const { return m_NrOfNodes; }
+		int GetNrOfActiveNodes() const { return m_NrOfActiveNodes; }
+		bool IsNodeValid(int idx) const { return idx >= 0 && idx < m_NrOfNodes && m_pValid[idx]; }
+		Vector2 GetNodePos(int idx) const { return m_pPositions[idx]; }
+		int GetDegree(int idx) const { return m_pOffsets[idx + 1] - m_pOffsets[idx]; }
+
+		// Arcs
+		int GetNrOfArcs() const { return m_NrOfArcs; }
+		int GetFirstArc(int idx) const { return m_pOffsets[idx]; }
+		int GetLastArc(int idx) const { return m_pOffsets[idx + 1]; }
+		int GetArcTarget(int arc) const { return m_pTargets[arc]; }
+		float GetArcCost(int arc) const { return m_pCosts[arc]; }
+		// The arc in the opposite direction, only available in undirected graphs (invalid_arc_index otherwise)
+		int GetArcTwin(int arc) const { return m_Twins.empty() ? invalid_arc_index : m_Twins[arc]; }
+
+		// Linear search over the arcs of 'from', returns invalid_arc_index if there is no connection
+		int FindArc(int from, int to) const;
+
+		// Hash of everything the costs of paths depend on, identifies the graph in files saved next to it
+		uint32_t GetFingerprint() const;
+
+	private:
+		// Owned arrays, empty for a snapshot of a file
+		std::vector<int> m_Offsets;
+		std::vector<int> m_Targets;
+		std::vector<float> m_Costs;
+		std::vector<int> m_Twins;
+		std::vector<Vector2> m_Positions;
+		std::vector<uint8_t> m_Valid;
+
+		// What the accessors read: the owned arrays, or the arrays of a mapped file
+		const int32_t* m_pOffsets = nullptr;
+		const int32_t* m_pTargets = nullptr;
+		const float* m_pCosts = nullptr;
+		const Vector2* m_pPositions = nullptr;
+		const uint8_t* m_pValid = nullptr;
+		bool m_IsFileSnapshot = false;
+
+		int m_NrOfNodes = 0;
+		int m_NrOfArcs = 0;
+		int m_NrOfActiveNodes = 0;
+		bool m_IsDirectionalGraph = false;
+		unsigned int m_Version = 0;
+		unsigned int m_TopologyVersion = 0;
+
+		// To be called after filling the owned arrays
+		void UseOwnArrays();
+		void LinkTwins();
+	};
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void GraphCSR::Build(const IGraph<T_NodeType, T_ConnectionType, T_Allocator>& graph)
+	{
+		const int nrOfNodes = graph.GetNrOfNodes();
+
+		m_Offsets.assign(nrOfNodes + 1, 0);
+		m_Targets.clear();
+		m_Costs.clear();
+		m_Positions.resize(nrOfNodes);
+		m_Valid.assign(nrOfNodes, 0);
+		m_Targets.reserve(graph.GetNrOfConnections());
+		m_Costs.reserve(graph.GetNrOfConnections());
+
+		m_NrOfActiveNodes = 0;
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			m_Offsets[idx] = int(m_Targets.size());
+			m_Positions[idx] = graph.GetNodePos(idx);
+
+			// Removed nodes keep an empty arc range
+			if (!graph.IsNodeValid(idx))
+				continue;
+
+			m_Valid[idx] = 1;
+			++m_NrOfActiveNodes;
+
+			// Connections to removed nodes are left out (a directed graph keeps them when removing a node)
+			for (auto pConnection : graph.GetNodeConnections(idx))
+			{
+				if (!graph.IsNodeValid(pConnection->GetTo()))
+					continue;
+
+				m_Targets.push_back(pConnection->GetTo());
+				m_Costs.push_back(pConnection->GetCost());
+			}
+		}
+		m_Offsets[nrOfNodes] = int(m_Targets.size());
+
+		m_IsDirectionalGraph = graph.IsDirectionalGraph();
+		m_Version = graph.GetVersion();
+		m_TopologyVersion = graph.GetTopologyVersion();
+
+		UseOwnArrays();
+		LinkTwins();
+	}
+
+	inline void GraphCSR::Build(const ImplicitGridGraph& graph)
+	{
+		const int nrOfNodes = graph.GetNrOfNodes();
+
+		m_Offsets.assign(nrOfNodes + 1, 0);
+		m_Targets.clear();
+		m_Costs.clear();
+		m_Positions.resize(nrOfNodes);
+		m_Valid.assign(nrOfNodes, 1);
+		const size_t maxNrOfArcs = size_t(nrOfNodes) * (graph.IsConnectedDiagonally() ? ImplicitGridGraph::NrOfDirections : ImplicitGridGraph::NrOfDirections / 2);
+		m_Targets.reserve(maxNrOfArcs);
+		m_Costs.reserve(maxNrOfArcs);
+
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			m_Offsets[idx] = int(m_Targets.size());
+			m_Positions[idx] = graph.GetNodePos(idx);
+			graph.ForEachConnection(idx, [this](int neighborIdx, float cost)
+			{
+				m_Targets.push_back(neighborIdx);
+				m_Costs.push_back(cost);
+			});
+		}
+		m_Offsets[nrOfNodes] = int(m_Targets.size());
+
+		m_NrOfActiveNodes = nrOfNodes;
+		m_IsDirectionalGraph = graph.IsDirectionalGraph();
+		m_Version = graph.GetVersion();
+		m_TopologyVersion = graph.GetTopologyVersion();
+
+		UseOwnArrays();
+		LinkTwins();
+	}
+
+	inline void GraphCSR::BuildTransposed(const GraphCSR& other)
+	{
+		const int nrOfNodes = other.GetNrOfNodes();
+		const int nrOfArcs = other.GetNrOfArcs();
+
+		// Counting sort of the arcs on their target
+		m_Offsets.assign(nrOfNodes + 1, 0);
+		for (int arc = 0; arc < nrOfArcs; ++arc)
+			++m_Offsets[other.m_pTargets[arc] + 1];
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+			m_Offsets[idx + 1] += m_Offsets[idx];
+
+		m_Targets.resize(nrOfArcs);
+		m_Costs.resize(nrOfArcs);
+		std::vector<int> cursors(m_Offsets.begin(), m_Offsets.end() - 1);
+		for (int from = 0; from < nrOfNodes; ++from)
+		{
+			for (int arc = other.GetFirstArc(from); arc < other.GetLastArc(from); ++arc)
+			{
+				const int reversedArc = cursors[other.m_pTargets[arc]]++;
+				m_Targets[reversedArc] = from;
+				m_Costs[reversedArc] = other.m_pCosts[arc];
+			}
+		}
+
+		m_Positions.assign(other.m_pPositions, other.m_pPositions + nrOfNodes);
+		m_Valid.assign(other.m_pValid, other.m_pValid + nrOfNodes);
+		m_NrOfActiveNodes = other.m_NrOfActiveNodes;
+		m_IsDirectionalGraph = other.m_IsDirectionalGraph;
+		m_Version = other.m_Version;
+		m_TopologyVersion = other.m_TopologyVersion;
+
+		UseOwnArrays();
+		LinkTwins();
+	}
+
+	inline GraphCSR& GraphCSR::operator=(const GraphCSR& other)
+	{
+		if (this == &other)
+			return *this;
+
+		m_Offsets = other.m_Offsets;
+		m_Targets = other.m_Targets;
+		m_Costs = other.m_Costs;
+		m_Twins = other.m_Twins;
+		m_Positions = other.m_Positions;
+		m_Valid = other.m_Valid;
+		m_NrOfActiveNodes = other.m_NrOfActiveNodes;
+		m_IsDirectionalGraph = other.m_IsDirectionalGraph;
+		m_Version = other.m_Version;
+		m_TopologyVersion = other.m_TopologyVersion;
+
+		// A copy of a file snapshot reads the same file, a copy of a built one its own arrays
+		if (other.m_IsFileSnapshot)
+		{
+			m_pOffsets = other.m_pOffsets;
+			m_pTargets = other.m_pTargets;
+			m_pCosts = other.m_pCosts;
+			m_pPositions = other.m_pPositions;
+			m_pValid = other.m_pValid;
+			m_NrOfNodes = other.m_NrOfNodes;
+			m_NrOfArcs = other.m_NrOfArcs;
+			m_IsFileSnapshot = true;
+		}
+		else
+		{
+			UseOwnArrays();
+		}
+		return *this;
+	}
+
+	inline int GraphCSR::FindArc(int from, int to) const
+	{
+		for (int arc = m_pOffsets[from]; arc < m_pOffsets[from + 1]; ++arc)
+		{
+			if (m_pTargets[arc] == to)
+				return arc;
+		}
+
+		return invalid_arc_index;
+	}
+
+	inline uint32_t GraphCSR::GetFingerprint() const
+	{
+		// FNV-1a
+		uint32_t hash = 2166136261u;
+		auto add = [&hash](const void* pData, size_t size)
+		{
+			const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+			for (size_t i = 0; i < size; ++i)
+				hash = (hash ^ pBytes[i]) * 16777619u;
+		};
+
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
+		{
+			const uint8_t isValid = IsNodeValid(idx) ? 1 : 0;
+			const int32_t degree = GetDegree(idx);
+			add(&isValid, sizeof(isValid));
+			add(&degree, sizeof(degree));
+		}
+
+		for (int arc = 0; arc < GetNrOfArcs(); ++arc)
+		{
+			const int32_t target = m_pTargets[arc];
+			const float cost = m_pCosts[arc];
+			add(&target, sizeof(target));
+			add(&cost, sizeof(cost));
+		}
+		return hash;
+	}
+
+	inline void GraphCSR::UseOwnArrays()
+	{
+		static_assert(sizeof(int) == sizeof(int32_t), "the arrays of a graph file are read as the arrays of a snapshot");
+
+		m_pOffsets = reinterpret_cast<const int32_t*>(m_Offsets.data());
+		m_pTargets = reinterpret_cast<const int32_t*>(m_Targets.data());
+		m_pCosts = m_Costs.data();
+		m_pPositions = m_Positions.data();
+		m_pValid = m_Valid.data();
+		m_NrOfNodes = int(m_Valid.size());
+		m_NrOfArcs = int(m_Targets.size());
+		m_IsFileSnapshot = false;
+	}
+
+	inline void GraphCSR::LinkTwins()
+	{
+		if (m_IsDirectionalGraph)
+		{
+			m_Twins.clear();
+			return;
+		}
+
+		const int nrOfNodes = GetNrOfNodes();
+		m_Twins.assign(m_Targets.size(), invalid_arc_index);
+
+		// Counting sort of the arcs on their target: the arcs arriving at every node, in order of their source
+		std::vector<int> incomingOffsets(nrOfNodes + 1, 0);
+		for (int target : m_Targets)
+			++incomingOffsets[target + 1];
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+			incomingOffsets[idx + 1] += incomingOffsets[idx];
+
+		std::vector<int> incomingArcs(m_Targets.size());
+		std::vector<int> incomingCursors(incomingOffsets.begin(), incomingOffsets.end() - 1);
+		for (int from = 0; from < nrOfNodes; ++from)
+		{
+			for (int arc = m_Offsets[from]; arc < m_Offsets[from + 1]; ++arc)
+				incomingArcs[incomingCursors[m_Targets[arc]]++] = arc;
+		}
+
+		// The twin of arc (to -> neighbor) is the arc arriving at 'to' from 'neighbor', found with a binary search
+		std::vector<int> sources(m_Targets.size());
+		for (int from = 0; from < nrOfNodes; ++from)
+		{
+			for (int arc = m_Offsets[from]; arc < m_Offsets[from + 1]; ++arc)
+				sources[arc] = from;
+		}
+
+		for (int to = 0; to < nrOfNodes; ++to)
+		{
+			auto firstIncoming = incomingArcs.begin() + incomingOffsets[to];
+			auto lastIncoming = incomingArcs.begin() + incomingOffsets[to + 1];
+
+			for (int arc = m_Offsets[to]; arc < m_Offsets[to + 1]; ++arc)
+			{
+				const int neighbor = m_Targets[arc];
+				auto foundIt = std::lower_bound(firstIncoming, lastIncoming, neighbor,
+					[&sources](int incomingArc, int source) { return sources[incomingArc] < source; });
+
+				if (foundIt != lastIncoming && sources[*foundIt] == neighbor)
+					m_Twins[arc] = *foundIt;
+			}
+		}
+	}
+}
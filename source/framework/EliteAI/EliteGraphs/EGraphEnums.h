@@ -5,6 +5,9 @@ enum
 	invalid_node_index = -1
 };
 
+// Connections with a cost of this value or more are considered blocked (see TerrainType::Water)
+const float ISOLATED_CONNECTION_COST{ 100000.f };
+
 
 enum class TerrainType : int
 {
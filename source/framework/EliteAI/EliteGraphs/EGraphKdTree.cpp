@@ -0,0 +1,46 @@
+#include "stdafx.h"
+#include "EGraphKdTree.h"
+
+using namespace Elite;
+
+void GraphKdTree::Build(const std::vector<int>& indices, const std::vector<Vector2>& positions)
+{
+	m_Entries.clear();
+	m_Entries.reserve(indices.size());
+	for (int idx : indices)
+		m_Entries.push_back(Entry{ positions[idx], idx, 0 });
+
+	BuildRange(0, GetNrOfNodes());
+}
+
+int GraphKdTree::FindNearest(const Vector2& pos, float maxDistance) const
+{
+	return FindNearest(pos, [](int) { return true; }, maxDistance);
+}
+
+void GraphKdTree::BuildRange(int begin, int end)
+{
+	while (end - begin > 1)
+	{
+		// Split on the axis along which the range is widest, at the median
+		Vector2 min{ FLT_MAX, FLT_MAX };
+		Vector2 max{ -FLT_MAX, -FLT_MAX };
+		for (int i = begin; i < end; ++i)
+		{
+			min.x = std::min(min.x, m_Entries[i].pos.x);
+			min.y = std::min(min.y, m_Entries[i].pos.y);
+			max.x = std::max(max.x, m_Entries[i].pos.x);
+			max.y = std::max(max.y, m_Entries[i].pos.y);
+		}
+		const int axis = max.x - min.x >= max.y - min.y ? 0 : 1;
+
+		const int middle = begin + (end - begin) / 2;
+		std::nth_element(m_Entries.begin() + begin, m_Entries.begin() + middle, m_Entries.begin() + end,
+			[axis](const Entry& a, const Entry& b) { return axis == 0 ? a.pos.x < b.pos.x : a.pos.y < b.pos.y; });
+		m_Entries[middle].axis = axis;
+
+		// First half as a call, the second one as a loop
+		BuildRange(begin, middle);
+		begin = middle + 1;
+	}
+}
@@ -0,0 +1,88 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphKdTree.h: Static 2D k-d tree over node positions, to find the nearest node to any position.
+// The tree is stored as a single array: the entry in the middle of a range splits it, the ranges
+// before and after it are its subtrees. It is rebuilt from scratch, not updated.
+/*=============================================================================*/
+#pragma once
+
+#include "EGraphEnums.h"
+
+namespace Elite
+{
+	class GraphKdTree final
+	{
+	public:
+		GraphKdTree() = default;
+
+		// positions are indexed by node index, only the nodes in indices are inserted
+		void Build(const std::vector<int>& indices, const std::vector<Vector2>& positions);
+		void Clear() { m_Entries.clear(); }
+
+		int GetNrOfNodes() const { return int(m_Entries.size()); }
+
+		// Nearest node within maxDistance, invalid_node_index if there is none
+		int FindNearest(const Vector2& pos, float maxDistance = FLT_MAX) const;
+		// Nearest node for which isAccepted(int idx) returns true, invalid_node_index if there is none
+		template<typename T_Predicate>
+		int FindNearest(const Vector2& pos, T_Predicate isAccepted, float maxDistance = FLT_MAX) const;
+
+	private:
+		struct Entry
+		{
+			Vector2 pos;
+			int idx;
+			int axis; // 0 splits on x, 1 on y
+		};
+
+		std::vector<Entry> m_Entries;
+
+		void BuildRange(int begin, int end);
+		template<typename T_Predicate>
+		void FindNearest(int begin, int end, const Vector2& pos, T_Predicate& isAccepted, int& nearestIdx, float& nearestDistanceSquared) const;
+	};
+
+	template<typename T_Predicate>
+	inline int GraphKdTree::FindNearest(const Vector2& pos, T_Predicate isAccepted, float maxDistance) const
+	{
+		int nearestIdx = invalid_node_index;
+		float nearestDistanceSquared = maxDistance == FLT_MAX ? FLT_MAX : maxDistance * maxDistance;
+		FindNearest(0, GetNrOfNodes(), pos, isAccepted, nearestIdx, nearestDistanceSquared);
+		return nearestIdx;
+	}
+
+	template<typename T_Predicate>
+	inline void GraphKdTree::FindNearest(int begin, int end, const Vector2& pos, T_Predicate& isAccepted, int& nearestIdx, float& nearestDistanceSquared) const
+	{
+		while (begin < end)
+		{
+			const int middle = begin + (end - begin) / 2;
+			const Entry& entry = m_Entries[middle];
+
+			const float distanceSquared = (entry.pos - pos).MagnitudeSquared();
+			if (distanceSquared < nearestDistanceSquared && isAccepted(entry.idx))
+			{
+				nearestIdx = entry.idx;
+				nearestDistanceSquared = distanceSquared;
+			}
+
+			// The side of the position first, the other side only if the splitting line is closer than the nearest so far
+			const float offset = entry.axis == 0 ? pos.x - entry.pos.x : pos.y - entry.pos.y;
+			const bool isBefore = offset < 0.f;
+			if (isBefore)
+				FindNearest(begin, middle, pos, isAccepted, nearestIdx, nearestDistanceSquared);
+			else
+				FindNearest(middle + 1, end, pos, isAccepted, nearestIdx, nearestDistanceSquared);
+
+			if (offset * offset >= nearestDistanceSquared)
+				return;
+
+			// Other side as a loop instead of a call
+			if (isBefore)
+				begin = middle + 1;
+			else
+				end = middle;
+		}
+	}
+}
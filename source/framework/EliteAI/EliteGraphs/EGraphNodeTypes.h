@@ -50,6 +50,27 @@ namespace Elite
 	};
 
 
+	// Terrain helpers, shared by every grid type that stores terrain (GridTerrainNode, ImplicitGridGraph)
+	inline Elite::Color GetTerrainColor(TerrainType terrain)
+	{
+		switch (terrain)
+		{
+		case TerrainType::Mud:
+			return MUD_NODE_COLOR;
+		case TerrainType::Water:
+			return WATER_NODE_COLOR;
+		default:
+			return GROUND_NODE_COLOR;
+		}
+	}
+
+	// Scales the base (straight/diagonal) cost with the average terrain value of both cells
+	// Connections with a cost of ISOLATED_CONNECTION_COST or more are never created
+	inline float GetTerrainConnectionCost(float baseCost, TerrainType fromTerrain, TerrainType toTerrain)
+	{
+		return baseCost * (int(fromTerrain) + int(toTerrain)) / 2.0f;
+	}
+
 	class GridTerrainNode : public GraphNode
 	{
 	public:
@@ -62,21 +83,7 @@ namespace Elite
 
 		TerrainType GetTerrainType() const { return m_Terrain; }
 		void SetTerrainType(TerrainType terrain) { m_Terrain = terrain; }
-		Elite::Color GetColor() const 
-		{
-			switch (m_Terrain)
-			{
-			case TerrainType::Mud:
-				return MUD_NODE_COLOR;
-				break;
-			case TerrainType::Water:
-				return WATER_NODE_COLOR;
-				break;
-			default:
-				return GROUND_NODE_COLOR;
-				break;
-			}
-		}
+		Elite::Color GetColor() const { return GetTerrainColor(m_Terrain); }
 		
 
 	protected:
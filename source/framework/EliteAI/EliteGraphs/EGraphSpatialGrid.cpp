@@ -0,0 +1,187 @@
+#include "stdafx.h"
+#include "EGraphSpatialGrid.h"
+
+using namespace Elite;
+
+GraphSpatialGrid::GraphSpatialGrid(float cellSize)
+	: m_CellSize(cellSize)
+{
+}
+
+void GraphSpatialGrid::Clear()
+{
+	m_Cells.clear();
+	m_NodeCells.clear();
+	m_IsNodeInserted.clear();
+	m_NodeConnections.clear();
+	m_Connections.clear();
+	m_FreeConnectionIds.clear();
+	m_ConnectionIds.clear();
+	m_CoarseCells.clear();
+	m_OversizedConnections.clear();
+	m_TotalConnectionLength = 0.0;
+}
+
+void GraphSpatialGrid::SetCellSize(float cellSize)
+{
+	assert(cellSize > 0.f && "GraphSpatialGrid::SetCellSize: cell size must be positive");
+	Clear();
+	m_CellSize = cellSize;
+}
+
+void GraphSpatialGrid::InsertNode(int idx, const Vector2& pos)
+{
+	EnsureNodeCapacity(idx);
+
+	const uint64_t cellKey = GetCellKey(GetCellCoordinate(pos.x), GetCellCoordinate(pos.y));
+	if (m_IsNodeInserted[idx])
+	{
+		if (m_NodeCells[idx] == cellKey)
+			return;
+
+		RemoveNodeFromCell(idx);
+	}
+
+	m_Cells[cellKey].nodes.push_back(idx);
+	m_NodeCells[idx] = cellKey;
+	m_IsNodeInserted[idx] = true;
+}
+
+void GraphSpatialGrid::RemoveNode(int idx)
+{
+	if (idx >= (int)m_IsNodeInserted.size() || !m_IsNodeInserted[idx])
+		return;
+
+	RemoveNodeFromCell(idx);
+	m_IsNodeInserted[idx] = false;
+
+	while (!m_NodeConnections[idx].empty())
+		RemoveConnectionById(m_NodeConnections[idx].back());
+}
+
+void GraphSpatialGrid::InsertConnection(int from, int to, const Vector2& fromPos, const Vector2& toPos)
+{
+	// Moving a connection is done by removing it first, the cells it passes through can change in any way
+	RemoveConnection(from, to);
+
+	ConnectionEntry entry{};
+	entry.from = from;
+	entry.to = to;
+	entry.fromPos = fromPos;
+	entry.toPos = toPos;
+	entry.length = Distance(fromPos, toPos);
+	if (GetNrOfCellsOnSegment(fromPos, toPos, m_CellSize) <= m_MaxCellsPerConnection)
+		entry.level = 0;
+	else if (GetNrOfCellsOnSegment(fromPos, toPos, m_CellSize * m_CoarseCellFactor) <= m_MaxCellsPerConnection)
+		entry.level = 1;
+	else
+		entry.level = 2;
+	m_TotalConnectionLength += entry.length;
+
+	int id = 0;
+	if (m_FreeConnectionIds.empty())
+	{
+		id = int(m_Connections.size());
+		m_Connections.push_back(entry);
+	}
+	else
+	{
+		id = m_FreeConnectionIds.back();
+		m_FreeConnectionIds.pop_back();
+		m_Connections[id] = entry;
+	}
+
+	m_ConnectionIds[GetConnectionKey(from, to)] = id;
+
+	EnsureNodeCapacity(std::max(from, to));
+	m_NodeConnections[from].push_back(id);
+	m_NodeConnections[to].push_back(id);
+
+	if (entry.level == 0)
+		ForEachCellOnSegment(fromPos, toPos, m_CellSize, [this, id](int x, int y) { m_Cells[GetCellKey(x, y)].connections.push_back(id); });
+	else if (entry.level == 1)
+		ForEachCellOnSegment(fromPos, toPos, m_CellSize * m_CoarseCellFactor, [this, id](int x, int y) { m_CoarseCells[GetCellKey(x, y)].push_back(id); });
+	else
+		m_OversizedConnections.push_back(id);
+}
+
+void GraphSpatialGrid::RemoveConnection(int from, int to)
+{
+	auto foundIt = m_ConnectionIds.find(GetConnectionKey(from, to));
+	if (foundIt != m_ConnectionIds.end())
+		RemoveConnectionById(foundIt->second);
+}
+
+void GraphSpatialGrid::EnsureNodeCapacity(int idx)
+{
+	if (idx < (int)m_IsNodeInserted.size())
+		return;
+
+	m_NodeCells.resize(idx + 1, 0);
+	m_IsNodeInserted.resize(idx + 1, false);
+	m_NodeConnections.resize(idx + 1);
+}
+
+void GraphSpatialGrid::RemoveNodeFromCell(int idx)
+{
+	auto cellIt = m_Cells.find(m_NodeCells[idx]);
+	EraseValue(cellIt->second.nodes, idx);
+	if (cellIt->second.connections.empty() && cellIt->second.nodes.empty())
+		m_Cells.erase(cellIt);
+}
+
+void GraphSpatialGrid::RemoveConnectionById(int id)
+{
+	const ConnectionEntry& entry = m_Connections[id];
+
+	if (entry.level == 0)
+	{
+		ForEachCellOnSegment(entry.fromPos, entry.toPos, m_CellSize, [this, id](int x, int y)
+		{
+			// Drop cells that became empty, otherwise dragging a node around leaves a trail of them
+			auto cellIt = m_Cells.find(GetCellKey(x, y));
+			EraseValue(cellIt->second.connections, id);
+			if (cellIt->second.connections.empty() && cellIt->second.nodes.empty())
+				m_Cells.erase(cellIt);
+		});
+	}
+	else if (entry.level == 1)
+	{
+		ForEachCellOnSegment(entry.fromPos, entry.toPos, m_CellSize * m_CoarseCellFactor, [this, id](int x, int y)
+		{
+			auto cellIt = m_CoarseCells.find(GetCellKey(x, y));
+			EraseValue(cellIt->second, id);
+			if (cellIt->second.empty())
+				m_CoarseCells.erase(cellIt);
+		});
+	}
+	else
+	{
+		EraseValue(m_OversizedConnections, id);
+	}
+
+	m_TotalConnectionLength -= entry.length;
+
+	EraseValue(m_NodeConnections[entry.from], id);
+	EraseValue(m_NodeConnections[entry.to], id);
+	m_ConnectionIds.erase(GetConnectionKey(entry.from, entry.to));
+	m_FreeConnectionIds.push_back(id);
+}
+
+int GraphSpatialGrid::GetNrOfCellsOnSegment(const Vector2& fromPos, const Vector2& toPos, float cellSize)
+{
+	// The walk steps one cell at a time, either horizontally or vertically
+	return abs(GetCellCoordinate(toPos.x, cellSize) - GetCellCoordinate(fromPos.x, cellSize))
+		+ abs(GetCellCoordinate(toPos.y, cellSize) - GetCellCoordinate(fromPos.y, cellSize)) + 1;
+}
+
+void GraphSpatialGrid::EraseValue(std::vector<int>& values, int value)
+{
+	// Order doesn't matter, swap with the last element
+	auto foundIt = std::find(values.begin(), values.end(), value);
+	if (foundIt == values.end())
+		return;
+
+	*foundIt = values.back();
+	values.pop_back();
+}
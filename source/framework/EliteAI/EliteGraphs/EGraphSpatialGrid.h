@@ -0,0 +1,234 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphSpatialGrid.h: Uniform grid over node positions and the cells every connection passes through,
+// used by Graph2D to find the nodes and connections near a position without visiting all of them.
+// Only the cells that contain something are stored, so the grid has no bounds.
+// The owner picks the cell size, GetAverageConnectionLength tells it when the current one no longer fits.
+// Connections too long for the cells go into a coarser grid, only the extreme ones into a list every query visits.
+/*=============================================================================*/
+#pragma once
+
+#include <climits>
+#include <cstdint>
+#include <unordered_map>
+
+namespace Elite
+{
+	class GraphSpatialGrid final
+	{
+	public:
+		explicit GraphSpatialGrid(float cellSize = 10.f);
+
+		void Clear();
+		float GetCellSize() const { return m_CellSize; }
+		// Changing the cell size clears the grid, the owner inserts everything again
+		void SetCellSize(float cellSize);
+		// Average length of the connections in the grid, 0 without connections
+		float GetAverageConnectionLength() const { return m_Connections.size() > m_FreeConnectionIds.size() ? float(m_TotalConnectionLength / double(m_Connections.size() - m_FreeConnectionIds.size())) : 0.f; }
+
+		// Inserting a node or connection that is already in the grid moves it
+		// Removing a node also removes the connections to and from it
+		void InsertNode(int idx, const Vector2& pos);
+		void RemoveNode(int idx);
+		void InsertConnection(int from, int to, const Vector2& fromPos, const Vector2& toPos);
+		void RemoveConnection(int from, int to);
+
+		// Calls func(int idx) for every node in the cells overlapping the circle, the caller checks the actual distance
+		template<typename T_Func>
+		void ForEachNodeNear(const Vector2& pos, float radius, T_Func func) const { ForEachNodeInRect(pos - Vector2{ radius, radius }, pos + Vector2{ radius, radius }, func); }
+		// Calls func(int from, int to) once for every connection passing through the cells overlapping the circle
+		template<typename T_Func>
+		void ForEachConnectionNear(const Vector2& pos, float radius, T_Func func) const { ForEachConnectionInRect(pos - Vector2{ radius, radius }, pos + Vector2{ radius, radius }, func); }
+		// Same for the cells overlapping the rectangle [lower, upper]
+		template<typename T_Func>
+		void ForEachNodeInRect(const Vector2& lower, const Vector2& upper, T_Func func) const;
+		template<typename T_Func>
+		void ForEachConnectionInRect(const Vector2& lower, const Vector2& upper, T_Func func) const;
+		// Calls func(int from, int to) for every connection stored for this node
+		template<typename T_Func>
+		void ForEachConnectionOfNode(int idx, T_Func func) const;
+
+	private:
+		struct Cell
+		{
+			std::vector<int> nodes;
+			std::vector<int> connections; // ids in m_Connections
+		};
+
+		struct ConnectionEntry
+		{
+			int from;
+			int to;
+			Vector2 fromPos; // the covered cells are walked again from these on removal
+			Vector2 toPos;
+			float length;
+			int level; // 0: in m_Cells, 1: in m_CoarseCells, 2: in m_OversizedConnections
+		};
+
+		// Connections passing through more cells than this go one level up
+		static const int m_MaxCellsPerConnection = 256;
+		static const int m_CoarseCellFactor = 16;
+
+		float m_CellSize;
+		double m_TotalConnectionLength = 0.0;
+		std::unordered_map<uint64_t, Cell> m_Cells;
+		std::unordered_map<uint64_t, std::vector<int>> m_CoarseCells; // connection ids, cells m_CoarseCellFactor times larger
+
+		std::vector<uint64_t> m_NodeCells;
+		std::vector<bool> m_IsNodeInserted;
+		std::vector<std::vector<int>> m_NodeConnections; // ids of the connections to and from every node
+
+		std::vector<ConnectionEntry> m_Connections;
+		std::vector<int> m_FreeConnectionIds;
+		std::unordered_map<uint64_t, int> m_ConnectionIds;
+		std::vector<int> m_OversizedConnections;
+
+		// A connection passes through several cells, the stamp of the current query marks the ones already visited
+		mutable std::vector<unsigned int> m_ConnectionVisitStamps;
+		mutable unsigned int m_VisitStamp = 0;
+
+		int GetCellCoordinate(float value) const { return int(floorf(value / m_CellSize)); }
+		static int GetCellCoordinate(float value, float cellSize) { return int(floorf(value / cellSize)); }
+		static uint64_t GetCellKey(int x, int y) { return (uint64_t(uint32_t(x)) << 32) | uint64_t(uint32_t(y)); }
+		static uint64_t GetConnectionKey(int from, int to) { return (uint64_t(uint32_t(from)) << 32) | uint64_t(uint32_t(to)); }
+
+		void EnsureNodeCapacity(int idx);
+		void RemoveNodeFromCell(int idx);
+		void RemoveConnectionById(int id);
+		// Calls func(const T_Cell&) for every stored cell overlapping the rectangle,
+		// going over the stored cells instead when the rectangle covers more cells than there are
+		template<typename T_Cell, typename T_Func>
+		static void ForEachCellInRect(const std::unordered_map<uint64_t, T_Cell>& cells, float cellSize, const Vector2& lower, const Vector2& upper, T_Func func);
+		static int GetNrOfCellsOnSegment(const Vector2& fromPos, const Vector2& toPos, float cellSize);
+		template<typename T_Func>
+		static void ForEachCellOnSegment(const Vector2& fromPos, const Vector2& toPos, float cellSize, T_Func func);
+		static void EraseValue(std::vector<int>& values, int value);
+	};
+
+	template<typename T_Func>
+	inline void GraphSpatialGrid::ForEachNodeInRect(const Vector2& lower, const Vector2& upper, T_Func func) const
+	{
+		ForEachCellInRect(m_Cells, m_CellSize, lower, upper, [&func](const Cell& cell)
+		{
+			for (int idx : cell.nodes)
+				func(idx);
+		});
+	}
+
+	template<typename T_Func>
+	inline void GraphSpatialGrid::ForEachConnectionInRect(const Vector2& lower, const Vector2& upper, T_Func func) const
+	{
+		if (m_ConnectionVisitStamps.size() < m_Connections.size())
+			m_ConnectionVisitStamps.resize(m_Connections.size(), 0);
+		if (++m_VisitStamp == 0)
+		{
+			std::fill(m_ConnectionVisitStamps.begin(), m_ConnectionVisitStamps.end(), 0);
+			m_VisitStamp = 1;
+		}
+
+		auto visit = [this, &func](int id)
+		{
+			if (m_ConnectionVisitStamps[id] == m_VisitStamp)
+				return;
+
+			m_ConnectionVisitStamps[id] = m_VisitStamp;
+			func(m_Connections[id].from, m_Connections[id].to);
+		};
+
+		ForEachCellInRect(m_Cells, m_CellSize, lower, upper, [&visit](const Cell& cell)
+		{
+			for (int id : cell.connections)
+				visit(id);
+		});
+
+		ForEachCellInRect(m_CoarseCells, m_CellSize * m_CoarseCellFactor, lower, upper, [&visit](const std::vector<int>& connections)
+		{
+			for (int id : connections)
+				visit(id);
+		});
+
+		for (int id : m_OversizedConnections)
+			visit(id);
+	}
+
+	template<typename T_Cell, typename T_Func>
+	inline void GraphSpatialGrid::ForEachCellInRect(const std::unordered_map<uint64_t, T_Cell>& cells, float cellSize, const Vector2& lower, const Vector2& upper, T_Func func)
+	{
+		// Clamped in float first, the rectangle can be unbounded (e.g. everything in view without a camera)
+		auto toCell = [cellSize](float coordinate) { return int(Clamp(floorf(coordinate / cellSize), float(INT_MIN / 2), float(INT_MAX / 2))); };
+		const int minX = toCell(lower.x);
+		const int maxX = toCell(upper.x);
+		const int minY = toCell(lower.y);
+		const int maxY = toCell(upper.y);
+
+		if (int64_t(maxX - minX + 1) * int64_t(maxY - minY + 1) > int64_t(cells.size()))
+		{
+			for (const auto& cell : cells)
+			{
+				const int x = int(uint32_t(cell.first >> 32));
+				const int y = int(uint32_t(cell.first));
+				if (x >= minX && x <= maxX && y >= minY && y <= maxY)
+					func(cell.second);
+			}
+			return;
+		}
+
+		for (int y = minY; y <= maxY; ++y)
+		{
+			for (int x = minX; x <= maxX; ++x)
+			{
+				auto foundIt = cells.find(GetCellKey(x, y));
+				if (foundIt != cells.end())
+					func(foundIt->second);
+			}
+		}
+	}
+
+	template<typename T_Func>
+	inline void GraphSpatialGrid::ForEachCellOnSegment(const Vector2& fromPos, const Vector2& toPos, float cellSize, T_Func func)
+	{
+		// Walks the cells the segment passes through in order (Amanatides & Woo),
+		// stepping on the axis whose next cell border is closest and always ending in the cell of toPos
+		int x = GetCellCoordinate(fromPos.x, cellSize);
+		int y = GetCellCoordinate(fromPos.y, cellSize);
+		const int endX = GetCellCoordinate(toPos.x, cellSize);
+		const int endY = GetCellCoordinate(toPos.y, cellSize);
+
+		const Vector2 direction = toPos - fromPos;
+		const int stepX = direction.x >= 0.f ? 1 : -1;
+		const int stepY = direction.y >= 0.f ? 1 : -1;
+		const float tDeltaX = direction.x != 0.f ? cellSize / fabsf(direction.x) : FLT_MAX;
+		const float tDeltaY = direction.y != 0.f ? cellSize / fabsf(direction.y) : FLT_MAX;
+		float tMaxX = direction.x != 0.f ? ((stepX > 0 ? (x + 1) * cellSize - fromPos.x : fromPos.x - x * cellSize) / fabsf(direction.x)) : FLT_MAX;
+		float tMaxY = direction.y != 0.f ? ((stepY > 0 ? (y + 1) * cellSize - fromPos.y : fromPos.y - y * cellSize) / fabsf(direction.y)) : FLT_MAX;
+
+		for (int remaining = abs(endX - x) + abs(endY - y); ; --remaining)
+		{
+			func(x, y);
+			if (remaining == 0)
+				break;
+
+			if (y == endY || (x != endX && tMaxX < tMaxY))
+			{
+				x += stepX;
+				tMaxX += tDeltaX;
+			}
+			else
+			{
+				y += stepY;
+				tMaxY += tDeltaY;
+			}
+		}
+	}
+
+	template<typename T_Func>
+	inline void GraphSpatialGrid::ForEachConnectionOfNode(int idx, T_Func func) const
+	{
+		if (idx >= (int)m_NodeConnections.size())
+			return;
+
+		for (int id : m_NodeConnections[idx])
+			func(m_Connections[id].from, m_Connections[id].to);
+	}
+}
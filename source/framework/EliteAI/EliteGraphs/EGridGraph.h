@@ -9,16 +9,35 @@
 #include "EIGraph.h"
 #include "EGraphConnectionTypes.h"
 #include "EGraphNodeTypes.h"
+#include "framework\EliteHelpers\EThreadPool.h"
 
 namespace Elite
 {
-	template<class T_NodeType, class T_ConnectionType>
-	class GridGraph : public IGraph<T_NodeType, T_ConnectionType>
+	// Cost of the connection between two cells, for every allocator of a grid of that node type
+	template<class T_NodeType>
+	inline float GetCellConnectionCost(float baseCost, const T_NodeType*, const T_NodeType*)
+	{
+		return baseCost;
+	}
+
+	inline float GetCellConnectionCost(float baseCost, const GridTerrainNode* pFromNode, const GridTerrainNode* pToNode)
+	{
+		return GetTerrainConnectionCost(baseCost, pFromNode->GetTerrainType(), pToNode->GetTerrainType());
+	}
+
+	// T_Allocator: allocation policy of the nodes and connections, forwarded to IGraph (see EGraphAllocators.h)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator = GraphPoolAllocator>
+	class GridGraph : public IGraph<T_NodeType, T_ConnectionType, T_Allocator>
 	{
 	public:
 		GridGraph(bool isDirectional);
-		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
-		void InitializeGrid(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
+		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5, ThreadPool* pThreadPool = nullptr);
+		// Builds the grid in bands of rows, in parallel when there is a thread pool. A graph that isn't empty is cleared first
+		void InitializeGrid(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5, ThreadPool* pThreadPool = nullptr);
+		// Same grid, with the connections of a snapshot (GraphCSR, also one of a graph file, see EGraphFile.h) instead of generated ones
+		// Built in one go like the generated grid, the snapshot decides if the graph is directional
+		template<class T_Snapshot>
+		void InitializeGrid(int columns, int rows, int cellSize, bool isConnectedDiagonally, float costStraight, float costDiagonal, const T_Snapshot& snapshot);
 
 		using IGraph::GetNode;
 		T_NodeType* GetNode(int col, int row) const { return m_Nodes[GetIndex(col, row)]; }
@@ -27,6 +46,10 @@ namespace Elite
 
 		int GetRows() const { return m_NrOfRows; }
 		int GetColumns() const { return m_NrOfColumns; }
+		int GetCellSize() const { return m_CellSize; }
+		bool IsConnectedDiagonally() const { return m_IsConnectedDiagonally; }
+		float GetDefaultCostStraight() const { return m_DefaultCostStraight; }
+		float GetDefaultCostDiagonal() const { return m_DefaultCostDiagonal; }
 
 		bool IsWithinBounds(int col, int row) const;
 		int GetIndex(int col, int row) const { return row * m_NrOfColumns + col; }
@@ -44,6 +67,11 @@ namespace Elite
 
 		void AddConnectionsToAdjacentCells(int col, int row);
 		void AddConnectionsToAdjacentCells(int idx);
+
+	protected:
+		// idx == row * columns + col
+		bool HasFixedNodeIndices() const override { return true; }
+
 	private:
 		
 		int m_NrOfColumns;
@@ -58,15 +86,18 @@ namespace Elite
 		const std::vector<Vector2> m_DiagonalDirections = { { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
 
 		// graph creation helper functions
-		void AddConnectionsInDirections(int idx, int col, int row, std::vector<Vector2> directions);
+		void AddConnectionsInDirections(int idx, int col, int row, const std::vector<Vector2>& directions);
+		// Connections of a node that was just created in InitializeGrid, without checking for existing connections
+		template<class T_Range>
+		void CreateConnectionsInDirections(int idx, int col, int row, const std::vector<Vector2>& directions, const T_Range& range, size_t& slot);
 
 		float CalculateConnectionCost(int fromIdx, int toIdx) const;
 	
 		friend class GraphRenderer;
 	};
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline GridGraph<T_NodeType, T_ConnectionType>::GridGraph(bool isDirectional)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GridGraph(bool isDirectional)
 		: IGraph(isDirectional)
 		, m_NrOfColumns(0)
 		, m_NrOfRows(0)
@@ -77,15 +108,16 @@ namespace Elite
 	{
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	GridGraph<T_NodeType, T_ConnectionType>::GridGraph(
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GridGraph(
 		int columns,
 		int rows, 
 		int cellSize, 
 		bool isDirectionalGraph, 
 		bool isConnectedDiagonally, 
 		float costStraight /* = 1.f*/, 
-		float costDiagonal /* = 1.5f */)
+		float costDiagonal /* = 1.5f */,
+		ThreadPool* pThreadPool /* = nullptr */)
 		: IGraph(isDirectionalGraph)
 		, m_NrOfColumns(columns)
 		, m_NrOfRows(rows)
@@ -94,19 +126,23 @@ namespace Elite
 		, m_DefaultCostStraight(costStraight)
 		, m_DefaultCostDiagonal(costDiagonal)
 	{
-		InitializeGrid(columns, rows, cellSize, isDirectionalGraph, isConnectedDiagonally, costStraight, costDiagonal);
+		InitializeGrid(columns, rows, cellSize, isDirectionalGraph, isConnectedDiagonally, costStraight, costDiagonal, pThreadPool);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void GridGraph<T_NodeType, T_ConnectionType>::InitializeGrid(
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::InitializeGrid(
 		int columns, 
 		int rows, 
 		int cellSize, 
 		bool isDirectionalGraph,
 		bool isConnectedDiagonally, 
 		float costStraight /* = 1.f*/,
-		float costDiagonal /* = 1.5f */)
+		float costDiagonal /* = 1.5f */,
+		ThreadPool* pThreadPool /* = nullptr */)
 	{
+		if (!IsEmpty())
+			Clear();
+
 		m_IsDirectionalGraph = isDirectionalGraph;
 		m_NrOfColumns = columns;
 		m_NrOfRows = rows;
@@ -115,35 +151,90 @@ namespace Elite
 		m_DefaultCostStraight = costStraight;
 		m_DefaultCostDiagonal = costDiagonal;
 
-		// Create all nodes
-		for (auto r = 0; r < m_NrOfRows; ++r)
+		// All nodes and connections get a slot in one contiguous range up front: node idx in slot idx, its connections
+		// from slot idx * maxNrOfConnections on. Every node only writes its own slots and connection list, so bands of rows
+		// can be built at the same time. The few slots of the missing connections on the border stay unused.
+		const int nrOfNodes = m_NrOfColumns * m_NrOfRows;
+		const size_t maxNrOfConnections = m_IsConnectedDiagonally ? 8 : 4;
+		BeginBulkBuild(nrOfNodes);
+		const auto nodeRange = m_NodeAllocator.AllocateRange(nrOfNodes);
+		const auto connectionRange = m_ConnectionAllocator.AllocateRange(nrOfNodes * maxNrOfConnections);
+
+		auto createNodes = [&](int firstRow, int lastRow)
 		{
-			for (auto c = 0; c < m_NrOfColumns; ++c)
+			for (auto r = firstRow; r < lastRow; ++r)
 			{
-				int idx = GetIndex(c, r);
-				AddNode(new T_NodeType(idx));
+				for (auto c = 0; c < m_NrOfColumns; ++c)
+				{
+					int idx = GetIndex(c, r);
+					m_Nodes[idx] = m_NodeAllocator.AllocateInRange(nodeRange, idx, idx);
+				}
 			}
-		}
+		};
 
-		// Create connections in each valid direction on each node
-		for (auto r = 0; r < m_NrOfRows; ++r)
+		// The costs can depend on the neighbors, all nodes have to exist first
+		auto createConnections = [&](int firstRow, int lastRow)
 		{
-			for (auto c = 0; c < m_NrOfColumns; ++c)
+			for (auto r = firstRow; r < lastRow; ++r)
 			{
-				AddConnectionsToAdjacentCells(c, r);
+				for (auto c = 0; c < m_NrOfColumns; ++c)
+				{
+					int idx = GetIndex(c, r);
+					size_t slot = idx * maxNrOfConnections;
+					CreateConnectionsInDirections(idx, c, r, m_StraightDirections, connectionRange, slot);
+					if (m_IsConnectedDiagonally)
+						CreateConnectionsInDirections(idx, c, r, m_DiagonalDirections, connectionRange, slot);
+				}
 			}
+		};
+
+		const int rowsPerBand = 16;
+		if (pThreadPool)
+		{
+			pThreadPool->ParallelFor(m_NrOfRows, rowsPerBand, createNodes);
+			pThreadPool->ParallelFor(m_NrOfRows, rowsPerBand, createConnections);
+		}
+		else
+		{
+			createNodes(0, m_NrOfRows);
+			createConnections(0, m_NrOfRows);
 		}
+
+		EndBulkBuild();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<class T_Snapshot>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::InitializeGrid(int columns, int rows, int cellSize, bool isConnectedDiagonally, float costStraight, float costDiagonal, const T_Snapshot& snapshot)
+	{
+		assert(columns * rows == snapshot.GetNrOfNodes() && "<GridGraph::InitializeGrid>: the snapshot needs a node for every cell");
+
+		if (!IsEmpty())
+			Clear();
+
+		m_IsDirectionalGraph = snapshot.IsDirectionalGraph();
+		m_NrOfColumns = columns;
+		m_NrOfRows = rows;
+		m_CellSize = cellSize;
+		m_IsConnectedDiagonally = isConnectedDiagonally;
+		m_DefaultCostStraight = costStraight;
+		m_DefaultCostDiagonal = costDiagonal;
+
+		BulkBuild(snapshot, [this](const typename T_Allocator<T_NodeType>::Range& range, int idx)
+		{
+			return m_NodeAllocator.AllocateInRange(range, size_t(idx), idx);
+		});
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	bool GridGraph<T_NodeType, T_ConnectionType>::IsWithinBounds(int col, int row) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	bool GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::IsWithinBounds(int col, int row) const
 	{
 		return (col >= 0 && col < m_NrOfColumns && row >= 0 && row < m_NrOfRows);
 	}
 
 
-	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsToAdjacentCells(int col, int row)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddConnectionsToAdjacentCells(int col, int row)
 	{
 		int idx = GetIndex(col, row);
 
@@ -155,55 +246,61 @@ namespace Elite
 			AddConnectionsInDirections(idx, col, row, m_DiagonalDirections);
 		}
 
-		OnGraphModified(false, true);
+		NotifyGraphModified(false, true);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsToAdjacentCells(int idx)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddConnectionsToAdjacentCells(int idx)
 	{
 		auto colRow = GetNodePos(idx);
 		AddConnectionsToAdjacentCells((int)colRow.x, (int)colRow.y);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsInDirections(int idx, int col, int row, std::vector<Elite::Vector2> directions)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<class T_Range>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::CreateConnectionsInDirections(int idx, int col, int row, const std::vector<Vector2>& directions, const T_Range& range, size_t& slot)
 	{
-		for (auto d : directions)
+		// Every direction leads to another neighbor, so the connections are unique without checking
+		for (const auto& d : directions)
 		{
 			int neighborCol = col + (int)d.x;
 			int neighborRow = row + (int)d.y;
-			
-			if (IsWithinBounds(neighborCol, neighborRow)) 
+
+			if (IsWithinBounds(neighborCol, neighborRow))
 			{
 				int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-				float connectionCost = CalculateConnectionCost(idx, neighborIdx);
 
-				if (IsUniqueConnection(idx, neighborIdx) 
-					&& connectionCost < 100000) //Extra check for different terrain types
-					AddConnection(new GraphConnection(idx, neighborIdx, connectionCost));
+				// Both directions of an undirected connection get the cost from the lowest index, as when AddConnection adds them in pairs
+				float connectionCost = (m_IsDirectionalGraph || idx < neighborIdx) ? CalculateConnectionCost(idx, neighborIdx) : CalculateConnectionCost(neighborIdx, idx);
+
+				if (connectionCost < ISOLATED_CONNECTION_COST) //Extra check for different terrain types
+					m_Connections[idx].push_back(m_ConnectionAllocator.AllocateInRange(range, slot++, idx, neighborIdx, connectionCost));
 			}
 		}
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline float GridGraph<T_NodeType, T_ConnectionType>::CalculateConnectionCost(int fromIdx, int toIdx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddConnectionsInDirections(int idx, int col, int row, const std::vector<Elite::Vector2>& directions)
 	{
-		float cost = m_DefaultCostStraight;
-
-		Vector2 fromPos = GetNodePos(fromIdx);
-		Vector2 toPos = GetNodePos(toIdx);
-
-		if (int(fromPos.y) != int(toPos.y) &&
-			int(fromPos.x) != int(toPos.x))
+		for (auto d : directions)
 		{
-			cost = m_DefaultCostDiagonal;
-		}
+			int neighborCol = col + (int)d.x;
+			int neighborRow = row + (int)d.y;
+			
+			if (IsWithinBounds(neighborCol, neighborRow)) 
+			{
+				int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
+				float connectionCost = CalculateConnectionCost(idx, neighborIdx);
 
-		return cost;
+				if (IsUniqueConnection(idx, neighborIdx) 
+					&& connectionCost < ISOLATED_CONNECTION_COST) //Extra check for different terrain types
+					AddConnection(AllocateConnection(idx, neighborIdx, connectionCost));
+			}
+		}
 	}
 
-	template<>
-	inline float GridGraph<GridTerrainNode, GraphConnection>::CalculateConnectionCost(int fromIdx, int toIdx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline float GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::CalculateConnectionCost(int fromIdx, int toIdx) const
 	{
 		float cost = m_DefaultCostStraight;
 
@@ -216,13 +313,11 @@ namespace Elite
 			cost = m_DefaultCostDiagonal;
 		}
 
-		cost *= (int(GetNode(fromIdx)->GetTerrainType()) + int(GetNode(toIdx)->GetTerrainType())) / 2.0f;
-
-		return cost;
+		return GetCellConnectionCost(cost, GetNode(fromIdx), GetNode(toIdx));
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodePos(T_NodeType* pNode) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodePos(T_NodeType* pNode) const
 	{
 		auto col = pNode->GetIndex() % m_NrOfColumns;
 		auto row = pNode->GetIndex() / m_NrOfColumns;
@@ -230,22 +325,22 @@ namespace Elite
 		return Vector2{ float(col), float(row) };
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodeWorldPos(int col, int row) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeWorldPos(int col, int row) const
 	{
 		Vector2 cellCenterOffset = { m_CellSize / 2.f, m_CellSize / 2.f };
 		return Vector2{ (float)col * m_CellSize, (float)row * m_CellSize } +cellCenterOffset;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodeWorldPos(int idx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeWorldPos(int idx) const
 	{
 		auto colRow = GetNodePos(idx);
 		return GetNodeWorldPos((int)colRow.x, (int)colRow.y);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int GridGraph<T_NodeType, T_ConnectionType>::GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline int GridGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const
 	{
 		int idx = invalid_node_index;
 
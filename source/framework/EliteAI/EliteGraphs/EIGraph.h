@@ -9,11 +9,82 @@
 
 #include "EGraphNodeTypes.h"
 #include "EGraphConnectionTypes.h"
+#include "EGraphAllocators.h"
+#include <iterator>
 #include <memory>
+#include <unordered_set>
 
 namespace Elite
 {
-	template <class T_NodeType, class T_ConnectionType>
+	// Gets told about the modifications of the graphs it is added to (see IGraph::AddListener)
+	// Called in the middle of a modification, so only remember what changed and look at the graph afterwards
+	class IGraphListener
+	{
+	public:
+		virtual ~IGraphListener() = default;
+
+		virtual void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) {}
+		virtual void OnNodeModified(int idx) {}
+		virtual void OnConnectionModified(int from, int to) {}
+		// Everything was removed at once, without a call per node and connection
+		virtual void OnGraphCleared() {}
+		// Compact gave the nodes new indices, newIndices[oldIdx] is invalid_node_index for the removed ones
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) {}
+	};
+
+	// Index after IGraph::Compact, invalid_node_index for removed nodes and indices that weren't valid before
+	inline int GetRemappedNodeIndex(const std::vector<int>& newIndices, int idx)
+	{
+		return idx >= 0 && idx < int(newIndices.size()) ? newIndices[idx] : invalid_node_index;
+	}
+
+	// Nodes of a graph that weren't removed, skipped while iterating instead of copied to a new vector
+	// Only valid while no nodes are added to the graph
+	template <class T_NodeType>
+	class ActiveNodeRange final
+	{
+	public:
+		class Iterator final
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = T_NodeType*;
+			using difference_type = std::ptrdiff_t;
+			using pointer = T_NodeType* const*;
+			using reference = T_NodeType* const&;
+
+			Iterator(typename std::vector<T_NodeType*>::const_iterator current, typename std::vector<T_NodeType*>::const_iterator end)
+				: m_Current(current), m_End(end) { SkipInvalidNodes(); }
+
+			reference operator*() const { return *m_Current; }
+			Iterator& operator++() { ++m_Current; SkipInvalidNodes(); return *this; }
+			Iterator operator++(int) { Iterator previous = *this; ++(*this); return previous; }
+			bool operator==(const Iterator& other) const { return m_Current == other.m_Current; }
+			bool operator!=(const Iterator& other) const { return m_Current != other.m_Current; }
+
+		private:
+			typename std::vector<T_NodeType*>::const_iterator m_Current;
+			typename std::vector<T_NodeType*>::const_iterator m_End;
+
+			void SkipInvalidNodes()
+			{
+				while (m_Current != m_End && (*m_Current)->GetIndex() == invalid_node_index)
+					++m_Current;
+			}
+		};
+
+		explicit ActiveNodeRange(const std::vector<T_NodeType*>& nodes) : m_pNodes(&nodes) {}
+
+		Iterator begin() const { return Iterator(m_pNodes->begin(), m_pNodes->end()); }
+		Iterator end() const { return Iterator(m_pNodes->end(), m_pNodes->end()); }
+		bool empty() const { return begin() == end(); }
+
+	private:
+		const std::vector<T_NodeType*>* m_pNodes;
+	};
+
+	// T_Allocator: allocation policy for the nodes and connections owned by the graph (see EGraphAllocators.h)
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_Allocator = GraphPoolAllocator>
 	class IGraph
 	{
 	public:
@@ -31,17 +102,35 @@ namespace Elite
 		// -------------------------
 		T_NodeType* GetNode(int idx) const;
 		bool IsNodeValid(int idx) const;
+		// Copies the active nodes, prefer GetActiveNodes to only iterate them
 		NodeVector GetAllNodes() const;
+		ActiveNodeRange<T_NodeType> GetActiveNodes() const { return ActiveNodeRange<T_NodeType>(m_Nodes); }
 
 		T_ConnectionType* GetConnection(int from, int to) const;
 		const ConnectionListVector& GetAllConnections() const { return m_Connections; }
 		const ConnectionList& GetNodeConnections(int idx) const;
 		const ConnectionList& GetNodeConnections(T_NodeType* pNode) const { return GetNodeConnections(pNode->GetIndex()); }
 
-		int GetNextFreeNodeIndex() const { return m_NextNodeIndex; }
+		// Nodes and connections are owned by the graph and have to be created through its allocator
+		// An allocated object that is never added to the graph is only released when the graph is cleared
+		template<typename... Args>
+		T_NodeType* AllocateNode(Args&&... args) { return m_NodeAllocator.Allocate(std::forward<Args>(args)...); }
+		template<typename... Args>
+		T_ConnectionType* AllocateConnection(Args&&... args) { return m_ConnectionAllocator.Allocate(std::forward<Args>(args)...); }
+
+		// Index of the last removed node that wasn't reused yet, otherwise a new one at the end (Compact drops the removed ones)
+		// Removed nodes of a graph with fixed indices (see HasFixedNodeIndices) are never handed out again
+		int GetNextFreeNodeIndex() const { return m_FreeNodeIndices.empty() ? m_NextNodeIndex : m_FreeNodeIndices.back(); }
+		// Returns the index of the added node
 		int AddNode(T_NodeType* pNode);
 		void RemoveNode(int node);
 
+		// Moves the active nodes to indices [0, GetNrOfActiveNodes()), keeping their order, and releases the removed ones
+		// The connections are rewritten, pointers to the nodes and connections stay valid but their indices change
+		// Returns the new index of every old index, invalid_node_index for the removed nodes
+		// Does nothing for graphs with fixed indices, like the columns and rows of a GridGraph
+		std::vector<int> Compact();
+
 		void AddConnection(T_ConnectionType* pConnection);
 		void RemoveConnection(int from, int to);
 		void RemoveConnection(T_ConnectionType* pConnection);
@@ -52,7 +141,7 @@ namespace Elite
 		void SetConnectionCost(int from, int to, float cost);
 
 		int GetNrOfNodes() const { return m_Nodes.size(); }
-		int GetNrOfActiveNodes() const;
+		int GetNrOfActiveNodes() const { return m_NrOfActiveNodes; }
 		int GetNrOfConnections() const;
 		bool IsDirectionalGraph() const { return m_IsDirectionalGraph; }
 		bool IsEmpty() const { return m_Nodes.empty(); }
@@ -61,6 +150,27 @@ namespace Elite
 		void Clear();
 		void RemoveConnections();
 
+		// Change tracking
+		// ---------------
+		// The version changes with every modification, the topology version only when nodes or connections are added or removed
+		unsigned int GetVersion() const { return m_Version; }
+		unsigned int GetTopologyVersion() const { return m_TopologyVersion; }
+
+		// Nodes and connections (from, to) modified since the last ClearDirtyFlags, each listed once
+		// Removed nodes and connections are listed as well, check if they still exist before using them
+		const std::vector<int>& GetDirtyNodes() const { return m_DirtyNodes; }
+		const std::vector<std::pair<int, int>>& GetDirtyConnections() const { return m_DirtyConnections; }
+		void ClearDirtyFlags();
+		// Hands the lists over before clearing them, so they can be processed while that marks the graph dirty again
+		void ClearDirtyFlags(std::vector<int>& dirtyNodes, std::vector<std::pair<int, int>>& dirtyConnections);
+
+		// To be called after modifying a node directly (through GetNode)
+		void MarkNodeDirty(int idx);
+
+		// Listeners are not owned and have to be removed before they are destroyed, copies of the graph start without listeners
+		void AddListener(IGraphListener* pListener) { m_Listeners.push_back(pListener); }
+		void RemoveListener(IGraphListener* pListener) { m_Listeners.erase(std::remove(m_Listeners.begin(), m_Listeners.end(), pListener), m_Listeners.end()); }
+
 		// Visualization
 		// -------------
 		float GetNodeRadius(T_NodeType* pNode) const;
@@ -76,10 +186,10 @@ namespace Elite
 		Vector2 GetNodeWorldPos(T_NodeType* pNode) const { return GetNodeWorldPos(pNode->GetIndex()); }
 
 		virtual int GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const = 0;
-		T_NodeType* GetNodeAtWorldPos(const Elite::Vector2& pos) const { return IsNodeValid(GetNodeIdxAtWorldPos(pos)) ? GetNode(GetNodeIdxAtWorldPos(pos)) : nullptr; }
+		T_NodeType* GetNodeAtWorldPos(const Elite::Vector2& pos) const;
 
 		// Allow derived classes to implement a cloning function that returns a base class pointer
-		virtual std::shared_ptr<IGraph<T_NodeType, T_ConnectionType>> Clone() const { return nullptr; };
+		virtual std::shared_ptr<IGraph> Clone() const { return nullptr; };
 
 	protected:
 		// A vector of adjacency pConnection lists, mapped to the indices of the nodes
@@ -89,73 +199,117 @@ namespace Elite
 
 		bool m_IsDirectionalGraph;
 
+		T_Allocator<T_NodeType> m_NodeAllocator;
+		T_Allocator<T_ConnectionType> m_ConnectionAllocator;
 
 		// Called whenever the graph is modified, to be overriden by derived classes
 		virtual void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) {}
+		// Called for every node and connection that is added, removed or changed (Clear only calls OnGraphModified)
+		// The graph can still be in the middle of the modification, so only remember the indices here
+		virtual void OnNodeModified(int idx) {}
+		virtual void OnConnectionModified(int from, int to) {}
+		// Called by Compact after the nodes got their new indices
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) {}
+		// True if the index of a node means something (a cell of a grid), so indices can't be reused or compacted
+		virtual bool HasFixedNodeIndices() const { return false; }
+
+		// Updates the versions before calling OnGraphModified, every modification has to go through here
+		void NotifyGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged);
+		void AddDirtyNode(int idx);
+		void AddDirtyConnection(int from, int to);
+
+		// Bulk construction, for graphs that create all their nodes at once (see GridGraph::InitializeGrid)
+		// Sizes m_Nodes and m_Connections of an empty graph for nodes [0, nrOfNodes), the derived graph fills them in afterwards,
+		// from several threads if it wants to (without calling AddNode/AddConnection). EndBulkBuild marks the nodes dirty.
+		void BeginBulkBuild(int nrOfNodes);
+		void EndBulkBuild();
+		// Bulk build of an empty graph from a snapshot (GraphCSR, also one of a graph file): every node and connection gets a slot
+		// in one range, createNode(range, idx) allocates node idx in the node range. Removed nodes of the snapshot are removed again.
+		template<class T_Snapshot, class T_CreateNode>
+		void BulkBuild(const T_Snapshot& snapshot, T_CreateNode createNode);
 
 	private:
 		int m_NextNodeIndex;
+		int m_NrOfActiveNodes = 0;
+		// Indices of removed nodes, reused by GetNextFreeNodeIndex
+		std::vector<int> m_FreeNodeIndices;
+
+		unsigned int m_Version = 0;
+		unsigned int m_TopologyVersion = 0;
+		std::vector<int> m_DirtyNodes;
+		std::vector<bool> m_IsNodeDirty;
+		std::vector<std::pair<int, int>> m_DirtyConnections;
+		std::unordered_set<uint64_t> m_DirtyConnectionKeys;
+		std::vector<IGraphListener*> m_Listeners;
+
+		static uint64_t GetConnectionKey(int from, int to) { return (uint64_t(uint32_t(from)) << 32) | uint64_t(uint32_t(to)); }
 
 		// private functions
 		void CullInvalidEdges();
 	};
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline IGraph<T_NodeType, T_ConnectionType>::IGraph(bool isDirectionalGraph)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline IGraph<T_NodeType, T_ConnectionType, T_Allocator>::IGraph(bool isDirectionalGraph)
 		: m_NextNodeIndex(0)
 		, m_IsDirectionalGraph(isDirectionalGraph)
 	{
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline IGraph<T_NodeType, T_ConnectionType>::IGraph(const IGraph& other)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline IGraph<T_NodeType, T_ConnectionType, T_Allocator>::IGraph(const IGraph& other)
 	{
-		for (auto& n : m_Nodes)
-			SAFE_DELETE(n);
-
-		for (auto& connectionList : m_Connections)
-		{
-			for (auto& connection : connectionList)
-				SAFE_DELETE(connection);
-		};
-
+		m_NodeAllocator.Reserve(other.m_Nodes.size());
 		for (auto n : other.m_Nodes)
-			m_Nodes.push_back(new T_NodeType(*n));
+			m_Nodes.push_back(m_NodeAllocator.Allocate(*n));
 
-		for (auto cList : other.m_Connections)
+		m_ConnectionAllocator.Reserve(other.GetNrOfConnections());
+		for (const auto& cList : other.m_Connections)
 		{
 			ConnectionList newList;
 			for (auto c : cList)
-				newList.push_back(new T_ConnectionType(*c));
+				newList.push_back(m_ConnectionAllocator.Allocate(*c));
 			m_Connections.push_back(newList);
 		}
 
 		m_IsDirectionalGraph = other.m_IsDirectionalGraph;
 		m_NextNodeIndex = other.m_NextNodeIndex;
+		m_NrOfActiveNodes = other.m_NrOfActiveNodes;
+		m_FreeNodeIndices = other.m_FreeNodeIndices;
+
+		// A copy holds the same data, so data derived from the original stays valid for it
+		m_Version = other.m_Version;
+		m_TopologyVersion = other.m_TopologyVersion;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline IGraph<T_NodeType, T_ConnectionType>::~IGraph()
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline IGraph<T_NodeType, T_ConnectionType, T_Allocator>::~IGraph()
 	{
 		Clear();
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline T_NodeType* IGraph<T_NodeType, T_ConnectionType>::GetNode(int idx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline T_NodeType* IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNode(int idx) const
 	{
 		assert((idx < (int)m_Nodes.size()) && (idx >= 0) &&	"<Graph::GetNode>: invalid index");
 
 		return m_Nodes[idx];
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline bool IGraph<T_NodeType, T_ConnectionType>::IsNodeValid(int idx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline bool IGraph<T_NodeType, T_ConnectionType, T_Allocator>::IsNodeValid(int idx) const
+	{
+		return (idx >= 0 && idx < (int)m_Nodes.size() && m_Nodes[idx]->GetIndex() != invalid_node_index);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline T_NodeType* IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeAtWorldPos(const Elite::Vector2& pos) const
 	{
-		return (idx < (int)m_Nodes.size() && idx != invalid_node_index);
+		const int idx = GetNodeIdxAtWorldPos(pos);
+		return IsNodeValid(idx) ? GetNode(idx) : nullptr;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline T_ConnectionType* IGraph<T_NodeType, T_ConnectionType>::GetConnection(int from, int to) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline T_ConnectionType* IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetConnection(int from, int to) const
 	{
 		assert((from < (int)m_Nodes.size()) &&
 			(from >= 0) &&
@@ -176,10 +330,11 @@ namespace Elite
 		return nullptr;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline std::vector<T_NodeType*> IGraph<T_NodeType, T_ConnectionType>::GetAllNodes() const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline std::vector<T_NodeType*> IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetAllNodes() const
 	{
 		std::vector<T_NodeType*> activeNodes{};
+		activeNodes.reserve(m_NrOfActiveNodes);
 		for (auto n : m_Nodes)
 			if (n->GetIndex() != invalid_node_index)
 				activeNodes.push_back(n);
@@ -187,16 +342,16 @@ namespace Elite
 		return activeNodes;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline const std::list<T_ConnectionType*>& IGraph<T_NodeType, T_ConnectionType>::GetNodeConnections(int idx) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline const std::list<T_ConnectionType*>& IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeConnections(int idx) const
 	{
 		assert((idx < (int)m_Nodes.size()) && (idx >= 0) && "<Graph::GetNode>: invalid index");
 
 		return m_Connections[idx];
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int IGraph<T_NodeType, T_ConnectionType>::AddNode(T_NodeType* pNode)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline int IGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddNode(T_NodeType* pNode)
 	{
 		if (pNode->GetIndex() < (int)m_Nodes.size())
 		{
@@ -205,10 +360,41 @@ namespace Elite
 			assert(m_Nodes[pNode->GetIndex()]->GetIndex() == invalid_node_index &&
 				"<Graph::AddNode>: Attempting to add a node with a duplicate ID");
 
+			m_NodeAllocator.Deallocate(m_Nodes[pNode->GetIndex()]);
 			m_Nodes[pNode->GetIndex()] = pNode;
+			++m_NrOfActiveNodes;
 
-			OnGraphModified(true, false);
-			return m_NextNodeIndex;
+			// Usually the last one freed, see GetNextFreeNodeIndex
+			auto freeIt = std::find(m_FreeNodeIndices.rbegin(), m_FreeNodeIndices.rend(), pNode->GetIndex());
+			if (freeIt != m_FreeNodeIndices.rend())
+				m_FreeNodeIndices.erase(std::next(freeIt).base());
+
+			// A directed graph keeps the connections to a removed node, the new one doesn't inherit them
+			bool hadConnections = false;
+			if (m_IsDirectionalGraph)
+			{
+				const int idx = pNode->GetIndex();
+				for (auto& connectionList : m_Connections)
+				{
+					for (auto connection = connectionList.begin(); connection != connectionList.end();)
+					{
+						if ((*connection)->GetTo() != idx)
+						{
+							++connection;
+							continue;
+						}
+
+						hadConnections = true;
+						AddDirtyConnection((*connection)->GetFrom(), idx);
+						m_ConnectionAllocator.Deallocate(*connection);
+						connection = connectionList.erase(connection);
+					}
+				}
+			}
+
+			AddDirtyNode(pNode->GetIndex());
+			NotifyGraphModified(true, hadConnections);
+			return pNode->GetIndex();
 		}
 		else
 		{
@@ -217,23 +403,32 @@ namespace Elite
 
 			m_Nodes.push_back(pNode);
 			m_Connections.push_back(ConnectionList());
+			++m_NrOfActiveNodes;
 
-			OnGraphModified(true, false);
+			AddDirtyNode(pNode->GetIndex());
+			NotifyGraphModified(true, false);
 			return m_NextNodeIndex++;
 		}
 
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveNode(int idx)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::RemoveNode(int idx)
 	{
 		//Removes pNode by setting it's index to invalid_node_index 
 		//This prevents the other indices from needing to be changed, however it can be reused when adding a new pNode with that index
 
 		assert(idx < (int)m_Nodes.size() && "<Graph::RemoveNode>: invalid node index");
 
+		if (m_Nodes[idx]->GetIndex() == invalid_node_index)
+			return;
+
 		//set this pNode's index to invalid_node_index
 		m_Nodes[idx]->SetIndex(invalid_node_index);
+		--m_NrOfActiveNodes;
+		if (!HasFixedNodeIndices())
+			m_FreeNodeIndices.push_back(idx);
+		AddDirtyNode(idx);
 
 		bool hadConnections = false;
 
@@ -253,10 +448,11 @@ namespace Elite
 					if ((*currentEdgeOnToNode)->GetTo() == idx)
 					{
 						hadConnections = true;
+						AddDirtyConnection((*currentConnection)->GetTo(), idx);
 
 						auto conPtr = *currentEdgeOnToNode;
 						currentEdgeOnToNode = m_Connections[(*currentConnection)->GetTo()].erase(currentEdgeOnToNode);
-						SAFE_DELETE(conPtr);
+						m_ConnectionAllocator.Deallocate(conPtr);
 
 						break;
 					}
@@ -268,15 +464,90 @@ namespace Elite
 		for (auto& connection : m_Connections[idx])
 		{
 			hadConnections = true;
-			SAFE_DELETE(connection);
+			AddDirtyConnection(idx, connection->GetTo());
+			m_ConnectionAllocator.Deallocate(connection);
 		}
 		m_Connections[idx].clear();
 
-		OnGraphModified(true, hadConnections);
+		NotifyGraphModified(true, hadConnections);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline std::vector<int> IGraph<T_NodeType, T_ConnectionType, T_Allocator>::Compact()
+	{
+		std::vector<int> newIndices(m_Nodes.size(), invalid_node_index);
+		if (HasFixedNodeIndices())
+		{
+			assert(false && "<Graph::Compact>: the indices of this graph can't change");
+			for (int idx = 0; idx < (int)m_Nodes.size(); ++idx)
+				newIndices[idx] = IsNodeValid(idx) ? idx : invalid_node_index;
+			return newIndices;
+		}
+
+		int nrOfNodes = 0;
+		for (int idx = 0; idx < (int)m_Nodes.size(); ++idx)
+		{
+			if (m_Nodes[idx]->GetIndex() != invalid_node_index)
+				newIndices[idx] = nrOfNodes++;
+		}
+
+		if (nrOfNodes == (int)m_Nodes.size())
+			return newIndices;
+
+		NodeVector nodes{};
+		nodes.reserve(nrOfNodes);
+		ConnectionListVector connections{};
+		connections.reserve(nrOfNodes);
+		for (int idx = 0; idx < (int)m_Nodes.size(); ++idx)
+		{
+			if (newIndices[idx] == invalid_node_index)
+			{
+				m_NodeAllocator.Deallocate(m_Nodes[idx]);
+				continue;
+			}
+
+			m_Nodes[idx]->SetIndex(newIndices[idx]);
+			nodes.push_back(m_Nodes[idx]);
+
+			// A directed graph keeps the connections to a removed node, they go now
+			ConnectionList& connectionList = m_Connections[idx];
+			for (auto connection = connectionList.begin(); connection != connectionList.end();)
+			{
+				const int newTo = newIndices[(*connection)->GetTo()];
+				if (newTo == invalid_node_index)
+				{
+					m_ConnectionAllocator.Deallocate(*connection);
+					connection = connectionList.erase(connection);
+					continue;
+				}
+
+				(*connection)->SetFrom(newIndices[idx]);
+				(*connection)->SetTo(newTo);
+				++connection;
+			}
+			connections.push_back(std::move(connectionList));
+		}
+
+		m_Nodes.swap(nodes);
+		m_Connections.swap(connections);
+		m_NextNodeIndex = nrOfNodes;
+		m_FreeNodeIndices.clear();
+
+		// The dirty indices are old ones, the topology version tells users to start over
+		m_DirtyNodes.clear();
+		m_IsNodeDirty.clear();
+		m_DirtyConnections.clear();
+		m_DirtyConnectionKeys.clear();
+		OnNodesRemapped(newIndices);
+		for (IGraphListener* pListener : m_Listeners)
+			pListener->OnNodesRemapped(newIndices);
+		NotifyGraphModified(true, true);
+
+		return newIndices;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::AddConnection(T_ConnectionType* pConnection)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddConnection(T_ConnectionType* pConnection)
 	{
 		//first make sure the from and to nodes exist within the graph 
 		assert((pConnection->GetFrom() < m_NextNodeIndex) && (pConnection->GetTo() < m_NextNodeIndex) && (pConnection->GetTo() != pConnection->GetFrom()) &&
@@ -290,6 +561,7 @@ namespace Elite
 			assert(IsUniqueConnection(pConnection->GetFrom(), pConnection->GetTo()) && "Connection already exists on this graph");
 			
 			m_Connections[pConnection->GetFrom()].push_back(pConnection);
+			AddDirtyConnection(pConnection->GetFrom(), pConnection->GetTo());
 
 			//if the graph is undirected we must add another pConnection in the opposite
 			//direction
@@ -298,28 +570,29 @@ namespace Elite
 				//check to make sure the pConnection is unique before adding
 				if (IsUniqueConnection(pConnection->GetTo(), pConnection->GetFrom()))
 				{
-					T_ConnectionType* oppositeDirEdge = new T_ConnectionType();
+					T_ConnectionType* oppositeDirEdge = m_ConnectionAllocator.Allocate();
 
 					oppositeDirEdge->SetCost(pConnection->GetCost());
 					oppositeDirEdge->SetTo(pConnection->GetFrom());
 					oppositeDirEdge->SetFrom(pConnection->GetTo());
 
 					m_Connections[pConnection->GetTo()].push_back(oppositeDirEdge);
+					AddDirtyConnection(pConnection->GetTo(), pConnection->GetFrom());
 				}
 			}
 		}
 		
-		OnGraphModified(false, true);
+		NotifyGraphModified(false, true);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveConnection(int from, int to)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::RemoveConnection(int from, int to)
 	{
 		assert((from < (int)m_Nodes.size()) && (to < (int)m_Nodes.size()) &&
 			"<Graph::RemoveConnection>:invalid node index");
 
 		auto conFromTo = GetConnection(from, to);
-		auto conToFrom = GetConnection(to, from);
+		auto conToFrom = m_IsDirectionalGraph ? nullptr : GetConnection(to, from);
 
 		if (!m_IsDirectionalGraph)
 		{
@@ -346,24 +619,30 @@ namespace Elite
 			}
 		}
 
-		SAFE_DELETE(conFromTo);
-		SAFE_DELETE(conToFrom);
+		m_ConnectionAllocator.Deallocate(conFromTo);
+		m_ConnectionAllocator.Deallocate(conToFrom);
 
-		OnGraphModified(false, true);
+		AddDirtyConnection(from, to);
+		if (!m_IsDirectionalGraph)
+			AddDirtyConnection(to, from);
+		NotifyGraphModified(false, true);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveConnection(T_ConnectionType* pConnection)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::RemoveConnection(T_ConnectionType* pConnection)
 	{
 		RemoveConnection(pConnection->GetFrom(), pConnection->GetTo());
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveConnectionsToAdjacentNodes(int idx)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::RemoveConnectionsToAdjacentNodes(int idx)
 	{
 		// remove and delete connections from this pNode
 		for (auto c : m_Connections[idx])
-			delete c;
+		{
+			AddDirtyConnection(idx, c->GetTo());
+			m_ConnectionAllocator.Deallocate(c);
+		}
 		m_Connections[idx].clear();
 
 		// remove and delete connections from other nodes to this pNode
@@ -373,48 +652,38 @@ namespace Elite
 			std::list<T_ConnectionType*>::iterator foundIt;
 			while ((foundIt = std::find_if(c.begin(), c.end(), isConnectionToThisNode))	!= c.end())
 			{
-				delete *foundIt;
+				AddDirtyConnection((*foundIt)->GetFrom(), idx);
+				m_ConnectionAllocator.Deallocate(*foundIt);
 				c.erase(foundIt);
 			}
 		}
 
-		OnGraphModified(false, true);
+		NotifyGraphModified(false, true);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::SetConnectionCost(int from, int to, float cost)
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::SetConnectionCost(int from, int to, float cost)
 	{
 		//make sure the nodes given are valid
 		assert((from < (int)m_Nodes.size()) && (to < (int)m_Nodes.size()) &&
 			"<Graph::SetEdgeCost>: invalid index");
 
-		//visit each neighbour and erase any connections leading to this pNode
-		for (auto& curEdge = m_Connections[from].begin();
-			curEdge != m_Connections[from].end();
-			++curEdge)
+		//find the connection and update its cost
+		for (auto pConnection : m_Connections[from])
 		{
-			if (curEdge->GetTo() == to)
+			if (pConnection->GetTo() == to)
 			{
-				curEdge->SetCost(cost);
+				pConnection->SetCost(cost);
+
+				AddDirtyConnection(from, to);
+				NotifyGraphModified(false, false);
 				break;
 			}
 		}
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline int IGraph<T_NodeType, T_ConnectionType>::GetNrOfActiveNodes() const
-	{
-		int count = 0;
-
-		for (unsigned int n = 0; n < m_Nodes.size(); ++n) 
-			if (m_Nodes[n]->GetIndex() != invalid_node_index) 
-				++count;
-
-		return count;
-	}
-
-	template<class T_NodeType, class T_ConnectionType>
-	inline int IGraph<T_NodeType, T_ConnectionType>::GetNrOfConnections() const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline int IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNrOfConnections() const
 	{
 		int tot = 0;
 
@@ -428,38 +697,184 @@ namespace Elite
 		return tot;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::Clear()
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::Clear()
 	{
 		for (auto& n : m_Nodes)
-			SAFE_DELETE(n);
+			m_NodeAllocator.Deallocate(n);
 		m_Nodes.clear();
 
 		for (auto& connectionList : m_Connections)
 		{
 			for (auto& connection : connectionList)
-				SAFE_DELETE(connection);
+				m_ConnectionAllocator.Deallocate(connection);
 		}
 		m_Connections.clear();
 
+		// Release the memory in bulk, the next nodes and connections will be laid out contiguously again
+		m_NodeAllocator.Reset();
+		m_ConnectionAllocator.Reset();
+
 		m_NextNodeIndex = 0;
+		m_NrOfActiveNodes = 0;
+		m_FreeNodeIndices.clear();
+
+		// Nothing is left to be marked dirty, the topology version tells users to start over
+		m_DirtyNodes.clear();
+		m_IsNodeDirty.clear();
+		m_DirtyConnections.clear();
+		m_DirtyConnectionKeys.clear();
+		for (IGraphListener* pListener : m_Listeners)
+			pListener->OnGraphCleared();
+		NotifyGraphModified(true, true);
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveConnections()
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::RemoveConnections()
 	{
 		for (auto& connectionList : m_Connections)
+		{
+			for (auto& connection : connectionList)
+			{
+				AddDirtyConnection(connection->GetFrom(), connection->GetTo());
+				m_ConnectionAllocator.Deallocate(connection);
+			}
 			connectionList.clear();
+		}
+
+		NotifyGraphModified(false, true);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::ClearDirtyFlags()
+	{
+		for (int idx : m_DirtyNodes)
+			m_IsNodeDirty[idx] = false;
+		m_DirtyNodes.clear();
+		m_DirtyConnections.clear();
+		m_DirtyConnectionKeys.clear();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::ClearDirtyFlags(std::vector<int>& dirtyNodes, std::vector<std::pair<int, int>>& dirtyConnections)
+	{
+		dirtyNodes.clear();
+		dirtyConnections.clear();
+		dirtyNodes.swap(m_DirtyNodes);
+		dirtyConnections.swap(m_DirtyConnections);
+
+		for (int idx : dirtyNodes)
+			m_IsNodeDirty[idx] = false;
+		m_DirtyConnectionKeys.clear();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::MarkNodeDirty(int idx)
+	{
+		AddDirtyNode(idx);
+		NotifyGraphModified(false, false);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::NotifyGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged)
+	{
+		++m_Version;
+		if (nrOfNodesChanged || nrOfConnectionsChanged)
+			++m_TopologyVersion;
+
+		OnGraphModified(nrOfNodesChanged, nrOfConnectionsChanged);
+		for (IGraphListener* pListener : m_Listeners)
+			pListener->OnGraphModified(nrOfNodesChanged, nrOfConnectionsChanged);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddDirtyNode(int idx)
+	{
+		OnNodeModified(idx);
+		for (IGraphListener* pListener : m_Listeners)
+			pListener->OnNodeModified(idx);
+
+		if (idx >= (int)m_IsNodeDirty.size())
+			m_IsNodeDirty.resize(idx + 1, false);
+
+		if (!m_IsNodeDirty[idx])
+		{
+			m_IsNodeDirty[idx] = true;
+			m_DirtyNodes.push_back(idx);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::BeginBulkBuild(int nrOfNodes)
+	{
+		assert(m_Nodes.empty() && "<Graph::BeginBulkBuild>: the graph has to be empty");
+
+		m_Nodes.assign(nrOfNodes, nullptr);
+		m_Connections.resize(nrOfNodes);
+		m_NextNodeIndex = nrOfNodes;
+		m_NrOfActiveNodes = nrOfNodes;
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::EndBulkBuild()
+	{
+		// The connections of a new node are new as well, they are not listed separately
+		for (int idx = 0; idx < (int)m_Nodes.size(); ++idx)
+			AddDirtyNode(idx);
+
+		NotifyGraphModified(true, true);
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	template<class T_Snapshot, class T_CreateNode>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::BulkBuild(const T_Snapshot& snapshot, T_CreateNode createNode)
+	{
+		const int nrOfNodes = snapshot.GetNrOfNodes();
+		BeginBulkBuild(nrOfNodes);
+		const auto nodeRange = m_NodeAllocator.AllocateRange(nrOfNodes);
+		const auto connectionRange = m_ConnectionAllocator.AllocateRange(snapshot.GetNrOfArcs());
+
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			m_Nodes[idx] = createNode(nodeRange, idx);
+
+			// Same as RemoveNode, in the same order
+			if (!snapshot.IsNodeValid(idx))
+			{
+				m_Nodes[idx]->SetIndex(invalid_node_index);
+				--m_NrOfActiveNodes;
+				if (!HasFixedNodeIndices())
+					m_FreeNodeIndices.push_back(idx);
+				continue;
+			}
+
+			// Both directions of an undirected connection are arcs of the snapshot
+			for (int arc = snapshot.GetFirstArc(idx); arc < snapshot.GetLastArc(idx); ++arc)
+				m_Connections[idx].push_back(m_ConnectionAllocator.AllocateInRange(connectionRange, size_t(arc), idx, snapshot.GetArcTarget(arc), snapshot.GetArcCost(arc)));
+		}
+
+		EndBulkBuild();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::AddDirtyConnection(int from, int to)
+	{
+		OnConnectionModified(from, to);
+		for (IGraphListener* pListener : m_Listeners)
+			pListener->OnConnectionModified(from, to);
+
+		if (m_DirtyConnectionKeys.insert(GetConnectionKey(from, to)).second)
+			m_DirtyConnections.push_back(std::make_pair(from, to));
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline float IGraph<T_NodeType, T_ConnectionType>::GetNodeRadius(T_NodeType* pNode) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline float IGraph<T_NodeType, T_ConnectionType, T_Allocator>::GetNodeRadius(T_NodeType* pNode) const
 	{
 		return DEFAULT_NODE_RADIUS;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline bool IGraph<T_NodeType, T_ConnectionType>::IsUniqueConnection(int from, int to) const
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline bool IGraph<T_NodeType, T_ConnectionType, T_Allocator>::IsUniqueConnection(int from, int to) const
 	{
 		for(auto c : m_Connections[from])
 		{
@@ -472,8 +887,8 @@ namespace Elite
 		return true;
 	}
 
-	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::CullInvalidEdges()
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	inline void IGraph<T_NodeType, T_ConnectionType, T_Allocator>::CullInvalidEdges()
 	{
 		for (auto curEdgeList = m_Connections.begin(); curEdgeList != m_Connections.end(); ++curEdgeList)
 		{
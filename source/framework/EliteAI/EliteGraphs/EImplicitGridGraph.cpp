@@ -0,0 +1,174 @@
+#include "stdafx.h"
+#include "EImplicitGridGraph.h"
+
+using namespace Elite;
+
+const int ImplicitGridGraph::m_DirectionColumns[ImplicitGridGraph::NrOfDirections] = { 1, 0, -1, 0, 1, -1, -1, 1 };
+const int ImplicitGridGraph::m_DirectionRows[ImplicitGridGraph::NrOfDirections] = { 0, 1, 0, -1, 1, 1, -1, -1 };
+
+ImplicitGridGraph::ImplicitGridGraph(bool isDirectional)
+	: m_NrOfColumns(0)
+	, m_NrOfRows(0)
+	, m_CellSize(5)
+	, m_IsDirectionalGraph(isDirectional)
+	, m_IsConnectedDiagonally(true)
+	, m_DefaultCostStraight(1.f)
+	, m_DefaultCostDiagonal(1.5f)
+{
+}
+
+ImplicitGridGraph::ImplicitGridGraph(
+	int columns,
+	int rows,
+	int cellSize,
+	bool isDirectionalGraph,
+	bool isConnectedDiagonally,
+	float costStraight /* = 1.f*/,
+	float costDiagonal /* = 1.5f */)
+	: ImplicitGridGraph(isDirectionalGraph)
+{
+	InitializeGrid(columns, rows, cellSize, isDirectionalGraph, isConnectedDiagonally, costStraight, costDiagonal);
+}
+
+void ImplicitGridGraph::InitializeGrid(
+	int columns,
+	int rows,
+	int cellSize,
+	bool isDirectionalGraph,
+	bool isConnectedDiagonally,
+	float costStraight /* = 1.f*/,
+	float costDiagonal /* = 1.5f */)
+{
+	m_IsDirectionalGraph = isDirectionalGraph;
+	m_NrOfColumns = columns;
+	m_NrOfRows = rows;
+	m_CellSize = cellSize;
+	m_IsConnectedDiagonally = isConnectedDiagonally;
+	m_DefaultCostStraight = costStraight;
+	m_DefaultCostDiagonal = costDiagonal;
+
+	// No node or connection objects: every cell starts as connected ground
+	m_Terrain.assign(columns * rows, TerrainType::Ground);
+	m_BlockedDirections.assign(columns * rows, 0);
+	NotifyGraphModified();
+}
+
+void ImplicitGridGraph::SetTerrainType(int idx, TerrainType terrain)
+{
+	if (m_Terrain[idx] == terrain)
+		return;
+
+	m_Terrain[idx] = terrain;
+	NotifyGraphModified();
+}
+
+Vector2 ImplicitGridGraph::GetNodeWorldPos(int col, int row) const
+{
+	Vector2 cellCenterOffset = { m_CellSize / 2.f, m_CellSize / 2.f };
+	return Vector2{ (float)col * m_CellSize, (float)row * m_CellSize } + cellCenterOffset;
+}
+
+int ImplicitGridGraph::GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const
+{
+	if (pos.x < 0 || pos.y < 0)
+		return invalid_node_index;
+
+	int c = int(pos.x / m_CellSize);
+	int r = int(pos.y / m_CellSize);
+
+	if (!IsWithinBounds(c, r))
+		return invalid_node_index;
+
+	return GetIndex(c, r);
+}
+
+void ImplicitGridGraph::RemoveConnection(int from, int to)
+{
+	int direction = GetDirection(from, to);
+	if (direction == -1)
+		return;
+
+	m_BlockedDirections[from] |= (1 << direction);
+	if (!m_IsDirectionalGraph)
+		m_BlockedDirections[to] |= (1 << GetOppositeDirection(direction));
+	NotifyGraphModified();
+}
+
+void ImplicitGridGraph::RemoveConnectionsToAdjacentNodes(int idx)
+{
+	const int col = idx % m_NrOfColumns;
+	const int row = idx / m_NrOfColumns;
+
+	// Block the connections leaving this cell and the connections of the neighbors leading to this cell
+	m_BlockedDirections[idx] = 0xFF;
+	for (int d = 0; d < NrOfDirections; ++d)
+	{
+		const int neighborCol = col + m_DirectionColumns[d];
+		const int neighborRow = row + m_DirectionRows[d];
+		if (IsWithinBounds(neighborCol, neighborRow))
+			m_BlockedDirections[GetIndex(neighborCol, neighborRow)] |= (1 << GetOppositeDirection(d));
+	}
+	NotifyGraphModified();
+}
+
+void ImplicitGridGraph::AddConnectionsToAdjacentCells(int idx)
+{
+	const int col = idx % m_NrOfColumns;
+	const int row = idx / m_NrOfColumns;
+
+	m_BlockedDirections[idx] = 0;
+	NotifyGraphModified();
+	if (m_IsDirectionalGraph)
+		return;
+
+	for (int d = 0; d < NrOfDirections; ++d)
+	{
+		const int neighborCol = col + m_DirectionColumns[d];
+		const int neighborRow = row + m_DirectionRows[d];
+		if (IsWithinBounds(neighborCol, neighborRow))
+			m_BlockedDirections[GetIndex(neighborCol, neighborRow)] &= ~(1 << GetOppositeDirection(d));
+	}
+}
+
+float ImplicitGridGraph::GetConnectionCost(int from, int to) const
+{
+	int direction = GetDirection(from, to);
+	if (direction == -1 || direction >= GetNrOfActiveDirections())
+		return ISOLATED_CONNECTION_COST;
+
+	return GetConnectionCostInDirection(from, from % m_NrOfColumns, from / m_NrOfColumns, direction);
+}
+
+int ImplicitGridGraph::GetNrOfConnections(int idx) const
+{
+	int nrOfConnections = 0;
+	ForEachConnection(idx, [&nrOfConnections](int, float) { ++nrOfConnections; });
+	return nrOfConnections;
+}
+
+int ImplicitGridGraph::GetDirection(int from, int to) const
+{
+	const int deltaCol = to % m_NrOfColumns - from % m_NrOfColumns;
+	const int deltaRow = to / m_NrOfColumns - from / m_NrOfColumns;
+
+	for (int d = 0; d < NrOfDirections; ++d)
+	{
+		if (m_DirectionColumns[d] == deltaCol && m_DirectionRows[d] == deltaRow)
+			return d;
+	}
+
+	return -1;
+}
+
+float ImplicitGridGraph::GetConnectionCostInDirection(int idx, int col, int row, int direction) const
+{
+	const int neighborCol = col + m_DirectionColumns[direction];
+	const int neighborRow = row + m_DirectionRows[direction];
+
+	if (!IsWithinBounds(neighborCol, neighborRow) || (m_BlockedDirections[idx] & (1 << direction)))
+		return ISOLATED_CONNECTION_COST;
+
+	// Same cost rule as GridGraph<GridTerrainNode, GraphConnection>
+	const float baseCost = IsDiagonalDirection(direction) ? m_DefaultCostDiagonal : m_DefaultCostStraight;
+	return GetTerrainConnectionCost(baseCost, m_Terrain[idx], m_Terrain[GetIndex(neighborCol, neighborRow)]);
+}
@@ -0,0 +1,114 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EImplicitGridGraph.h: Grid graph that doesn't store any node or connection objects.
+// Only the terrain and a bitmask of blocked directions are stored per cell,
+// neighbors and connection costs are calculated from the cell coordinates when requested.
+// The searches (AStarSearch, Landmarks, ContractionHierarchy, DistanceMatrix, ...) run on a GraphCSR built from it,
+// the same snapshot they use for the other graphs: GraphCSR csr(implicitGrid).
+/*=============================================================================*/
+#pragma once
+
+#include "EGraphEnums.h"
+#include "EGraphNodeTypes.h"
+#include <cstdint>
+
+namespace Elite
+{
+	class ImplicitGridGraph final
+	{
+	public:
+		// Same direction order as GridGraph: 4 straight directions followed by 4 diagonal directions
+		static const int NrOfDirections = 8;
+
+		ImplicitGridGraph(bool isDirectional);
+		ImplicitGridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5f);
+		void InitializeGrid(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5f);
+
+		int GetRows() const { return m_NrOfRows; }
+		int GetColumns() const { return m_NrOfColumns; }
+		int GetCellSize() const { return m_CellSize; }
+		int GetNrOfNodes() const { return m_NrOfColumns * m_NrOfRows; }
+		bool IsDirectionalGraph() const { return m_IsDirectionalGraph; }
+		bool IsConnectedDiagonally() const { return m_IsConnectedDiagonally; }
+
+		// Change tracking, like IGraph: the version changes with every modification, the topology version when
+		// connections are (un)blocked or the terrain changes (terrain can isolate cells)
+		unsigned int GetVersion() const { return m_Version; }
+		unsigned int GetTopologyVersion() const { return m_TopologyVersion; }
+
+		bool IsWithinBounds(int col, int row) const { return (col >= 0 && col < m_NrOfColumns && row >= 0 && row < m_NrOfRows); }
+		bool IsNodeValid(int idx) const { return idx >= 0 && idx < GetNrOfNodes(); }
+		int GetIndex(int col, int row) const { return row * m_NrOfColumns + col; }
+
+		// returns the column and row of the node in a Vector2
+		Vector2 GetNodePos(int idx) const { return Vector2{ float(idx % m_NrOfColumns), float(idx / m_NrOfColumns) }; }
+
+		// returns the actual world position of the node
+		Vector2 GetNodeWorldPos(int col, int row) const;
+		Vector2 GetNodeWorldPos(int idx) const { return GetNodeWorldPos(idx % m_NrOfColumns, idx / m_NrOfColumns); }
+		int GetNodeIdxAtWorldPos(const Elite::Vector2& pos) const;
+
+		// Terrain
+		TerrainType GetTerrainType(int idx) const { return m_Terrain[idx]; }
+		void SetTerrainType(int idx, TerrainType terrain);
+		Elite::Color GetNodeColor(int idx) const { return GetTerrainColor(m_Terrain[idx]); }
+
+		// Connections only exist implicitly, these functions (un)block them
+		// In an undirected graph the opposite direction is (un)blocked as well
+		void RemoveConnection(int from, int to);
+		void RemoveConnectionsToAdjacentNodes(int idx);
+		void AddConnectionsToAdjacentCells(int idx);
+
+		// Returns false if the cells aren't adjacent, the connection is blocked or the terrain isolates one of the cells
+		bool IsConnected(int from, int to) const { return GetConnectionCost(from, to) < ISOLATED_CONNECTION_COST; }
+		// Returns ISOLATED_CONNECTION_COST when there is no connection between both cells
+		float GetConnectionCost(int from, int to) const;
+
+		// Calls func(int neighborIdx, float cost) for every connection leaving the node
+		template<typename T_Func>
+		void ForEachConnection(int idx, T_Func func) const;
+		int GetNrOfConnections(int idx) const;
+
+	private:
+		int m_NrOfColumns;
+		int m_NrOfRows;
+		int m_CellSize;
+
+		bool m_IsDirectionalGraph;
+		bool m_IsConnectedDiagonally;
+		float m_DefaultCostStraight;
+		float m_DefaultCostDiagonal;
+
+		unsigned int m_Version = 0;
+		unsigned int m_TopologyVersion = 0;
+
+		// per cell data
+		std::vector<TerrainType> m_Terrain;
+		std::vector<uint8_t> m_BlockedDirections; // bit d set == the connection in direction d is removed
+
+		static const int m_DirectionColumns[NrOfDirections];
+		static const int m_DirectionRows[NrOfDirections];
+
+		int GetNrOfActiveDirections() const { return m_IsConnectedDiagonally ? NrOfDirections : NrOfDirections / 2; }
+		static bool IsDiagonalDirection(int direction) { return direction >= NrOfDirections / 2; }
+		static int GetOppositeDirection(int direction) { return IsDiagonalDirection(direction) ? 4 + (direction - 2) % 4 : (direction + 2) % 4; }
+		int GetDirection(int from, int to) const;
+		void NotifyGraphModified() { ++m_Version; ++m_TopologyVersion; }
+		float GetConnectionCostInDirection(int idx, int col, int row, int direction) const;
+	};
+
+	template<typename T_Func>
+	inline void ImplicitGridGraph::ForEachConnection(int idx, T_Func func) const
+	{
+		const int col = idx % m_NrOfColumns;
+		const int row = idx / m_NrOfColumns;
+
+		for (int d = 0; d < GetNrOfActiveDirections(); ++d)
+		{
+			const float cost = GetConnectionCostInDirection(idx, col, row, d);
+			if (cost < ISOLATED_CONNECTION_COST)
+				func(GetIndex(col + m_DirectionColumns[d], row + m_DirectionRows[d]), cost);
+		}
+	}
+}
@@ -0,0 +1,424 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EInfluenceMap.h: Influence map on top of a graph of InfluenceNodes (GridGraph or Graph2D).
+// Every propagation step a node takes the strongest influence of its neighbors, decayed over the connection cost,
+// and blends it with its own influence (momentum). Influence flows along the connections: in a directed graph a node
+// only gets influence over the connections arriving at it.
+// The influence lives in two contiguous arrays (read one, write the other) instead of in the nodes:
+//	- grid graphs use a stencil over a zero-padded copy of the grid, 4 nodes at a time with SSE
+//	- other graphs gather over the arcs of a transposed CSR snapshot (the arcs arriving at every node)
+// Both split the nodes over the threads of a ThreadPool when one is set.
+// A removed node loses its influence, so a node added in its slot starts without it, and Compact moves the
+// influence along with the nodes.
+/*=============================================================================*/
+#pragma once
+
+#include "EGridGraph.h"
+#include "EGraph2D.h"
+#include "EGraphCSR.h"
+#include "framework\EliteHelpers\EThreadPool.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define ELITE_INFLUENCE_MAP_SSE
+#endif
+
+namespace Elite
+{
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	std::true_type IsGridGraphType(const GridGraph<T_NodeType, T_ConnectionType, T_Allocator>*);
+	std::false_type IsGridGraphType(const void*);
+
+	template<class T_GraphType>
+	class InfluenceMap final : public T_GraphType
+	{
+	public:
+		// Takes the arguments of the graph constructor
+		template<typename... Args>
+		explicit InfluenceMap(Args&&... args) : T_GraphType(std::forward<Args>(args)...) {}
+
+		// Propagates once every propagation interval, independent of the frame rate
+		// A long frame catches up with at most m_MaxPropagationsPerUpdate steps
+		void Update(float deltaTime);
+		void Propagate();
+
+		float GetInfluence(int idx) const;
+		void SetInfluence(int idx, float influence);
+		void SetInfluenceAtPosition(const Vector2& pos, float influence);
+
+		// Copies the influence to the nodes (for their text) and colors them, call before rendering
+		void SetNodeColorsBasedOnInfluence();
+
+		float GetMomentum() const { return m_Momentum; }
+		void SetMomentum(float momentum) { m_Momentum = momentum; }
+		float GetDecay() const { return m_Decay; }
+		void SetDecay(float decay) { m_Decay = decay; }
+		float GetPropagationInterval() const { return m_PropagationInterval; }
+		void SetPropagationInterval(float propagationInterval) { m_PropagationInterval = propagationInterval; }
+		// nullptr propagates on the calling thread only
+		void SetThreadPool(ThreadPool* pThreadPool) { m_pThreadPool = pThreadPool; }
+
+	protected:
+		virtual void OnNodeModified(int idx) override;
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override;
+
+	private:
+		typedef decltype(IsGridGraphType(std::declval<const T_GraphType*>())) IsGrid;
+
+		Elite::Color m_NegativeColor{ 1.f, 0.2f, 0.f };
+		Elite::Color m_NeutralColor{ 0.f, 0.f, 0.f };
+		Elite::Color m_PositiveColor{ 0.f, 0.2f, 1.f };
+		float m_MaxAbsInfluence = 100.f;
+
+		float m_Momentum = 0.8f; // a higher momentum means a higher tendency to retain the current influence
+		float m_Decay = 0.1f; // determines the decay in influence over distance
+		float m_PropagationInterval = .05f; // in seconds
+		float m_TimeSinceLastPropagation = 0.f;
+		const int m_MaxPropagationsPerUpdate = 4;
+		const int m_MinNodesPerThread = 1024;
+
+		ThreadPool* m_pThreadPool = nullptr;
+
+		// Influence per node, m_Influences[m_ReadBuffer] holds the current values
+		std::vector<float> m_Influences[2];
+		int m_ReadBuffer = 0;
+
+		// Layout, rebuilt when the graph or the decay changed
+		bool m_IsLayoutBuilt = false;
+		unsigned int m_LayoutVersion = 0;
+		float m_LayoutDecay = 0.f;
+		int m_NrOfLayoutNodes = 0;
+		bool m_UseStencil = false;
+
+		// Grid stencil: (columns + 2) x (rows + 2) with a border of zeros, weights per neighbor direction (0 without a connection)
+		// The weight of a cell in a direction belongs to the connection from the neighbor in that direction to the cell
+		static const int m_NrOfDirections = 8;
+		int m_LayoutColumns = 0;
+		int m_LayoutRows = 0;
+		int m_PaddedColumns = 0;
+		int m_DirectionOffsets[m_NrOfDirections]{};
+		std::vector<float> m_DirectionWeights[m_NrOfDirections];
+
+		// Other graphs: the arcs arriving at every node, with their decayed weight
+		GraphCSR m_CSR;
+		std::vector<float> m_ArcWeights;
+
+		int GetBufferIndex(int idx) const;
+		void UpdateLayout();
+		void BuildLayout(std::true_type isGrid);
+		void BuildLayout(std::false_type isGrid);
+		void BuildCSRLayout();
+		void PropagateRange(int begin, int end);
+		void PropagateStencilRows(int firstRow, int endRow);
+		void PropagateCSRNodes(int firstIdx, int endIdx);
+	};
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::Update(float deltaTime)
+	{
+		m_TimeSinceLastPropagation += deltaTime;
+
+		int nrOfPropagations = 0;
+		while (m_TimeSinceLastPropagation >= m_PropagationInterval && nrOfPropagations < m_MaxPropagationsPerUpdate)
+		{
+			Propagate();
+			m_TimeSinceLastPropagation -= m_PropagationInterval;
+			++nrOfPropagations;
+		}
+
+		// Drop the time that couldn't be caught up with
+		if (nrOfPropagations == m_MaxPropagationsPerUpdate)
+			m_TimeSinceLastPropagation = std::min(m_TimeSinceLastPropagation, m_PropagationInterval);
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::Propagate()
+	{
+		UpdateLayout();
+
+		const int count = m_UseStencil ? m_LayoutRows : m_NrOfLayoutNodes;
+		const int minRangeSize = m_UseStencil ? std::max(1, m_MinNodesPerThread / std::max(1, m_LayoutColumns)) : m_MinNodesPerThread;
+
+		if (m_pThreadPool)
+			m_pThreadPool->ParallelFor(count, minRangeSize, [this](int begin, int end) { PropagateRange(begin, end); });
+		else
+			PropagateRange(0, count);
+
+		m_ReadBuffer = 1 - m_ReadBuffer;
+	}
+
+	template<class T_GraphType>
+	inline float InfluenceMap<T_GraphType>::GetInfluence(int idx) const
+	{
+		if (!m_IsLayoutBuilt || idx < 0 || idx >= m_NrOfLayoutNodes)
+			return GetNode(idx)->GetInfluence();
+
+		return m_Influences[m_ReadBuffer][GetBufferIndex(idx)];
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetInfluence(int idx, float influence)
+	{
+		UpdateLayout();
+		if (!IsNodeValid(idx))
+			return;
+
+		m_Influences[m_ReadBuffer][GetBufferIndex(idx)] = influence;
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetInfluenceAtPosition(const Vector2& pos, float influence)
+	{
+		const int idx = GetNodeIdxAtWorldPos(pos);
+		if (idx != invalid_node_index)
+			SetInfluence(idx, influence);
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::SetNodeColorsBasedOnInfluence()
+	{
+		UpdateLayout();
+
+		for (int idx = 0; idx < m_NrOfLayoutNodes; ++idx)
+		{
+			if (!IsNodeValid(idx))
+				continue;
+
+			const float influence = m_Influences[m_ReadBuffer][GetBufferIndex(idx)];
+			const float relativeInfluence = std::min(fabsf(influence) / m_MaxAbsInfluence, 1.f);
+
+			auto pNode = GetNode(idx);
+			pNode->SetInfluence(influence);
+			pNode->SetColor(Color{
+				Lerp(m_NeutralColor.r, influence < 0.f ? m_NegativeColor.r : m_PositiveColor.r, relativeInfluence),
+				Lerp(m_NeutralColor.g, influence < 0.f ? m_NegativeColor.g : m_PositiveColor.g, relativeInfluence),
+				Lerp(m_NeutralColor.b, influence < 0.f ? m_NegativeColor.b : m_PositiveColor.b, relativeInfluence) });
+		}
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::OnNodeModified(int idx)
+	{
+		T_GraphType::OnNodeModified(idx);
+
+		// Removed: the layout keeps the influence by index until it is rebuilt
+		if (m_IsLayoutBuilt && idx < m_NrOfLayoutNodes && !IsNodeValid(idx))
+			m_Influences[m_ReadBuffer][GetBufferIndex(idx)] = 0.f;
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::OnNodesRemapped(const std::vector<int>& newIndices)
+	{
+		T_GraphType::OnNodesRemapped(newIndices);
+		if (!m_IsLayoutBuilt)
+			return;
+
+		// The influence goes to the nodes under their new index, the next layout takes it from there
+		for (int idx = 0; idx < m_NrOfLayoutNodes; ++idx)
+		{
+			const int newIdx = GetRemappedNodeIndex(newIndices, idx);
+			if (newIdx != invalid_node_index)
+				GetNode(newIdx)->SetInfluence(m_Influences[m_ReadBuffer][GetBufferIndex(idx)]);
+		}
+		m_IsLayoutBuilt = false;
+	}
+
+	template<class T_GraphType>
+	inline int InfluenceMap<T_GraphType>::GetBufferIndex(int idx) const
+	{
+		if (!m_UseStencil)
+			return idx;
+
+		const int col = idx % m_LayoutColumns;
+		const int row = idx / m_LayoutColumns;
+		return (row + 1) * m_PaddedColumns + col + 1;
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::UpdateLayout()
+	{
+		if (m_IsLayoutBuilt && m_LayoutVersion == GetVersion() && m_LayoutDecay == m_Decay)
+			return;
+
+		// Keep the influence of the nodes, the first time it comes from the nodes themselves
+		std::vector<float> influences(GetNrOfNodes(), 0.f);
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
+		{
+			if (!IsNodeValid(idx))
+				continue;
+
+			influences[idx] = (m_IsLayoutBuilt && idx < m_NrOfLayoutNodes) ? m_Influences[m_ReadBuffer][GetBufferIndex(idx)] : GetNode(idx)->GetInfluence();
+		}
+
+		BuildLayout(IsGrid{});
+
+		m_NrOfLayoutNodes = GetNrOfNodes();
+		m_LayoutVersion = GetVersion();
+		m_LayoutDecay = m_Decay;
+		m_IsLayoutBuilt = true;
+
+		for (int idx = 0; idx < m_NrOfLayoutNodes; ++idx)
+			m_Influences[m_ReadBuffer][GetBufferIndex(idx)] = influences[idx];
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::BuildLayout(std::true_type)
+	{
+		const int columns = GetColumns();
+		const int rows = GetRows();
+
+		m_UseStencil = true;
+		m_LayoutColumns = columns;
+		m_LayoutRows = rows;
+		m_PaddedColumns = columns + 2;
+		const size_t paddedSize = size_t(m_PaddedColumns) * size_t(rows + 2);
+
+		const int directionColumns[m_NrOfDirections]{ 1, 1, 0, -1, -1, -1, 0, 1 };
+		const int directionRows[m_NrOfDirections]{ 0, 1, 1, 1, 0, -1, -1, -1 };
+		for (int direction = 0; direction < m_NrOfDirections; ++direction)
+		{
+			m_DirectionOffsets[direction] = directionRows[direction] * m_PaddedColumns + directionColumns[direction];
+			m_DirectionWeights[direction].assign(paddedSize, 0.f);
+		}
+
+		for (int idx = 0; idx < GetNrOfNodes(); ++idx)
+		{
+			if (!IsNodeValid(idx))
+				continue;
+
+			const int col = idx % columns;
+			const int row = idx / columns;
+			for (auto pConnection : GetNodeConnections(idx))
+			{
+				const int to = pConnection->GetTo();
+				if (!IsNodeValid(to))
+					continue;
+
+				int direction = 0;
+				while (direction < m_NrOfDirections
+					&& (directionColumns[direction] != to % columns - col || directionRows[direction] != to / columns - row))
+					++direction;
+
+				// Connections to cells that aren't adjacent don't fit a stencil
+				if (direction == m_NrOfDirections)
+				{
+					BuildCSRLayout();
+					return;
+				}
+
+				// Seen from the cell it arrives at, the connection comes from the opposite direction
+				const int oppositeDirection = (direction + m_NrOfDirections / 2) % m_NrOfDirections;
+				m_DirectionWeights[oppositeDirection][(to / columns + 1) * m_PaddedColumns + to % columns + 1] = expf(-pConnection->GetCost() * m_Decay);
+			}
+		}
+
+		m_Influences[0].assign(paddedSize, 0.f);
+		m_Influences[1].assign(paddedSize, 0.f);
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::BuildLayout(std::false_type)
+	{
+		BuildCSRLayout();
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::BuildCSRLayout()
+	{
+		m_UseStencil = false;
+		for (std::vector<float>& weights : m_DirectionWeights)
+			weights.clear();
+
+		// Every connection has its twin in an undirected graph, the arcs arriving at a node are the ones leaving it
+		if (IsDirectionalGraph())
+			m_CSR.BuildTransposed(GraphCSR(*this));
+		else
+			m_CSR.Build(*this);
+
+		m_ArcWeights.resize(m_CSR.GetNrOfArcs());
+		for (int arc = 0; arc < m_CSR.GetNrOfArcs(); ++arc)
+			m_ArcWeights[arc] = expf(-m_CSR.GetArcCost(arc) * m_Decay);
+
+		m_Influences[0].assign(GetNrOfNodes(), 0.f);
+		m_Influences[1].assign(GetNrOfNodes(), 0.f);
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::PropagateRange(int begin, int end)
+	{
+		if (m_UseStencil)
+			PropagateStencilRows(begin, end);
+		else
+			PropagateCSRNodes(begin, end);
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::PropagateStencilRows(int firstRow, int endRow)
+	{
+		const float* pRead = m_Influences[m_ReadBuffer].data();
+		float* pWrite = m_Influences[1 - m_ReadBuffer].data();
+		const int columns = m_LayoutColumns;
+
+		for (int row = firstRow; row < endRow; ++row)
+		{
+			const int rowStart = (row + 1) * m_PaddedColumns + 1;
+			const int rowEnd = rowStart + columns;
+			int i = rowStart;
+
+#ifdef ELITE_INFLUENCE_MAP_SSE
+			const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+			const __m128 momentum = _mm_set1_ps(m_Momentum);
+			for (; i + 4 <= rowEnd; i += 4)
+			{
+				__m128 highest = _mm_setzero_ps();
+				__m128 highestAbs = _mm_setzero_ps();
+				for (int direction = 0; direction < m_NrOfDirections; ++direction)
+				{
+					const __m128 influence = _mm_mul_ps(_mm_loadu_ps(pRead + i + m_DirectionOffsets[direction]), _mm_loadu_ps(m_DirectionWeights[direction].data() + i));
+					const __m128 influenceAbs = _mm_and_ps(influence, absMask);
+					const __m128 isStronger = _mm_cmpgt_ps(influenceAbs, highestAbs);
+					highest = _mm_or_ps(_mm_and_ps(isStronger, influence), _mm_andnot_ps(isStronger, highest));
+					highestAbs = _mm_max_ps(highestAbs, influenceAbs);
+				}
+
+				// Lerp(highest, current, momentum)
+				const __m128 current = _mm_loadu_ps(pRead + i);
+				_mm_storeu_ps(pWrite + i, _mm_add_ps(highest, _mm_mul_ps(_mm_sub_ps(current, highest), momentum)));
+			}
+#endif
+			for (; i < rowEnd; ++i)
+			{
+				float highest = 0.f;
+				for (int direction = 0; direction < m_NrOfDirections; ++direction)
+				{
+					const float influence = pRead[i + m_DirectionOffsets[direction]] * m_DirectionWeights[direction][i];
+					if (fabsf(influence) > fabsf(highest))
+						highest = influence;
+				}
+				pWrite[i] = highest + (pRead[i] - highest) * m_Momentum;
+			}
+		}
+	}
+
+	template<class T_GraphType>
+	inline void InfluenceMap<T_GraphType>::PropagateCSRNodes(int firstIdx, int endIdx)
+	{
+		const float* pRead = m_Influences[m_ReadBuffer].data();
+		float* pWrite = m_Influences[1 - m_ReadBuffer].data();
+
+		for (int idx = firstIdx; idx < endIdx; ++idx)
+		{
+			float highest = 0.f;
+			for (int arc = m_CSR.GetFirstArc(idx); arc < m_CSR.GetLastArc(idx); ++arc)
+			{
+				const float influence = pRead[m_CSR.GetArcTarget(arc)] * m_ArcWeights[arc];
+				if (fabsf(influence) > fabsf(highest))
+					highest = influence;
+			}
+
+			// removed nodes have no arcs and keep no influence
+			pWrite[idx] = m_CSR.IsNodeValid(idx) ? highest + (pRead[idx] - highest) * m_Momentum : 0.f;
+		}
+	}
+}
@@ -0,0 +1,108 @@
+#include "stdafx.h"
+#include "EPathCache.h"
+
+using namespace Elite;
+
+PathCache::PathCache(size_t byteBudget)
+	: m_ByteBudget(byteBudget)
+{
+}
+
+bool PathCache::TryGetPath(int startIdx, int goalIdx, unsigned int version, Heuristic heuristic, std::vector<int>& path, float& cost)
+{
+	auto foundIt = m_Locations.find(Key{ startIdx, goalIdx, version, heuristic });
+	if (foundIt == m_Locations.end())
+	{
+		++m_NrOfMisses;
+		return false;
+	}
+
+	const Location location = foundIt->second;
+	m_Entries.splice(m_Entries.begin(), m_Entries, location.entry);
+
+	const Entry& entry = *location.entry;
+	path.assign(entry.path.begin() + location.offset, entry.path.end());
+	cost = entry.costsSoFar.back() - entry.costsSoFar[location.offset];
+
+	++m_NrOfHits;
+	if (location.offset > 0)
+		++m_NrOfSubPathHits;
+	return true;
+}
+
+void PathCache::AddPath(unsigned int version, Heuristic heuristic, const std::vector<int>& path, const std::vector<float>& costsSoFar)
+{
+	assert(path.size() == costsSoFar.size() && "<PathCache::AddPath>: every node needs its cost");
+	if (path.empty())
+		return;
+
+	const int goalIdx = path.back();
+	if (m_Locations.find(Key{ path.front(), goalIdx, version, heuristic }) != m_Locations.end())
+		return;
+
+	// the list node, the path and an index entry (with its hash node) per node on the path
+	const size_t bytes = sizeof(Entry) + 2 * sizeof(void*)
+		+ path.size() * (sizeof(int) + sizeof(float))
+		+ path.size() * (sizeof(Key) + sizeof(Location) + 3 * sizeof(void*));
+	if (bytes > m_ByteBudget)
+		return;
+
+	while (m_UsedBytes + bytes > m_ByteBudget)
+		EvictLeastRecentlyUsed();
+
+	m_Entries.push_front(Entry{ version, heuristic, path, costsSoFar, bytes });
+	m_UsedBytes += bytes;
+
+	const EntryIterator entryIt = m_Entries.begin();
+	for (int offset = 0; offset < int(path.size()); ++offset)
+		m_Locations.emplace(Key{ path[offset], goalIdx, version, heuristic }, Location{ entryIt, offset });
+}
+
+void PathCache::Clear()
+{
+	m_Entries.clear();
+	m_Locations.clear();
+	m_UsedBytes = 0;
+}
+
+void PathCache::ResetStatistics()
+{
+	m_NrOfHits = 0;
+	m_NrOfSubPathHits = 0;
+	m_NrOfMisses = 0;
+	m_NrOfEvictions = 0;
+}
+
+void PathCache::SetByteBudget(size_t byteBudget)
+{
+	m_ByteBudget = byteBudget;
+	while (m_UsedBytes > m_ByteBudget)
+		EvictLeastRecentlyUsed();
+}
+
+void PathCache::EvictLeastRecentlyUsed()
+{
+	const EntryIterator entryIt = std::prev(m_Entries.end());
+	const int goalIdx = entryIt->path.back();
+
+	// Nodes that were already on another path keep pointing to that one
+	for (int nodeIdx : entryIt->path)
+	{
+		auto foundIt = m_Locations.find(Key{ nodeIdx, goalIdx, entryIt->version, entryIt->heuristic });
+		if (foundIt != m_Locations.end() && foundIt->second.entry == entryIt)
+			m_Locations.erase(foundIt);
+	}
+
+	m_UsedBytes -= entryIt->bytes;
+	m_Entries.erase(entryIt);
+	++m_NrOfEvictions;
+}
+
+size_t PathCache::KeyHash::operator()(const Key& key) const
+{
+	size_t hash = std::hash<int>()(key.nodeIdx);
+	hash = hash * 31 + std::hash<int>()(key.goalIdx);
+	hash = hash * 31 + std::hash<unsigned int>()(key.version);
+	hash = hash * 31 + std::hash<size_t>()(reinterpret_cast<size_t>(key.heuristic));
+	return hash;
+}
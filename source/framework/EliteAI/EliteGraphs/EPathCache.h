@@ -0,0 +1,94 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EPathCache.h: Least recently used cache of found paths, keyed on start node, goal node, graph version
+// and heuristic. Every node of a cached path is indexed, so a request starting anywhere on a cached path
+// to the same goal gets the rest of that path (the end of a shortest path is a shortest path as well).
+// Paths of an older graph version are never returned and get evicted as the cache fills up.
+/*=============================================================================*/
+#pragma once
+
+#include <list>
+#include <unordered_map>
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EHeuristicFunctions.h"
+
+namespace Elite
+{
+	class PathCache final
+	{
+	public:
+		// The budget includes the index, the sizes are estimates
+		explicit PathCache(size_t byteBudget = 1024 * 1024);
+
+		// Node indices from start to goal and the cost of the path, when a cached path goes from start to goal
+		// or passes through start on its way to goal
+		bool TryGetPath(int startIdx, int goalIdx, unsigned int version, Heuristic heuristic, std::vector<int>& path, float& cost);
+		// costsSoFar[i] is the cost from the start of the path to path[i]
+		void AddPath(unsigned int version, Heuristic heuristic, const std::vector<int>& path, const std::vector<float>& costsSoFar);
+
+		void Clear();
+		void ResetStatistics();
+
+		void SetByteBudget(size_t byteBudget);
+		size_t GetByteBudget() const { return m_ByteBudget; }
+		size_t GetUsedBytes() const { return m_UsedBytes; }
+		int GetNrOfPaths() const { return int(m_Entries.size()); }
+
+		int GetNrOfHits() const { return m_NrOfHits; }
+		// Part of the hits: served from the end of a longer path
+		int GetNrOfSubPathHits() const { return m_NrOfSubPathHits; }
+		int GetNrOfMisses() const { return m_NrOfMisses; }
+		int GetNrOfEvictions() const { return m_NrOfEvictions; }
+
+	private:
+		struct Entry
+		{
+			unsigned int version;
+			Heuristic heuristic;
+			std::vector<int> path;
+			std::vector<float> costsSoFar;
+			size_t bytes;
+		};
+		typedef std::list<Entry>::iterator EntryIterator;
+
+		// A node on a cached path to goalIdx
+		struct Key
+		{
+			int nodeIdx;
+			int goalIdx;
+			unsigned int version;
+			Heuristic heuristic;
+
+			bool operator==(const Key& other) const
+			{
+				return nodeIdx == other.nodeIdx && goalIdx == other.goalIdx && version == other.version && heuristic == other.heuristic;
+			}
+		};
+
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const;
+		};
+
+		struct Location
+		{
+			EntryIterator entry;
+			int offset;
+		};
+
+		void EvictLeastRecentlyUsed();
+
+		size_t m_ByteBudget;
+		size_t m_UsedBytes = 0;
+
+		// Most recently used first
+		std::list<Entry> m_Entries;
+		// Where every node of every cached path is, the first path through a node keeps it
+		std::unordered_map<Key, Location, KeyHash> m_Locations;
+
+		int m_NrOfHits = 0;
+		int m_NrOfSubPathHits = 0;
+		int m_NrOfMisses = 0;
+		int m_NrOfEvictions = 0;
+	};
+}
@@ -0,0 +1,440 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EAStar.h: A* search over a CSR snapshot of the graph, with a binary heap as open list.
+// Searches can be spread over several frames with BeginSearch and ContinueSearch.
+// Requests between nodes that can't reach each other are rejected before searching (see EGraphAnalytics.h).
+// Paths between two nodes can be shared through a PathCache.
+// With landmarks (see ELandmarks.h) the heuristic is the largest of the landmark bound and the heuristic function.
+/*=============================================================================*/
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+#include "framework\EliteAI\EliteGraphs\EPathCache.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EGraphAnalytics.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EHeuristicFunctions.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\ELandmarks.h"
+
+namespace Elite
+{
+	// Node where a search can start or end, with the extra cost to get from the start position to the node
+	// or from the node to the goal position
+	struct PathEndpoint
+	{
+		int nodeIdx;
+		float cost;
+	};
+
+	enum class SearchStatus
+	{
+		Searching,
+		Found,
+		NotFound
+	};
+
+	// The search itself, on a snapshot only: it never touches the graph, so searches on different threads
+	// can share a snapshot as long as each has its own AStarSearch
+	class AStarSearch final
+	{
+	public:
+		explicit AStarSearch(Heuristic hFunction = HeuristicFunctions::Euclidean) : m_HeuristicFunction(hFunction) {}
+
+		// From the cheapest of the start nodes to the cheapest of the goal nodes, the heuristic is measured to goalPos
+		// The heuristic stays admissible if the cost of every goal is at least the distance from its node to goalPos
+		// The snapshot has to stay alive and unchanged until the search is done
+		void Begin(const GraphCSR* pCSR, const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos);
+		// Same request again, on another snapshot
+		void Restart(const GraphCSR* pCSR) { Begin(pCSR, m_Starts, m_Goals, m_GoalPos); }
+		// Expands at most maxNrOfExpansions nodes
+		SearchStatus Continue(int maxNrOfExpansions);
+
+		// Used by the searches that begin on the snapshot the landmarks were built for, not owned
+		void SetLandmarks(const Landmarks* pLandmarks) { m_pLandmarks = pLandmarks; }
+
+		const GraphCSR* GetCSR() const { return m_pCSR; }
+		Heuristic GetHeuristic() const { return m_HeuristicFunction; }
+		SearchStatus GetStatus() const { return m_Status; }
+		// Node indices from start to goal, empty without a path
+		std::vector<int> GetPath() const;
+		// Cost from the start to a node on the path
+		float GetCostSoFar(int nodeIdx) const { return m_CostSoFar[nodeIdx]; }
+		// Cost of the path including the endpoint costs (0 without a path), and nodes taken from the open list
+		float GetPathCost() const { return m_Status == SearchStatus::Found ? m_BestPathCost : 0.f; }
+		int GetNrOfExpandedNodes() const { return m_NrOfExpandedNodes; }
+
+	private:
+		struct NodeRecord
+		{
+			int nodeIdx;
+			float costSoFar;
+			float estimatedTotalCost;
+
+			// the open list is a max heap on this ordering: lowest estimate first, on equal estimates the one closest to the goal
+			bool operator<(const NodeRecord& other) const
+			{
+				if (estimatedTotalCost != other.estimatedTotalCost)
+					return estimatedTotalCost > other.estimatedTotalCost;
+				return costSoFar < other.costSoFar;
+			}
+		};
+
+		float GetHeuristicCost(int nodeIdx) const;
+		bool IsReached(int nodeIdx) const { return m_SearchIds[nodeIdx] == m_SearchId; }
+		void Reach(int nodeIdx, int parentIdx, float costSoFar);
+
+		Heuristic m_HeuristicFunction;
+		const GraphCSR* m_pCSR = nullptr;
+		const Landmarks* m_pLandmarks = nullptr;
+		// Goals the landmark bound is measured to, empty when not using landmarks
+		std::vector<PathEndpoint> m_LandmarkGoals;
+
+		// Search state, a node only counts as reached in the search that stamped it with its id
+		std::vector<NodeRecord> m_OpenList;
+		std::vector<float> m_CostSoFar;
+		std::vector<int> m_Parents;
+		std::vector<unsigned int> m_SearchIds;
+		unsigned int m_SearchId = 0;
+
+		// Request of the search in progress
+		std::vector<PathEndpoint> m_Starts;
+		std::vector<PathEndpoint> m_Goals;
+		Vector2 m_GoalPos;
+		SearchStatus m_Status = SearchStatus::NotFound;
+		int m_BestGoalIdx = invalid_node_index;
+		float m_BestPathCost = FLT_MAX;
+		int m_NrOfExpandedNodes = 0;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	class AStar
+	{
+	public:
+		AStar(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction = HeuristicFunctions::Euclidean);
+
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pGoalNode) const;
+		// See AStarSearch::Begin
+		std::vector<T_NodeType*> FindPath(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos) const;
+
+		// Time slicing: the same search as FindPath, spread over several calls to ContinueSearch
+		// The search starts over when nodes or connections are added or removed in between, it carries on with the
+		// old costs and positions when only those changed (they count from the next search on), one search at a time per AStar
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pGoalNode) const;
+		void BeginSearch(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos) const;
+		// Expands at most maxNrOfExpansions nodes
+		SearchStatus ContinueSearch(int maxNrOfExpansions) const;
+		SearchStatus GetSearchStatus() const { return m_IsCachedPath ? SearchStatus::Found : m_Search.GetStatus(); }
+		// Path of the last finished search, empty without a path
+		std::vector<T_NodeType*> GetPath() const;
+
+		// Results of the last search: cost of the path including the endpoint costs (0 without a path), and nodes taken from the open list
+		float GetLastPathCost() const { return m_IsCachedPath ? m_CachedPathCost : m_Search.GetPathCost(); }
+		int GetLastNrOfExpandedNodes() const { return m_IsCachedPath ? 0 : m_Search.GetNrOfExpandedNodes(); }
+		// Times the last search started over because nodes or connections were added or removed
+		int GetLastNrOfRestarts() const { return m_NrOfRestarts; }
+
+		// See AStarSearch::SetLandmarks, rebuild them when the graph changed
+		void SetLandmarks(const Landmarks* pLandmarks) { m_Search.SetLandmarks(pLandmarks); }
+
+		// Searches from one node to another look in the cache first, and add the paths they find to it
+		// The cache isn't owned and can be shared by searches on the same graph
+		void SetPathCache(PathCache* pPathCache) { m_pPathCache = pPathCache; }
+
+	private:
+		void UpdateCSR() const;
+		void AddToPathCache() const;
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		GraphAnalytics<T_NodeType, T_ConnectionType> m_Analytics;
+
+		// Snapshot, rebuilt when the graph changed (costs and positions matter here)
+		mutable GraphCSR m_CSR;
+		mutable bool m_IsCSRBuilt = false;
+		mutable AStarSearch m_Search;
+		mutable int m_NrOfRestarts = 0;
+
+		PathCache* m_pPathCache = nullptr;
+		mutable bool m_IsCachedPath = false;
+		mutable bool m_IsCacheable = false;
+		mutable std::vector<int> m_CachedPath;
+		mutable float m_CachedPathCost = 0.f;
+	};
+
+	inline void AStarSearch::Begin(const GraphCSR* pCSR, const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos)
+	{
+		// the request can be our own, when restarting
+		if (&starts != &m_Starts)
+		{
+			m_Starts = starts;
+			m_Goals = goals;
+			m_GoalPos = goalPos;
+		}
+
+		m_pCSR = pCSR;
+		m_Status = SearchStatus::NotFound;
+		m_BestGoalIdx = invalid_node_index;
+		m_BestPathCost = FLT_MAX;
+		m_NrOfExpandedNodes = 0;
+		m_OpenList.clear();
+
+		m_LandmarkGoals.clear();
+		if (!m_pCSR)
+			return;
+
+		if (m_pLandmarks && m_pLandmarks->IsBuiltFor(*m_pCSR))
+		{
+			for (const PathEndpoint& goal : m_Goals)
+			{
+				if (m_pCSR->IsNodeValid(goal.nodeIdx))
+					m_LandmarkGoals.push_back(goal);
+			}
+		}
+
+		const size_t nrOfNodes = size_t(m_pCSR->GetNrOfNodes());
+		if (m_SearchIds.size() < nrOfNodes)
+		{
+			m_CostSoFar.resize(nrOfNodes);
+			m_Parents.resize(nrOfNodes);
+			m_SearchIds.resize(nrOfNodes, 0);
+		}
+
+		if (++m_SearchId == 0)
+		{
+			// the ids wrapped around, stamps of old searches could match again
+			std::fill(m_SearchIds.begin(), m_SearchIds.end(), 0);
+			m_SearchId = 1;
+		}
+
+		for (const PathEndpoint& start : m_Starts)
+		{
+			if (!m_pCSR->IsNodeValid(start.nodeIdx) || (IsReached(start.nodeIdx) && m_CostSoFar[start.nodeIdx] <= start.cost))
+				continue;
+
+			Reach(start.nodeIdx, invalid_node_index, start.cost);
+			m_OpenList.push_back({ start.nodeIdx, start.cost, start.cost + GetHeuristicCost(start.nodeIdx) });
+			std::push_heap(m_OpenList.begin(), m_OpenList.end());
+		}
+
+		m_Status = SearchStatus::Searching;
+	}
+
+	inline SearchStatus AStarSearch::Continue(int maxNrOfExpansions)
+	{
+		if (m_Status != SearchStatus::Searching)
+			return m_Status;
+
+		for (int nrOfExpansions = 0; nrOfExpansions < maxNrOfExpansions; ++nrOfExpansions)
+		{
+			if (m_OpenList.empty())
+				break;
+
+			std::pop_heap(m_OpenList.begin(), m_OpenList.end());
+			const NodeRecord currentRecord = m_OpenList.back();
+			m_OpenList.pop_back();
+
+			// Nothing left on the open list can lead to a cheaper path
+			if (currentRecord.estimatedTotalCost >= m_BestPathCost)
+			{
+				m_OpenList.clear();
+				break;
+			}
+
+			// A cheaper route to this node was found after this record was added
+			if (currentRecord.costSoFar > m_CostSoFar[currentRecord.nodeIdx])
+				continue;
+
+			++m_NrOfExpandedNodes;
+
+			for (const PathEndpoint& goal : m_Goals)
+			{
+				if (goal.nodeIdx == currentRecord.nodeIdx && currentRecord.costSoFar + goal.cost < m_BestPathCost)
+				{
+					m_BestPathCost = currentRecord.costSoFar + goal.cost;
+					m_BestGoalIdx = goal.nodeIdx;
+				}
+			}
+
+			for (int arc = m_pCSR->GetFirstArc(currentRecord.nodeIdx); arc < m_pCSR->GetLastArc(currentRecord.nodeIdx); ++arc)
+			{
+				const int neighborIdx = m_pCSR->GetArcTarget(arc);
+				const float costSoFar = currentRecord.costSoFar + m_pCSR->GetArcCost(arc);
+
+				if (IsReached(neighborIdx) && m_CostSoFar[neighborIdx] <= costSoFar)
+					continue;
+
+				Reach(neighborIdx, currentRecord.nodeIdx, costSoFar);
+				m_OpenList.push_back({ neighborIdx, costSoFar, costSoFar + GetHeuristicCost(neighborIdx) });
+				std::push_heap(m_OpenList.begin(), m_OpenList.end());
+			}
+		}
+
+		if (!m_OpenList.empty())
+			return m_Status;
+
+		m_Status = m_BestGoalIdx == invalid_node_index ? SearchStatus::NotFound : SearchStatus::Found;
+		return m_Status;
+	}
+
+	inline std::vector<int> AStarSearch::GetPath() const
+	{
+		std::vector<int> path{};
+		if (m_Status != SearchStatus::Found)
+			return path;
+
+		// Track back from the goal to the start
+		for (int idx = m_BestGoalIdx; idx != invalid_node_index; idx = m_Parents[idx])
+			path.push_back(idx);
+		std::reverse(path.begin(), path.end());
+		return path;
+	}
+
+	inline float AStarSearch::GetHeuristicCost(int nodeIdx) const
+	{
+		const Vector2 toGoal = m_GoalPos - m_pCSR->GetNodePos(nodeIdx);
+		const float cost = m_HeuristicFunction(fabsf(toGoal.x), fabsf(toGoal.y));
+		if (m_LandmarkGoals.empty())
+			return cost;
+
+		// Still a lower bound with several goals: the cheapest of the goals
+		float landmarkCost = FLT_MAX;
+		for (const PathEndpoint& goal : m_LandmarkGoals)
+			landmarkCost = std::min(landmarkCost, m_pLandmarks->GetLowerBound(nodeIdx, goal.nodeIdx) + goal.cost);
+		return std::max(cost, landmarkCost);
+	}
+
+	inline void AStarSearch::Reach(int nodeIdx, int parentIdx, float costSoFar)
+	{
+		m_SearchIds[nodeIdx] = m_SearchId;
+		m_CostSoFar[nodeIdx] = costSoFar;
+		m_Parents[nodeIdx] = parentIdx;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline AStar<T_NodeType, T_ConnectionType>::AStar(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_Analytics(pGraph)
+		, m_Search(hFunction)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> AStar<T_NodeType, T_ConnectionType>::FindPath(T_NodeType* pStartNode, T_NodeType* pGoalNode) const
+	{
+		BeginSearch(pStartNode, pGoalNode);
+		ContinueSearch((std::numeric_limits<int>::max)());
+		return GetPath();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> AStar<T_NodeType, T_ConnectionType>::FindPath(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos) const
+	{
+		BeginSearch(starts, goals, goalPos);
+		ContinueSearch((std::numeric_limits<int>::max)());
+		return GetPath();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AStar<T_NodeType, T_ConnectionType>::BeginSearch(T_NodeType* pStartNode, T_NodeType* pGoalNode) const
+	{
+		if (!pStartNode || !pGoalNode)
+		{
+			BeginSearch({}, {}, Vector2{});
+			return;
+		}
+
+		const int startIdx = pStartNode->GetIndex();
+		const int goalIdx = pGoalNode->GetIndex();
+		if (m_pPathCache && m_pPathCache->TryGetPath(startIdx, goalIdx, m_pGraph->GetVersion(), m_Search.GetHeuristic(), m_CachedPath, m_CachedPathCost))
+		{
+			m_IsCachedPath = true;
+			m_IsCacheable = false;
+			return;
+		}
+
+		BeginSearch({ PathEndpoint{ startIdx, 0.f } }, { PathEndpoint{ goalIdx, 0.f } }, m_pGraph->GetNodePos(goalIdx));
+		m_IsCacheable = m_pPathCache != nullptr;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AStar<T_NodeType, T_ConnectionType>::BeginSearch(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals, const Vector2& goalPos) const
+	{
+		m_IsCachedPath = false;
+		m_IsCacheable = false;
+		m_NrOfRestarts = 0;
+
+		// O(1) per pair once the components are known, no search needed when every goal is in another component
+		bool canReachGoal = false;
+		for (const PathEndpoint& start : starts)
+		{
+			for (const PathEndpoint& goal : goals)
+			{
+				if (!m_Analytics.IsUnreachable(start.nodeIdx, goal.nodeIdx))
+					canReachGoal = true;
+			}
+		}
+		if (!canReachGoal)
+		{
+			m_Search.Begin(nullptr, starts, goals, goalPos);
+			return;
+		}
+
+		UpdateCSR();
+		m_Search.Begin(&m_CSR, starts, goals, goalPos);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline SearchStatus AStar<T_NodeType, T_ConnectionType>::ContinueSearch(int maxNrOfExpansions) const
+	{
+		if (m_IsCachedPath)
+			return SearchStatus::Found;
+
+		// The nodes and connections the search started on are out of date, changed costs don't restart it
+		// (a graph edited every frame would never let a sliced search finish)
+		if (m_Search.GetStatus() == SearchStatus::Searching && m_CSR.GetTopologyVersion() != m_pGraph->GetTopologyVersion())
+		{
+			UpdateCSR();
+			m_Search.Restart(&m_CSR);
+			++m_NrOfRestarts;
+		}
+
+		const SearchStatus status = m_Search.Continue(maxNrOfExpansions);
+		if (status == SearchStatus::Found && m_IsCacheable)
+			AddToPathCache();
+		return status;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> AStar<T_NodeType, T_ConnectionType>::GetPath() const
+	{
+		std::vector<T_NodeType*> path{};
+		for (int idx : m_IsCachedPath ? m_CachedPath : m_Search.GetPath())
+			path.push_back(m_pGraph->GetNode(idx));
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AStar<T_NodeType, T_ConnectionType>::UpdateCSR() const
+	{
+		if (m_IsCSRBuilt && m_CSR.GetVersion() == m_pGraph->GetVersion())
+			return;
+
+		m_CSR.Build(*m_pGraph);
+		m_IsCSRBuilt = true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AStar<T_NodeType, T_ConnectionType>::AddToPathCache() const
+	{
+		m_IsCacheable = false;
+
+		// Found with costs that changed since, it would be cached as a path of a version it wasn't searched on
+		if (m_CSR.GetVersion() != m_pGraph->GetVersion())
+			return;
+
+		const std::vector<int> path = m_Search.GetPath();
+		std::vector<float> costsSoFar{};
+		costsSoFar.reserve(path.size());
+		for (int idx : path)
+			costsSoFar.push_back(m_Search.GetCostSoFar(idx));
+
+		m_pPathCache->AddPath(m_pGraph->GetVersion(), m_Search.GetHeuristic(), path, costsSoFar);
+	}
+}
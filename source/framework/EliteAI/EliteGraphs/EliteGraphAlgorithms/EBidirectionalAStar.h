@@ -0,0 +1,472 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EBidirectionalAStar.h: Point to point search growing from the start and from the goal at the same time,
+// until the two searches meet. On long queries both balls stay small, instead of one ball reaching the whole way.
+// The backward search follows the connections in reverse: a directed graph gets a transposed snapshot
+// (built when the first search needs it), an undirected graph uses its own snapshot for both directions.
+// Both searches share the average potential p(n) = (h(n, goal) - h(start, n)) / 2, which keeps the reduced
+// costs of the two directions consistent with each other (Ikeda et al.). Without a heuristic function and
+// without landmarks the potential is 0 everywhere, and the search is bidirectional Dijkstra.
+/*=============================================================================*/
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAStar.h"
+
+namespace Elite
+{
+	// The search itself, on snapshots only (see AStarSearch)
+	class BidirectionalAStarSearch final
+	{
+	public:
+		// A null heuristic function makes this bidirectional Dijkstra
+		explicit BidirectionalAStarSearch(Heuristic hFunction = HeuristicFunctions::Euclidean) : m_HeuristicFunction(hFunction) {}
+
+		// From the cheapest of the start nodes to the cheapest of the goal nodes
+		// The reverse snapshot has the connections arriving at every node, the snapshot itself for an undirected graph
+		// The heuristic has to be consistent in both directions (the graph's costs at least the distance covered), or the path can be too long
+		void Begin(const GraphCSR* pCSR, const GraphCSR* pReverseCSR, const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals);
+		// Same request again, on other snapshots
+		void Restart(const GraphCSR* pCSR, const GraphCSR* pReverseCSR) { Begin(pCSR, pReverseCSR, m_Starts, m_Goals); }
+		// Expands at most maxNrOfExpansions nodes, over both directions
+		SearchStatus Continue(int maxNrOfExpansions);
+
+		// See AStarSearch::SetLandmarks
+		void SetLandmarks(const Landmarks* pLandmarks) { m_pLandmarks = pLandmarks; }
+
+		Heuristic GetHeuristic() const { return m_HeuristicFunction; }
+		SearchStatus GetStatus() const { return m_Status; }
+		// Node indices from start to goal, empty without a path
+		std::vector<int> GetPath() const;
+		// Cost of the path including the endpoint costs (0 without a path), and nodes taken from both open lists
+		float GetPathCost() const { return m_Status == SearchStatus::Found ? m_BestPathCost : 0.f; }
+		int GetNrOfExpandedNodes() const { return m_NrOfExpandedNodes; }
+
+	private:
+		struct NodeRecord
+		{
+			int nodeIdx;
+			float costSoFar;
+			// cost so far plus the potential of the direction, the open lists are ordered on this
+			float key;
+
+			bool operator<(const NodeRecord& other) const
+			{
+				if (key != other.key)
+					return key > other.key;
+				return costSoFar < other.costSoFar;
+			}
+		};
+
+		// One of the two searches, the backward one measures its costs to the goal
+		struct Direction
+		{
+			const GraphCSR* pCSR = nullptr;
+			std::vector<NodeRecord> openList;
+			std::vector<float> costSoFar;
+			std::vector<int> parents;
+			std::vector<unsigned int> searchIds;
+
+			bool IsReached(int nodeIdx, unsigned int searchId) const { return searchIds[nodeIdx] == searchId; }
+			float GetTopKey() const { return openList.empty() ? FLT_MAX : openList.front().key; }
+		};
+
+		void Expand(Direction& direction, const Direction& otherDirection, bool isForward);
+		void Reach(Direction& direction, int nodeIdx, int parentIdx, float costSoFar, float key);
+
+		// p(n) of the forward search, the backward search uses -p(n)
+		float GetPotential(int nodeIdx) const;
+		// Lower bounds on the cost from the cheapest start and to the cheapest goal
+		float GetCostFromStartBound(int nodeIdx) const;
+		float GetCostToGoalBound(int nodeIdx) const;
+
+		Heuristic m_HeuristicFunction;
+		const Landmarks* m_pLandmarks = nullptr;
+		bool m_UseLandmarks = false;
+
+		Direction m_Forward;
+		Direction m_Backward;
+		unsigned int m_SearchId = 0;
+
+		// Request of the search in progress
+		std::vector<PathEndpoint> m_Starts;
+		std::vector<PathEndpoint> m_Goals;
+		SearchStatus m_Status = SearchStatus::NotFound;
+		// Node where the best path found so far goes from the forward search into the backward one
+		int m_MeetingIdx = invalid_node_index;
+		float m_BestPathCost = FLT_MAX;
+		int m_NrOfExpandedNodes = 0;
+	};
+
+	// Same interface as AStar, for searches between two nodes far apart
+	template <class T_NodeType, class T_ConnectionType>
+	class BidirectionalAStar
+	{
+	public:
+		BidirectionalAStar(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction = HeuristicFunctions::Euclidean);
+
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pGoalNode) const;
+		// See BidirectionalAStarSearch::Begin
+		std::vector<T_NodeType*> FindPath(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals) const;
+
+		// Time slicing, see AStar::BeginSearch
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pGoalNode) const;
+		void BeginSearch(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals) const;
+		SearchStatus ContinueSearch(int maxNrOfExpansions) const;
+		SearchStatus GetSearchStatus() const { return m_Search.GetStatus(); }
+		// Path of the last finished search, empty without a path
+		std::vector<T_NodeType*> GetPath() const;
+
+		// Results of the last search: cost of the path including the endpoint costs (0 without a path), and nodes taken from the open lists
+		float GetLastPathCost() const { return m_Search.GetPathCost(); }
+		int GetLastNrOfExpandedNodes() const { return m_Search.GetNrOfExpandedNodes(); }
+		// See AStar::GetLastNrOfRestarts
+		int GetLastNrOfRestarts() const { return m_NrOfRestarts; }
+
+		// See AStarSearch::SetLandmarks, rebuild them when the graph changed
+		void SetLandmarks(const Landmarks* pLandmarks) { m_Search.SetLandmarks(pLandmarks); }
+
+	private:
+		void UpdateCSR() const;
+		const GraphCSR* GetReverseCSR() const;
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		GraphAnalytics<T_NodeType, T_ConnectionType> m_Analytics;
+
+		// Snapshots, rebuilt when the graph changed, the reverse one only for directed graphs and only when searched
+		mutable GraphCSR m_CSR;
+		mutable GraphCSR m_ReverseCSR;
+		mutable bool m_IsCSRBuilt = false;
+		mutable bool m_IsReverseCSRBuilt = false;
+		mutable BidirectionalAStarSearch m_Search;
+		mutable int m_NrOfRestarts = 0;
+	};
+
+	// Bidirectional A* without an estimate
+	template <class T_NodeType, class T_ConnectionType>
+	class BidirectionalDijkstra final : public BidirectionalAStar<T_NodeType, T_ConnectionType>
+	{
+	public:
+		explicit BidirectionalDijkstra(IGraph<T_NodeType, T_ConnectionType>* pGraph) : BidirectionalAStar<T_NodeType, T_ConnectionType>(pGraph, nullptr) {}
+	};
+
+	inline void BidirectionalAStarSearch::Begin(const GraphCSR* pCSR, const GraphCSR* pReverseCSR, const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals)
+	{
+		// the request can be our own, when restarting
+		if (&starts != &m_Starts)
+		{
+			m_Starts = starts;
+			m_Goals = goals;
+		}
+
+		m_Forward.pCSR = pCSR;
+		m_Backward.pCSR = pReverseCSR;
+		m_Status = SearchStatus::NotFound;
+		m_MeetingIdx = invalid_node_index;
+		m_BestPathCost = FLT_MAX;
+		m_NrOfExpandedNodes = 0;
+		m_Forward.openList.clear();
+		m_Backward.openList.clear();
+
+		if (!pCSR || !pReverseCSR)
+			return;
+
+		// Landmark bounds are only used when they hold for every endpoint
+		m_UseLandmarks = m_pLandmarks && m_pLandmarks->IsBuiltFor(*pCSR);
+		for (const PathEndpoint& endpoint : m_Starts)
+			m_UseLandmarks = m_UseLandmarks && pCSR->IsNodeValid(endpoint.nodeIdx);
+		for (const PathEndpoint& endpoint : m_Goals)
+			m_UseLandmarks = m_UseLandmarks && pCSR->IsNodeValid(endpoint.nodeIdx);
+
+		const size_t nrOfNodes = size_t(pCSR->GetNrOfNodes());
+		for (Direction* pDirection : { &m_Forward, &m_Backward })
+		{
+			if (pDirection->searchIds.size() < nrOfNodes)
+			{
+				pDirection->costSoFar.resize(nrOfNodes);
+				pDirection->parents.resize(nrOfNodes);
+				pDirection->searchIds.resize(nrOfNodes, 0);
+			}
+		}
+
+		if (++m_SearchId == 0)
+		{
+			// the ids wrapped around, stamps of old searches could match again
+			std::fill(m_Forward.searchIds.begin(), m_Forward.searchIds.end(), 0);
+			std::fill(m_Backward.searchIds.begin(), m_Backward.searchIds.end(), 0);
+			m_SearchId = 1;
+		}
+
+		for (const PathEndpoint& start : m_Starts)
+		{
+			if (!pCSR->IsNodeValid(start.nodeIdx) || (m_Forward.IsReached(start.nodeIdx, m_SearchId) && m_Forward.costSoFar[start.nodeIdx] <= start.cost))
+				continue;
+
+			Reach(m_Forward, start.nodeIdx, invalid_node_index, start.cost, start.cost + GetPotential(start.nodeIdx));
+		}
+
+		for (const PathEndpoint& goal : m_Goals)
+		{
+			if (!pCSR->IsNodeValid(goal.nodeIdx) || (m_Backward.IsReached(goal.nodeIdx, m_SearchId) && m_Backward.costSoFar[goal.nodeIdx] <= goal.cost))
+				continue;
+
+			Reach(m_Backward, goal.nodeIdx, invalid_node_index, goal.cost, goal.cost - GetPotential(goal.nodeIdx));
+
+			// A start that is also a goal
+			if (m_Forward.IsReached(goal.nodeIdx, m_SearchId) && m_Forward.costSoFar[goal.nodeIdx] + goal.cost < m_BestPathCost)
+			{
+				m_BestPathCost = m_Forward.costSoFar[goal.nodeIdx] + goal.cost;
+				m_MeetingIdx = goal.nodeIdx;
+			}
+		}
+
+		m_Status = SearchStatus::Searching;
+	}
+
+	inline SearchStatus BidirectionalAStarSearch::Continue(int maxNrOfExpansions)
+	{
+		if (m_Status != SearchStatus::Searching)
+			return m_Status;
+
+		for (int nrOfExpansions = 0; nrOfExpansions < maxNrOfExpansions; ++nrOfExpansions)
+		{
+			// With an empty open list one side has seen everything it can reach, any path left was found by it
+			// Otherwise a path not found yet costs at least the sum of the lowest keys (the potentials cancel out)
+			const float forwardKey = m_Forward.GetTopKey();
+			const float backwardKey = m_Backward.GetTopKey();
+			if (forwardKey == FLT_MAX || backwardKey == FLT_MAX || forwardKey + backwardKey >= m_BestPathCost)
+			{
+				m_Forward.openList.clear();
+				m_Backward.openList.clear();
+				break;
+			}
+
+			// Grow the side that is behind, the balls meet about halfway
+			if (forwardKey <= backwardKey)
+				Expand(m_Forward, m_Backward, true);
+			else
+				Expand(m_Backward, m_Forward, false);
+		}
+
+		if (!m_Forward.openList.empty() || !m_Backward.openList.empty())
+			return m_Status;
+
+		m_Status = m_MeetingIdx == invalid_node_index ? SearchStatus::NotFound : SearchStatus::Found;
+		return m_Status;
+	}
+
+	inline void BidirectionalAStarSearch::Expand(Direction& direction, const Direction& otherDirection, bool isForward)
+	{
+		std::pop_heap(direction.openList.begin(), direction.openList.end());
+		const NodeRecord currentRecord = direction.openList.back();
+		direction.openList.pop_back();
+
+		// A cheaper route to this node was found after this record was added
+		if (currentRecord.costSoFar > direction.costSoFar[currentRecord.nodeIdx])
+			return;
+
+		++m_NrOfExpandedNodes;
+
+		const GraphCSR* pCSR = direction.pCSR;
+		for (int arc = pCSR->GetFirstArc(currentRecord.nodeIdx); arc < pCSR->GetLastArc(currentRecord.nodeIdx); ++arc)
+		{
+			const int neighborIdx = pCSR->GetArcTarget(arc);
+			const float costSoFar = currentRecord.costSoFar + pCSR->GetArcCost(arc);
+
+			if (direction.IsReached(neighborIdx, m_SearchId) && direction.costSoFar[neighborIdx] <= costSoFar)
+				continue;
+
+			const float potential = GetPotential(neighborIdx);
+			Reach(direction, neighborIdx, currentRecord.nodeIdx, costSoFar, isForward ? costSoFar + potential : costSoFar - potential);
+
+			// The other search was here already, a path from start to goal through this node
+			if (otherDirection.IsReached(neighborIdx, m_SearchId) && costSoFar + otherDirection.costSoFar[neighborIdx] < m_BestPathCost)
+			{
+				m_BestPathCost = costSoFar + otherDirection.costSoFar[neighborIdx];
+				m_MeetingIdx = neighborIdx;
+			}
+		}
+	}
+
+	inline std::vector<int> BidirectionalAStarSearch::GetPath() const
+	{
+		std::vector<int> path{};
+		if (m_Status != SearchStatus::Found)
+			return path;
+
+		// Track back from the meeting node to the start, then follow the backward search on to the goal
+		for (int idx = m_MeetingIdx; idx != invalid_node_index; idx = m_Forward.parents[idx])
+			path.push_back(idx);
+		std::reverse(path.begin(), path.end());
+		for (int idx = m_Backward.parents[m_MeetingIdx]; idx != invalid_node_index; idx = m_Backward.parents[idx])
+			path.push_back(idx);
+		return path;
+	}
+
+	inline void BidirectionalAStarSearch::Reach(Direction& direction, int nodeIdx, int parentIdx, float costSoFar, float key)
+	{
+		direction.searchIds[nodeIdx] = m_SearchId;
+		direction.costSoFar[nodeIdx] = costSoFar;
+		direction.parents[nodeIdx] = parentIdx;
+		direction.openList.push_back({ nodeIdx, costSoFar, key });
+		std::push_heap(direction.openList.begin(), direction.openList.end());
+	}
+
+	inline float BidirectionalAStarSearch::GetPotential(int nodeIdx) const
+	{
+		return 0.5f * (GetCostToGoalBound(nodeIdx) - GetCostFromStartBound(nodeIdx));
+	}
+
+	inline float BidirectionalAStarSearch::GetCostFromStartBound(int nodeIdx) const
+	{
+		if (!m_HeuristicFunction && !m_UseLandmarks)
+			return 0.f;
+
+		// The cheapest over the starts: the minimum of consistent bounds is consistent
+		const Vector2 nodePos = m_Forward.pCSR->GetNodePos(nodeIdx);
+		float bound = FLT_MAX;
+		for (const PathEndpoint& start : m_Starts)
+		{
+			float cost = 0.f;
+			if (m_HeuristicFunction)
+			{
+				const Vector2 fromStart = nodePos - m_Forward.pCSR->GetNodePos(start.nodeIdx);
+				cost = m_HeuristicFunction(fabsf(fromStart.x), fabsf(fromStart.y));
+			}
+			if (m_UseLandmarks)
+				cost = std::max(cost, m_pLandmarks->GetLowerBound(start.nodeIdx, nodeIdx));
+			bound = std::min(bound, start.cost + cost);
+		}
+		return bound == FLT_MAX ? 0.f : bound;
+	}
+
+	inline float BidirectionalAStarSearch::GetCostToGoalBound(int nodeIdx) const
+	{
+		if (!m_HeuristicFunction && !m_UseLandmarks)
+			return 0.f;
+
+		const Vector2 nodePos = m_Forward.pCSR->GetNodePos(nodeIdx);
+		float bound = FLT_MAX;
+		for (const PathEndpoint& goal : m_Goals)
+		{
+			float cost = 0.f;
+			if (m_HeuristicFunction)
+			{
+				const Vector2 toGoal = m_Forward.pCSR->GetNodePos(goal.nodeIdx) - nodePos;
+				cost = m_HeuristicFunction(fabsf(toGoal.x), fabsf(toGoal.y));
+			}
+			if (m_UseLandmarks)
+				cost = std::max(cost, m_pLandmarks->GetLowerBound(nodeIdx, goal.nodeIdx));
+			bound = std::min(bound, goal.cost + cost);
+		}
+		return bound == FLT_MAX ? 0.f : bound;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline BidirectionalAStar<T_NodeType, T_ConnectionType>::BidirectionalAStar(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_Analytics(pGraph)
+		, m_Search(hFunction)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> BidirectionalAStar<T_NodeType, T_ConnectionType>::FindPath(T_NodeType* pStartNode, T_NodeType* pGoalNode) const
+	{
+		BeginSearch(pStartNode, pGoalNode);
+		ContinueSearch((std::numeric_limits<int>::max)());
+		return GetPath();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> BidirectionalAStar<T_NodeType, T_ConnectionType>::FindPath(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals) const
+	{
+		BeginSearch(starts, goals);
+		ContinueSearch((std::numeric_limits<int>::max)());
+		return GetPath();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void BidirectionalAStar<T_NodeType, T_ConnectionType>::BeginSearch(T_NodeType* pStartNode, T_NodeType* pGoalNode) const
+	{
+		if (!pStartNode || !pGoalNode)
+		{
+			BeginSearch({}, {});
+			return;
+		}
+
+		BeginSearch({ PathEndpoint{ pStartNode->GetIndex(), 0.f } }, { PathEndpoint{ pGoalNode->GetIndex(), 0.f } });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void BidirectionalAStar<T_NodeType, T_ConnectionType>::BeginSearch(const std::vector<PathEndpoint>& starts, const std::vector<PathEndpoint>& goals) const
+	{
+		// See AStar::BeginSearch
+		m_NrOfRestarts = 0;
+		bool canReachGoal = false;
+		for (const PathEndpoint& start : starts)
+		{
+			for (const PathEndpoint& goal : goals)
+			{
+				if (!m_Analytics.IsUnreachable(start.nodeIdx, goal.nodeIdx))
+					canReachGoal = true;
+			}
+		}
+		if (!canReachGoal)
+		{
+			m_Search.Begin(nullptr, nullptr, starts, goals);
+			return;
+		}
+
+		UpdateCSR();
+		m_Search.Begin(&m_CSR, GetReverseCSR(), starts, goals);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline SearchStatus BidirectionalAStar<T_NodeType, T_ConnectionType>::ContinueSearch(int maxNrOfExpansions) const
+	{
+		// Only restarts when nodes or connections were added or removed, see AStar::ContinueSearch
+		if (m_Search.GetStatus() == SearchStatus::Searching && m_CSR.GetTopologyVersion() != m_pGraph->GetTopologyVersion())
+		{
+			UpdateCSR();
+			m_Search.Restart(&m_CSR, GetReverseCSR());
+			++m_NrOfRestarts;
+		}
+
+		return m_Search.Continue(maxNrOfExpansions);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> BidirectionalAStar<T_NodeType, T_ConnectionType>::GetPath() const
+	{
+		std::vector<T_NodeType*> path{};
+		for (int idx : m_Search.GetPath())
+			path.push_back(m_pGraph->GetNode(idx));
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void BidirectionalAStar<T_NodeType, T_ConnectionType>::UpdateCSR() const
+	{
+		if (m_IsCSRBuilt && m_CSR.GetVersion() == m_pGraph->GetVersion())
+			return;
+
+		m_CSR.Build(*m_pGraph);
+		m_IsCSRBuilt = true;
+		m_IsReverseCSRBuilt = false;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline const GraphCSR* BidirectionalAStar<T_NodeType, T_ConnectionType>::GetReverseCSR() const
+	{
+		// Every connection has its twin in an undirected graph, the arcs arriving at a node are the ones leaving it
+		if (!m_CSR.IsDirectionalGraph())
+			return &m_CSR;
+
+		if (!m_IsReverseCSRBuilt)
+		{
+			m_ReverseCSR.BuildTransposed(m_CSR);
+			m_IsReverseCSRBuilt = true;
+		}
+		return &m_ReverseCSR;
+	}
+}
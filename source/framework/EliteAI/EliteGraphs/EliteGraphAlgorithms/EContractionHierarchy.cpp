@@ -0,0 +1,799 @@
+#include "stdafx.h"
+#include "EContractionHierarchy.h"
+
+#include "framework\EliteHelpers\EMemoryMappedFile.h"
+
+using namespace Elite;
+
+namespace
+{
+	struct ContractionHierarchyFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t fingerprint;
+		int32_t nrOfNodes;
+		int32_t nrOfUpArcs;
+		int32_t nrOfDownArcs;
+		int32_t nrOfShortcuts;
+	};
+
+	// Witness searches give up after this many nodes, the shortcut is added then (never wrong, only one arc too many)
+	// Estimating the priority of a node only needs the number of shortcuts roughly
+	const int MAX_WITNESS_SETTLED_NODES = 500;
+	const int MAX_PRIORITY_WITNESS_SETTLED_NODES = 50;
+
+	// Connection of the graph that is left while contracting, to or from the node whose list it is in
+	struct Edge
+	{
+		int nodeIdx;
+		float cost;
+		int middleIdx;
+	};
+
+	struct Shortcut
+	{
+		int fromIdx;
+		int toIdx;
+		float cost;
+	};
+
+	// Dijkstra search on what is left of the graph, one per thread
+	struct WitnessSearch
+	{
+		typedef std::pair<float, int> QueueEntry;
+		std::vector<QueueEntry> openList;
+		std::vector<float> costs;
+		std::vector<unsigned int> searchIds;
+		// The out-neighbors of the contracted node are stamped with the id of the search, it stops once it settled all of them
+		std::vector<unsigned int> targetIds;
+		unsigned int searchId = 0;
+
+		float GetCost(int idx) const { return searchIds[idx] == searchId ? costs[idx] : FLT_MAX; }
+	};
+
+	class Contractor final
+	{
+	public:
+		Contractor(const GraphCSR& graph, ThreadPool* pThreadPool);
+
+		// Contracts every node, calls onContract(idx, outEdges, inEdges) in the order of contraction
+		template<class T_Func>
+		void ContractAll(T_Func onContract);
+
+		//C++ make the class non-copyable
+		Contractor(const Contractor&) = delete;
+		Contractor& operator=(const Contractor&) = delete;
+
+	private:
+		const int m_NrOfNodes;
+		ThreadPool* m_pThreadPool;
+
+		std::vector<std::vector<Edge>> m_OutEdges;
+		std::vector<std::vector<Edge>> m_InEdges;
+		std::vector<bool> m_IsContracted;
+		std::vector<int> m_NrOfContractedNeighbors;
+		// Length of the longest chain of contracted nodes below a node
+		std::vector<int> m_Levels;
+		std::vector<int> m_Priorities;
+
+		std::mutex m_SearchMutex;
+		std::vector<std::unique_ptr<WitnessSearch>> m_FreeSearches;
+
+		// Calls func(i, search) for every i in [0, count), in parallel when there is a thread pool
+		template<class T_Func>
+		void ForEach(int count, T_Func func);
+
+		void FindShortcuts(int idx, WitnessSearch& search, int maxSettledNodes, std::vector<Shortcut>& shortcuts) const;
+		void RunWitnessSearch(WitnessSearch& search, int startIdx, int skippedIdx, float maxCost, int maxSettledNodes) const;
+		int ComputePriority(int idx, WitnessSearch& search) const;
+		// Lower priority first, ties broken by a hash of the index so neighboring nodes don't wait on each other
+		bool IsBefore(int idx, int otherIdx) const;
+		void AddEdge(int fromIdx, int toIdx, float cost, int middleIdx);
+		static void RemoveEdge(std::vector<Edge>& edges, int nodeIdx);
+	};
+
+	Contractor::Contractor(const GraphCSR& graph, ThreadPool* pThreadPool)
+		: m_NrOfNodes(graph.GetNrOfNodes())
+		, m_pThreadPool(pThreadPool)
+		, m_OutEdges(m_NrOfNodes)
+		, m_InEdges(m_NrOfNodes)
+		, m_IsContracted(m_NrOfNodes, false)
+		, m_NrOfContractedNeighbors(m_NrOfNodes, 0)
+		, m_Levels(m_NrOfNodes, 0)
+		, m_Priorities(m_NrOfNodes, 0)
+	{
+		for (int idx = 0; idx < m_NrOfNodes; ++idx)
+		{
+			for (int arc = graph.GetFirstArc(idx); arc < graph.GetLastArc(idx); ++arc)
+			{
+				if (graph.GetArcTarget(arc) != idx)
+					AddEdge(idx, graph.GetArcTarget(arc), graph.GetArcCost(arc), invalid_node_index);
+			}
+		}
+	}
+
+	template<class T_Func>
+	void Contractor::ContractAll(T_Func onContract)
+	{
+		std::vector<int> remainingNodes{};
+		for (int idx = 0; idx < m_NrOfNodes; ++idx)
+		{
+			if (!m_OutEdges[idx].empty() || !m_InEdges[idx].empty())
+				remainingNodes.push_back(idx);
+			else
+				m_IsContracted[idx] = true;
+		}
+
+		// Nodes without connections are the least important of all
+		for (int idx = 0; idx < m_NrOfNodes; ++idx)
+		{
+			if (m_IsContracted[idx])
+				onContract(idx, m_OutEdges[idx], m_InEdges[idx]);
+		}
+
+		ForEach(int(remainingNodes.size()), [this, &remainingNodes](int i, WitnessSearch& search)
+		{
+			m_Priorities[remainingNodes[i]] = ComputePriority(remainingNodes[i], search);
+		});
+
+		std::vector<int> batch{};
+		std::vector<std::vector<Shortcut>> batchShortcuts{};
+		std::vector<int> dirtyNodes{};
+		std::vector<bool> isDirty(m_NrOfNodes, false);
+
+		while (!remainingNodes.empty())
+		{
+			// Nodes that come before all of their neighbors, no two of them are neighbors
+			batch.clear();
+			for (int idx : remainingNodes)
+			{
+				bool isFirst = true;
+				for (const Edge& edge : m_OutEdges[idx])
+					isFirst = isFirst && IsBefore(idx, edge.nodeIdx);
+				for (const Edge& edge : m_InEdges[idx])
+					isFirst = isFirst && IsBefore(idx, edge.nodeIdx);
+				if (isFirst)
+					batch.push_back(idx);
+			}
+
+			// The witness searches of the batch don't go through any node of it, so each node's shortcuts
+			// are needed no matter which of the others are contracted
+			for (int idx : batch)
+				m_IsContracted[idx] = true;
+
+			batchShortcuts.resize(batch.size());
+			ForEach(int(batch.size()), [this, &batch, &batchShortcuts](int i, WitnessSearch& search)
+			{
+				FindShortcuts(batch[i], search, MAX_WITNESS_SETTLED_NODES, batchShortcuts[i]);
+			});
+
+			dirtyNodes.clear();
+			for (size_t i = 0; i < batch.size(); ++i)
+			{
+				const int idx = batch[i];
+				onContract(idx, m_OutEdges[idx], m_InEdges[idx]);
+
+				for (const Edge& edge : m_OutEdges[idx])
+				{
+					RemoveEdge(m_InEdges[edge.nodeIdx], idx);
+					++m_NrOfContractedNeighbors[edge.nodeIdx];
+					m_Levels[edge.nodeIdx] = std::max(m_Levels[edge.nodeIdx], m_Levels[idx] + 1);
+					if (!isDirty[edge.nodeIdx])
+					{
+						isDirty[edge.nodeIdx] = true;
+						dirtyNodes.push_back(edge.nodeIdx);
+					}
+				}
+				for (const Edge& edge : m_InEdges[idx])
+				{
+					RemoveEdge(m_OutEdges[edge.nodeIdx], idx);
+					++m_NrOfContractedNeighbors[edge.nodeIdx];
+					m_Levels[edge.nodeIdx] = std::max(m_Levels[edge.nodeIdx], m_Levels[idx] + 1);
+					if (!isDirty[edge.nodeIdx])
+					{
+						isDirty[edge.nodeIdx] = true;
+						dirtyNodes.push_back(edge.nodeIdx);
+					}
+				}
+
+				for (const Shortcut& shortcut : batchShortcuts[i])
+					AddEdge(shortcut.fromIdx, shortcut.toIdx, shortcut.cost, idx);
+
+				m_OutEdges[idx] = std::vector<Edge>{};
+				m_InEdges[idx] = std::vector<Edge>{};
+			}
+
+			// Only the neighbors of the contracted nodes have other edges now
+			ForEach(int(dirtyNodes.size()), [this, &dirtyNodes](int i, WitnessSearch& search)
+			{
+				m_Priorities[dirtyNodes[i]] = ComputePriority(dirtyNodes[i], search);
+			});
+			for (int idx : dirtyNodes)
+				isDirty[idx] = false;
+
+			remainingNodes.erase(std::remove_if(remainingNodes.begin(), remainingNodes.end(),
+				[this](int idx) { return m_IsContracted[idx]; }), remainingNodes.end());
+		}
+	}
+
+	template<class T_Func>
+	void Contractor::ForEach(int count, T_Func func)
+	{
+		auto forRange = [this, &func](int begin, int end)
+		{
+			std::unique_ptr<WitnessSearch> pSearch{};
+			{
+				std::lock_guard<std::mutex> lock(m_SearchMutex);
+				if (!m_FreeSearches.empty())
+				{
+					pSearch = std::move(m_FreeSearches.back());
+					m_FreeSearches.pop_back();
+				}
+			}
+			if (!pSearch)
+				pSearch.reset(new WitnessSearch{});
+			if (pSearch->costs.size() < size_t(m_NrOfNodes))
+			{
+				pSearch->costs.resize(m_NrOfNodes);
+				pSearch->searchIds.resize(m_NrOfNodes, 0);
+				pSearch->targetIds.resize(m_NrOfNodes, 0);
+			}
+
+			for (int i = begin; i < end; ++i)
+				func(i, *pSearch);
+
+			std::lock_guard<std::mutex> lock(m_SearchMutex);
+			m_FreeSearches.push_back(std::move(pSearch));
+		};
+
+		if (m_pThreadPool && count > 1)
+			m_pThreadPool->ParallelFor(count, 16, forRange);
+		else if (count > 0)
+			forRange(0, count);
+	}
+
+	void Contractor::FindShortcuts(int idx, WitnessSearch& search, int maxSettledNodes, std::vector<Shortcut>& shortcuts) const
+	{
+		shortcuts.clear();
+		for (const Edge& inEdge : m_InEdges[idx])
+		{
+			float maxCost = 0.f;
+			for (const Edge& outEdge : m_OutEdges[idx])
+			{
+				if (outEdge.nodeIdx != inEdge.nodeIdx)
+					maxCost = std::max(maxCost, inEdge.cost + outEdge.cost);
+			}
+			if (maxCost == 0.f)
+				continue;
+
+			RunWitnessSearch(search, inEdge.nodeIdx, idx, maxCost, maxSettledNodes);
+			for (const Edge& outEdge : m_OutEdges[idx])
+			{
+				const float cost = inEdge.cost + outEdge.cost;
+				if (outEdge.nodeIdx != inEdge.nodeIdx && search.GetCost(outEdge.nodeIdx) > cost)
+					shortcuts.push_back({ inEdge.nodeIdx, outEdge.nodeIdx, cost });
+			}
+		}
+	}
+
+	void Contractor::RunWitnessSearch(WitnessSearch& search, int startIdx, int skippedIdx, float maxCost, int maxSettledNodes) const
+	{
+		if (++search.searchId == 0)
+		{
+			std::fill(search.searchIds.begin(), search.searchIds.end(), 0);
+			std::fill(search.targetIds.begin(), search.targetIds.end(), 0);
+			search.searchId = 1;
+		}
+
+		int nrOfTargets = 0;
+		for (const Edge& outEdge : m_OutEdges[skippedIdx])
+		{
+			if (outEdge.nodeIdx != startIdx)
+			{
+				search.targetIds[outEdge.nodeIdx] = search.searchId;
+				++nrOfTargets;
+			}
+		}
+
+		auto compare = std::greater<WitnessSearch::QueueEntry>{};
+		search.openList.clear();
+		search.openList.push_back({ 0.f, startIdx });
+		search.costs[startIdx] = 0.f;
+		search.searchIds[startIdx] = search.searchId;
+
+		int nrOfSettledNodes = 0;
+		while (!search.openList.empty() && nrOfSettledNodes < maxSettledNodes && nrOfTargets > 0)
+		{
+			std::pop_heap(search.openList.begin(), search.openList.end(), compare);
+			const WitnessSearch::QueueEntry current = search.openList.back();
+			search.openList.pop_back();
+
+			if (current.first > search.costs[current.second])
+				continue;
+			// Paths this long don't replace any shortcut
+			if (current.first > maxCost)
+				break;
+			++nrOfSettledNodes;
+			if (search.targetIds[current.second] == search.searchId)
+				--nrOfTargets;
+
+			for (const Edge& edge : m_OutEdges[current.second])
+			{
+				if (edge.nodeIdx == skippedIdx || m_IsContracted[edge.nodeIdx])
+					continue;
+
+				const float cost = current.first + edge.cost;
+				if (cost < search.GetCost(edge.nodeIdx))
+				{
+					search.costs[edge.nodeIdx] = cost;
+					search.searchIds[edge.nodeIdx] = search.searchId;
+					search.openList.push_back({ cost, edge.nodeIdx });
+					std::push_heap(search.openList.begin(), search.openList.end(), compare);
+				}
+			}
+		}
+	}
+
+	int Contractor::ComputePriority(int idx, WitnessSearch& search) const
+	{
+		// Edge difference first, the neighbors contracted already and the level spread the contractions over the graph
+		// and keep the hierarchy shallow (fewer nodes in the search spaces of the queries)
+		std::vector<Shortcut> shortcuts{};
+		FindShortcuts(idx, search, MAX_PRIORITY_WITNESS_SETTLED_NODES, shortcuts);
+		const int edgeDifference = int(shortcuts.size()) - int(m_OutEdges[idx].size()) - int(m_InEdges[idx].size());
+		return 2 * edgeDifference + m_NrOfContractedNeighbors[idx] + m_Levels[idx];
+	}
+
+	bool Contractor::IsBefore(int idx, int otherIdx) const
+	{
+		if (m_Priorities[idx] != m_Priorities[otherIdx])
+			return m_Priorities[idx] < m_Priorities[otherIdx];
+
+		const uint32_t hash = uint32_t(idx) * 2654435761u;
+		const uint32_t otherHash = uint32_t(otherIdx) * 2654435761u;
+		return hash != otherHash ? hash < otherHash : idx < otherIdx;
+	}
+
+	void Contractor::AddEdge(int fromIdx, int toIdx, float cost, int middleIdx)
+	{
+		// One edge per pair of nodes, the cheapest
+		for (Edge& edge : m_OutEdges[fromIdx])
+		{
+			if (edge.nodeIdx != toIdx)
+				continue;
+
+			if (cost < edge.cost)
+			{
+				edge = { toIdx, cost, middleIdx };
+				for (Edge& inEdge : m_InEdges[toIdx])
+				{
+					if (inEdge.nodeIdx == fromIdx)
+						inEdge = { fromIdx, cost, middleIdx };
+				}
+			}
+			return;
+		}
+
+		m_OutEdges[fromIdx].push_back({ toIdx, cost, middleIdx });
+		m_InEdges[toIdx].push_back({ fromIdx, cost, middleIdx });
+	}
+
+	void Contractor::RemoveEdge(std::vector<Edge>& edges, int nodeIdx)
+	{
+		for (size_t i = 0; i < edges.size(); ++i)
+		{
+			if (edges[i].nodeIdx == nodeIdx)
+			{
+				edges[i] = edges.back();
+				edges.pop_back();
+				return;
+			}
+		}
+	}
+
+	// Flattens the arcs per node into [offsets[idx], offsets[idx + 1])
+	void BuildArcs(const std::vector<std::vector<ContractionHierarchy::Arc>>& arcsPerNode, std::vector<int>& offsets, std::vector<ContractionHierarchy::Arc>& arcs)
+	{
+		offsets.assign(arcsPerNode.size() + 1, 0);
+		arcs.clear();
+		for (size_t idx = 0; idx < arcsPerNode.size(); ++idx)
+		{
+			offsets[idx] = int(arcs.size());
+			arcs.insert(arcs.end(), arcsPerNode[idx].begin(), arcsPerNode[idx].end());
+		}
+		offsets[arcsPerNode.size()] = int(arcs.size());
+	}
+}
+
+void ContractionHierarchy::Build(const GraphCSR& graph, ThreadPool* pThreadPool)
+{
+	const int nrOfNodes = graph.GetNrOfNodes();
+	m_Ranks.assign(nrOfNodes, -1);
+	m_NrOfShortcuts = 0;
+
+	std::vector<std::vector<Arc>> upArcs(nrOfNodes);
+	std::vector<std::vector<Arc>> downArcs(nrOfNodes);
+	int rank = 0;
+
+	// The edges left when a node is contracted all lead to nodes contracted later, so they are its up and down arcs
+	Contractor contractor(graph, pThreadPool);
+	contractor.ContractAll([&](int idx, const std::vector<Edge>& outEdges, const std::vector<Edge>& inEdges)
+	{
+		if (graph.IsNodeValid(idx))
+			m_Ranks[idx] = rank++;
+
+		for (const Edge& edge : outEdges)
+		{
+			upArcs[idx].push_back({ edge.nodeIdx, edge.cost, edge.middleIdx });
+			if (edge.middleIdx != invalid_node_index)
+				++m_NrOfShortcuts;
+		}
+		for (const Edge& edge : inEdges)
+		{
+			downArcs[idx].push_back({ edge.nodeIdx, edge.cost, edge.middleIdx });
+			if (edge.middleIdx != invalid_node_index)
+				++m_NrOfShortcuts;
+		}
+	});
+
+	BuildArcs(upArcs, m_UpOffsets, m_UpArcs);
+	BuildArcs(downArcs, m_DownOffsets, m_DownArcs);
+
+	m_Version = graph.GetVersion();
+	m_Fingerprint = graph.GetFingerprint();
+	m_IsBuilt = true;
+}
+
+bool ContractionHierarchy::Save(const std::string& path) const
+{
+	if (!m_IsBuilt)
+		return false;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	ContractionHierarchyFileHeader header{};
+	header.magic = CONTRACTION_HIERARCHY_FILE_MAGIC;
+	header.version = CONTRACTION_HIERARCHY_FILE_VERSION;
+	header.fingerprint = m_Fingerprint;
+	header.nrOfNodes = GetNrOfNodes();
+	header.nrOfUpArcs = int32_t(m_UpArcs.size());
+	header.nrOfDownArcs = int32_t(m_DownArcs.size());
+	header.nrOfShortcuts = m_NrOfShortcuts;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_Ranks.data()), std::streamsize(m_Ranks.size() * sizeof(int32_t)));
+	file.write(reinterpret_cast<const char*>(m_UpOffsets.data()), std::streamsize(m_UpOffsets.size() * sizeof(int32_t)));
+	file.write(reinterpret_cast<const char*>(m_DownOffsets.data()), std::streamsize(m_DownOffsets.size() * sizeof(int32_t)));
+	file.write(reinterpret_cast<const char*>(m_UpArcs.data()), std::streamsize(m_UpArcs.size() * sizeof(Arc)));
+	file.write(reinterpret_cast<const char*>(m_DownArcs.data()), std::streamsize(m_DownArcs.size() * sizeof(Arc)));
+	return bool(file);
+}
+
+bool ContractionHierarchy::Load(const std::string& path, const GraphCSR& graph)
+{
+	MemoryMappedFile file{};
+	if (!file.Open(path) || file.GetSize() < sizeof(ContractionHierarchyFileHeader))
+		return false;
+
+	const ContractionHierarchyFileHeader& header = *reinterpret_cast<const ContractionHierarchyFileHeader*>(file.GetData());
+	if (header.magic != CONTRACTION_HIERARCHY_FILE_MAGIC || header.version != CONTRACTION_HIERARCHY_FILE_VERSION
+		|| header.nrOfNodes != graph.GetNrOfNodes() || header.nrOfUpArcs < 0 || header.nrOfDownArcs < 0 || header.nrOfShortcuts < 0
+		|| header.fingerprint != graph.GetFingerprint())
+		return false;
+
+	const size_t nrOfNodes = size_t(header.nrOfNodes);
+	const size_t nrOfUpArcs = size_t(header.nrOfUpArcs);
+	const size_t nrOfDownArcs = size_t(header.nrOfDownArcs);
+	if (file.GetSize() < sizeof(ContractionHierarchyFileHeader) + (3 * nrOfNodes + 2) * sizeof(int32_t) + (nrOfUpArcs + nrOfDownArcs) * sizeof(Arc))
+		return false;
+
+	const int32_t* pRanks = reinterpret_cast<const int32_t*>(file.GetData() + sizeof(ContractionHierarchyFileHeader));
+	const int32_t* pUpOffsets = pRanks + nrOfNodes;
+	const int32_t* pDownOffsets = pUpOffsets + nrOfNodes + 1;
+	const Arc* pUpArcs = reinterpret_cast<const Arc*>(pDownOffsets + nrOfNodes + 1);
+	const Arc* pDownArcs = pUpArcs + nrOfUpArcs;
+
+	m_Ranks.assign(pRanks, pRanks + nrOfNodes);
+	m_UpOffsets.assign(pUpOffsets, pUpOffsets + nrOfNodes + 1);
+	m_DownOffsets.assign(pDownOffsets, pDownOffsets + nrOfNodes + 1);
+	m_UpArcs.assign(pUpArcs, pUpArcs + nrOfUpArcs);
+	m_DownArcs.assign(pDownArcs, pDownArcs + nrOfDownArcs);
+
+	m_NrOfShortcuts = header.nrOfShortcuts;
+
+	// The header only describes the sizes, a damaged file can still point anywhere
+	if (!IsConsistent())
+	{
+		*this = ContractionHierarchy{};
+		return false;
+	}
+
+	m_Version = graph.GetVersion();
+	m_Fingerprint = header.fingerprint;
+	m_IsBuilt = true;
+	return true;
+}
+
+bool ContractionHierarchy::LoadOrBuild(const std::string& path, const GraphCSR& graph, ThreadPool* pThreadPool)
+{
+	if (Load(path, graph))
+		return true;
+
+	Build(graph, pThreadPool);
+	Save(path);
+	return false;
+}
+
+bool ContractionHierarchy::IsConsistent() const
+{
+	const int nrOfNodes = GetNrOfNodes();
+
+	auto areOffsetsValid = [nrOfNodes](const std::vector<int>& offsets, size_t nrOfArcs)
+	{
+		if (offsets[0] != 0 || size_t(offsets[nrOfNodes]) != nrOfArcs)
+			return false;
+
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			if (offsets[idx] > offsets[idx + 1])
+				return false;
+		}
+		return true;
+	};
+
+	if (!areOffsetsValid(m_UpOffsets, m_UpArcs.size()) || !areOffsetsValid(m_DownOffsets, m_DownArcs.size()))
+		return false;
+
+	for (int rank : m_Ranks)
+	{
+		if (rank < -1 || rank >= nrOfNodes)
+			return false;
+	}
+
+	auto getRank = [this, nrOfNodes](int idx) { return idx >= 0 && idx < nrOfNodes ? m_Ranks[idx] : -1; };
+
+	// Arc between lowIdx and the higher ranked highIdx, over middleIdx for a shortcut
+	auto isArcValid = [&](int lowIdx, int highIdx, const Arc& arc)
+	{
+		if (getRank(lowIdx) < 0 || getRank(highIdx) <= getRank(lowIdx) || !(arc.cost >= 0.f && arc.cost < FLT_MAX))
+			return false;
+
+		return arc.middleIdx == invalid_node_index
+			|| (getRank(arc.middleIdx) >= 0 && getRank(arc.middleIdx) < getRank(lowIdx));
+	};
+
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		for (int arc = m_UpOffsets[idx]; arc < m_UpOffsets[idx + 1]; ++arc)
+		{
+			if (!isArcValid(idx, m_UpArcs[arc].target, m_UpArcs[arc]))
+				return false;
+		}
+
+		for (int arc = m_DownOffsets[idx]; arc < m_DownOffsets[idx + 1]; ++arc)
+		{
+			if (!isArcValid(idx, m_DownArcs[arc].target, m_DownArcs[arc]))
+				return false;
+		}
+	}
+
+	// A shortcut from -> to over middle is unpacked into the down arc from -> middle and the up arc middle -> to
+	auto isShortcutValid = [this](int fromIdx, int toIdx, int middleIdx)
+	{
+		return middleIdx == invalid_node_index
+			|| (FindDownArc(middleIdx, fromIdx) != invalid_arc_index && FindUpArc(middleIdx, toIdx) != invalid_arc_index);
+	};
+
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		for (int arc = m_UpOffsets[idx]; arc < m_UpOffsets[idx + 1]; ++arc)
+		{
+			if (!isShortcutValid(idx, m_UpArcs[arc].target, m_UpArcs[arc].middleIdx))
+				return false;
+		}
+
+		for (int arc = m_DownOffsets[idx]; arc < m_DownOffsets[idx + 1]; ++arc)
+		{
+			if (!isShortcutValid(m_DownArcs[arc].target, idx, m_DownArcs[arc].middleIdx))
+				return false;
+		}
+	}
+
+	return true;
+}
+
+void ContractionHierarchy::UnpackArc(int fromIdx, int toIdx, int middleIdx, std::vector<int>& path) const
+{
+	// A shortcut from -> to over middle is the down arc from -> middle followed by the up arc middle -> to,
+	// both can be shortcuts again. Segments still to unpack, the next one on top
+	struct Segment
+	{
+		int fromIdx;
+		int toIdx;
+		int middleIdx;
+	};
+	std::vector<Segment> segments{ { fromIdx, toIdx, middleIdx } };
+
+	while (!segments.empty())
+	{
+		const Segment segment = segments.back();
+		segments.pop_back();
+
+		if (segment.middleIdx == invalid_node_index)
+		{
+			path.push_back(segment.toIdx);
+			continue;
+		}
+
+		const int firstArc = FindDownArc(segment.middleIdx, segment.fromIdx);
+		const int secondArc = FindUpArc(segment.middleIdx, segment.toIdx);
+		assert(firstArc != invalid_arc_index && secondArc != invalid_arc_index);
+
+		segments.push_back({ segment.middleIdx, segment.toIdx, m_UpArcs[secondArc].middleIdx });
+		segments.push_back({ segment.fromIdx, segment.middleIdx, m_DownArcs[firstArc].middleIdx });
+	}
+}
+
+int ContractionHierarchy::FindUpArc(int fromIdx, int toIdx) const
+{
+	for (int arc = m_UpOffsets[fromIdx]; arc < m_UpOffsets[fromIdx + 1]; ++arc)
+	{
+		if (m_UpArcs[arc].target == toIdx)
+			return arc;
+	}
+	return invalid_arc_index;
+}
+
+int ContractionHierarchy::FindDownArc(int toIdx, int fromIdx) const
+{
+	for (int arc = m_DownOffsets[toIdx]; arc < m_DownOffsets[toIdx + 1]; ++arc)
+	{
+		if (m_DownArcs[arc].target == fromIdx)
+			return arc;
+	}
+	return invalid_arc_index;
+}
+
+float ContractionHierarchyQuery::FindCost(int startIdx, int goalIdx)
+{
+	Search(startIdx, goalIdx);
+	return m_BestCost;
+}
+
+std::vector<int> ContractionHierarchyQuery::FindPath(int startIdx, int goalIdx)
+{
+	std::vector<int> path{};
+	Search(startIdx, goalIdx);
+	if (m_MeetingIdx == invalid_node_index)
+		return path;
+
+	// Up arcs from the start to the meeting node, tracked back from the meeting node
+	std::vector<int> upArcs{};
+	for (int idx = m_MeetingIdx; m_Forward.parents[idx] != invalid_node_index; idx = m_Forward.parents[idx])
+		upArcs.push_back(m_Forward.parentArcs[idx]);
+
+	int idx = startIdx;
+	path.push_back(idx);
+	for (auto it = upArcs.rbegin(); it != upArcs.rend(); ++it)
+	{
+		const ContractionHierarchy::Arc& arc = m_pHierarchy->GetUpArc(*it);
+		m_pHierarchy->UnpackArc(idx, arc.target, arc.middleIdx, path);
+		idx = arc.target;
+	}
+
+	// Down arcs from the meeting node to the goal, in the order the backward search tracks them
+	for (; m_Backward.parents[idx] != invalid_node_index; idx = m_Backward.parents[idx])
+	{
+		const ContractionHierarchy::Arc& arc = m_pHierarchy->GetDownArc(m_Backward.parentArcs[idx]);
+		m_pHierarchy->UnpackArc(idx, m_Backward.parents[idx], arc.middleIdx, path);
+	}
+	return path;
+}
+
+void ContractionHierarchyQuery::Search(int startIdx, int goalIdx)
+{
+	m_MeetingIdx = invalid_node_index;
+	m_BestCost = FLT_MAX;
+	m_NrOfSettledNodes = 0;
+	m_Forward.openList.clear();
+	m_Backward.openList.clear();
+
+	const int nrOfNodes = m_pHierarchy->GetNrOfNodes();
+	if (startIdx < 0 || startIdx >= nrOfNodes || goalIdx < 0 || goalIdx >= nrOfNodes
+		|| m_pHierarchy->GetRank(startIdx) == -1 || m_pHierarchy->GetRank(goalIdx) == -1)
+		return;
+
+	for (Direction* pDirection : { &m_Forward, &m_Backward })
+	{
+		if (pDirection->searchIds.size() < size_t(nrOfNodes))
+		{
+			pDirection->costs.resize(nrOfNodes);
+			pDirection->parents.resize(nrOfNodes);
+			pDirection->parentArcs.resize(nrOfNodes);
+			pDirection->searchIds.resize(nrOfNodes, 0);
+		}
+	}
+
+	if (++m_SearchId == 0)
+	{
+		// the ids wrapped around, stamps of old searches could match again
+		std::fill(m_Forward.searchIds.begin(), m_Forward.searchIds.end(), 0);
+		std::fill(m_Backward.searchIds.begin(), m_Backward.searchIds.end(), 0);
+		m_SearchId = 1;
+	}
+
+	Reach(m_Forward, startIdx, invalid_node_index, invalid_arc_index, 0.f);
+	Reach(m_Backward, goalIdx, invalid_node_index, invalid_arc_index, 0.f);
+	if (startIdx == goalIdx)
+	{
+		m_BestCost = 0.f;
+		m_MeetingIdx = startIdx;
+	}
+
+	// The searches can't stop when they meet: the cheapest path goes through the highest ranked node on it,
+	// which can be found after other nodes both searches reached. A direction stops once it can't improve the best path.
+	while (!m_Forward.openList.empty() || !m_Backward.openList.empty())
+	{
+		if (!m_Forward.openList.empty())
+			Settle(m_Forward, m_Backward, true);
+		if (!m_Backward.openList.empty())
+			Settle(m_Backward, m_Forward, false);
+	}
+}
+
+void ContractionHierarchyQuery::Settle(Direction& direction, const Direction& otherDirection, bool isForward)
+{
+	std::pop_heap(direction.openList.begin(), direction.openList.end());
+	const QueueEntry current = direction.openList.back();
+	direction.openList.pop_back();
+
+	if (current.cost > direction.costs[current.nodeIdx])
+		return;
+	if (current.cost >= m_BestCost)
+	{
+		direction.openList.clear();
+		return;
+	}
+	++m_NrOfSettledNodes;
+
+	// Stall on demand: a higher ranked node reached more cheaply than this one, with an arc down to it, means this
+	// isn't the cost of the shortest path to the node, no path through it can be the best one
+	const int firstStallArc = isForward ? m_pHierarchy->GetFirstDownArc(current.nodeIdx) : m_pHierarchy->GetFirstUpArc(current.nodeIdx);
+	const int lastStallArc = isForward ? m_pHierarchy->GetLastDownArc(current.nodeIdx) : m_pHierarchy->GetLastUpArc(current.nodeIdx);
+	for (int arcIdx = firstStallArc; arcIdx < lastStallArc; ++arcIdx)
+	{
+		const ContractionHierarchy::Arc& arc = isForward ? m_pHierarchy->GetDownArc(arcIdx) : m_pHierarchy->GetUpArc(arcIdx);
+		if (IsReached(direction, arc.target) && direction.costs[arc.target] + arc.cost < current.cost)
+			return;
+	}
+
+	const int firstArc = isForward ? m_pHierarchy->GetFirstUpArc(current.nodeIdx) : m_pHierarchy->GetFirstDownArc(current.nodeIdx);
+	const int lastArc = isForward ? m_pHierarchy->GetLastUpArc(current.nodeIdx) : m_pHierarchy->GetLastDownArc(current.nodeIdx);
+	for (int arcIdx = firstArc; arcIdx < lastArc; ++arcIdx)
+	{
+		const ContractionHierarchy::Arc& arc = isForward ? m_pHierarchy->GetUpArc(arcIdx) : m_pHierarchy->GetDownArc(arcIdx);
+		const float cost = current.cost + arc.cost;
+		if (IsReached(direction, arc.target) && direction.costs[arc.target] <= cost)
+			continue;
+
+		Reach(direction, arc.target, current.nodeIdx, arcIdx, cost);
+		if (IsReached(otherDirection, arc.target) && cost + otherDirection.costs[arc.target] < m_BestCost)
+		{
+			m_BestCost = cost + otherDirection.costs[arc.target];
+			m_MeetingIdx = arc.target;
+		}
+	}
+}
+
+void ContractionHierarchyQuery::Reach(Direction& direction, int idx, int parentIdx, int parentArc, float cost)
+{
+	direction.searchIds[idx] = m_SearchId;
+	direction.costs[idx] = cost;
+	direction.parents[idx] = parentIdx;
+	direction.parentArcs[idx] = parentArc;
+	direction.openList.push_back({ cost, idx });
+	std::push_heap(direction.openList.begin(), direction.openList.end());
+}
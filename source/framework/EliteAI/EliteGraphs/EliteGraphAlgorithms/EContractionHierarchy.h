@@ -0,0 +1,140 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EContractionHierarchy.h: Contraction hierarchy for graphs that don't change, queried many times.
+// Nodes are contracted least important first, mostly by edge difference (shortcuts added minus connections removed).
+// Contracting a node adds a shortcut between two of its neighbors when the path through the node is the only
+// shortest one, which a local Dijkstra search (the witness search) decides. Independent nodes are contracted
+// together, with their witness searches in parallel when there is a thread pool.
+// A query only follows arcs to higher ranked nodes, from the start and (in reverse) from the goal, so both
+// searches stay small, and stalls at nodes a higher ranked node reaches more cheaply.
+// Every shortcut remembers the node it skips, to unpack it into the connections of the graph.
+// The hierarchy can be saved next to the graph file, a file only loads for the graph it was built for.
+/*=============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+#include "framework\EliteHelpers\EThreadPool.h"
+
+namespace Elite
+{
+	const uint32_t CONTRACTION_HIERARCHY_FILE_MAGIC{ 0x59484345 }; // "ECHY"
+	const uint32_t CONTRACTION_HIERARCHY_FILE_VERSION{ 1 };
+
+	class ContractionHierarchy final
+	{
+	public:
+		// Connection of the graph or shortcut, from the node the arc belongs to (up arcs) or to it (down arcs)
+		struct Arc
+		{
+			int32_t target;
+			float cost;
+			// Node the shortcut skips, invalid_node_index for a connection of the graph
+			int32_t middleIdx;
+		};
+
+		ContractionHierarchy() = default;
+
+		// The witness searches run in parallel when there is a thread pool
+		void Build(const GraphCSR& graph, ThreadPool* pThreadPool = nullptr);
+
+		bool Save(const std::string& path) const;
+		// Fails if the file doesn't exist, isn't a contraction hierarchy file, was built for another graph or is damaged
+		bool Load(const std::string& path, const GraphCSR& graph);
+		// Loads the file, or builds the hierarchy and saves it there when the file can't be loaded. Returns whether it was loaded
+		bool LoadOrBuild(const std::string& path, const GraphCSR& graph, ThreadPool* pThreadPool = nullptr);
+
+		// Only valid while the graph is the one it was built for
+		bool IsBuiltFor(const GraphCSR& graph) const { return m_IsBuilt && graph.GetVersion() == m_Version && graph.GetNrOfNodes() == GetNrOfNodes(); }
+
+		int GetNrOfNodes() const { return int(m_Ranks.size()); }
+		// Order of contraction, -1 for removed nodes
+		int GetRank(int idx) const { return m_Ranks[idx]; }
+		int GetNrOfShortcuts() const { return m_NrOfShortcuts; }
+
+		// Arcs from a node to the higher ranked nodes, searched from the start
+		int GetFirstUpArc(int idx) const { return m_UpOffsets[idx]; }
+		int GetLastUpArc(int idx) const { return m_UpOffsets[idx + 1]; }
+		const Arc& GetUpArc(int arc) const { return m_UpArcs[arc]; }
+		// Arcs from the higher ranked nodes to a node, searched from the goal
+		int GetFirstDownArc(int idx) const { return m_DownOffsets[idx]; }
+		int GetLastDownArc(int idx) const { return m_DownOffsets[idx + 1]; }
+		const Arc& GetDownArc(int arc) const { return m_DownArcs[arc]; }
+
+		// Appends the nodes after fromIdx on the path of the arc fromIdx -> toIdx, shortcuts replaced by the nodes they skip
+		void UnpackArc(int fromIdx, int toIdx, int middleIdx, std::vector<int>& path) const;
+
+	private:
+		std::vector<int> m_Ranks;
+		std::vector<int> m_UpOffsets;
+		std::vector<Arc> m_UpArcs;
+		std::vector<int> m_DownOffsets;
+		std::vector<Arc> m_DownArcs;
+		int m_NrOfShortcuts = 0;
+
+		bool m_IsBuilt = false;
+		unsigned int m_Version = 0;
+		// Identifies the graph in the file, versions only count while the graph is alive
+		uint32_t m_Fingerprint = 0;
+
+		int FindUpArc(int fromIdx, int toIdx) const;
+		int FindDownArc(int toIdx, int fromIdx) const;
+		// Checks the arrays read from a file: every index in range, arcs to higher ranked nodes only
+		// and shortcuts over a lower ranked node with both of their arcs present, so unpacking ends
+		bool IsConsistent() const;
+	};
+
+	// Point to point queries on a hierarchy, which it doesn't change: queries on different threads
+	// can share a hierarchy as long as each has its own ContractionHierarchyQuery
+	class ContractionHierarchyQuery final
+	{
+	public:
+		// The hierarchy has to outlive the query
+		explicit ContractionHierarchyQuery(const ContractionHierarchy* pHierarchy) : m_pHierarchy(pHierarchy) {}
+
+		// Cost of the cheapest path, FLT_MAX without a path
+		float FindCost(int startIdx, int goalIdx);
+		// Node indices from start to goal, empty without a path
+		std::vector<int> FindPath(int startIdx, int goalIdx);
+
+		// Nodes taken from both open lists by the last query
+		int GetNrOfSettledNodes() const { return m_NrOfSettledNodes; }
+
+	private:
+		struct QueueEntry
+		{
+			float cost;
+			int nodeIdx;
+
+			// min heap on cost
+			bool operator<(const QueueEntry& other) const { return cost > other.cost; }
+		};
+
+		struct Direction
+		{
+			std::vector<QueueEntry> openList;
+			std::vector<float> costs;
+			// Arc the node was reached by, an up arc of the parent (forward) or a down arc of the parent (backward)
+			std::vector<int> parentArcs;
+			std::vector<int> parents;
+			std::vector<unsigned int> searchIds;
+		};
+
+		const ContractionHierarchy* m_pHierarchy;
+		Direction m_Forward;
+		Direction m_Backward;
+		unsigned int m_SearchId = 0;
+
+		// Node where the best path found so far goes from the forward search into the backward one
+		int m_MeetingIdx = invalid_node_index;
+		float m_BestCost = FLT_MAX;
+		int m_NrOfSettledNodes = 0;
+
+		void Search(int startIdx, int goalIdx);
+		void Settle(Direction& direction, const Direction& otherDirection, bool isForward);
+		void Reach(Direction& direction, int idx, int parentIdx, int parentArc, float cost);
+		bool IsReached(const Direction& direction, int idx) const { return direction.searchIds[idx] == m_SearchId; }
+	};
+}
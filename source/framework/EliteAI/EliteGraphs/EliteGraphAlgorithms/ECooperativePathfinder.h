@@ -0,0 +1,584 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ECooperativePathfinder.h: Windowed Hierarchical Cooperative A* (Silver) for many agents on one graph.
+// Time advances in steps, every step an agent moves to a neighboring node or waits. Each plan is a space-time
+// A* search over the next few steps (the window) that avoids the nodes other agents reserved at those times,
+// and agents don't swap places over a connection. The plan is reserved in turn, so the agents planning after it
+// go around. Plans are made again every few steps (a rolling window), with the agents taking turns to plan first.
+// The heuristic is the exact cost to the goal ignoring the other agents, a Dijkstra search back from each goal.
+// Every agent only reserves its window, so the table never holds more than (window + 1) nodes per agent.
+// The pathfinder listens to the graph: an agent on or heading to a removed node stays where it is, and Compact
+// remaps the agents.
+/*=============================================================================*/
+#pragma once
+
+#include <deque>
+#include <unordered_map>
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+
+namespace Elite
+{
+	// Which agent is at a node at a time step, hash based so finding a reservation is O(1)
+	class SpaceTimeReservationTable final
+	{
+	public:
+		struct Reservation
+		{
+			int agentId;
+			// Node the agent was at the step before, the node itself when waiting
+			int fromIdx;
+		};
+
+		// A node can only be reserved once per time step, the first reservation stays
+		void Reserve(int nodeIdx, unsigned int time, int agentId, int fromIdx);
+		// Removes every reservation of the agent
+		void Release(int agentId);
+		void Clear();
+
+		// nullptr if nobody reserved the node at that time
+		const Reservation* Find(int nodeIdx, unsigned int time) const;
+		bool IsFree(int nodeIdx, unsigned int time, int agentId) const;
+		// Moving from one node to another between time and time + 1 doesn't end on a node another agent reserved,
+		// nor crosses an agent moving the other way
+		bool CanMove(int fromIdx, int toIdx, unsigned int time, int agentId) const;
+
+		int GetNrOfReservations() const { return int(m_Reservations.size()); }
+
+	private:
+		static uint64_t GetKey(int nodeIdx, unsigned int time) { return (uint64_t(time) << 32) | uint32_t(nodeIdx); }
+
+		std::unordered_map<uint64_t, Reservation> m_Reservations;
+		// Keys reserved by every agent, to release them without going over the whole table
+		std::unordered_map<int, std::vector<uint64_t>> m_AgentKeys;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	class CooperativePathfinder final : public IGraphListener
+	{
+	public:
+		struct Waypoint
+		{
+			int nodeIdx;
+			unsigned int time;
+			Vector2 position;
+		};
+
+		// The window is the number of steps every plan looks ahead, agents plan again every replanInterval steps
+		CooperativePathfinder(IGraph<T_NodeType, T_ConnectionType>* pGraph, int windowSize = 16, int replanInterval = 8);
+		~CooperativePathfinder();
+
+		// Agents plan when added and when their goal changes, the agent that is already there reserves first
+		void AddAgent(int agentId, T_NodeType* pStartNode, T_NodeType* pGoalNode);
+		void SetGoal(int agentId, T_NodeType* pGoalNode);
+		void RemoveAgent(int agentId);
+		bool HasAgent(int agentId) const { return m_Agents.find(agentId) != m_Agents.end(); }
+
+		// Every agent moves on to its next waypoint, the agents at the end of their replan interval plan again
+		void Step();
+		// Steps once per step duration of accumulated time
+		void Update(float deltaT);
+		void SetStepDuration(float stepDuration) { m_StepDuration = stepDuration; }
+		float GetStepDuration() const { return m_StepDuration; }
+		// Part of the current step that has passed, to move the agents along smoothly
+		float GetStepProgress() const { return m_StepTime / m_StepDuration; }
+		unsigned int GetTime() const { return m_Time; }
+
+		// Waypoints from the node the agent is at on, one per time step (the same node again while waiting)
+		const std::deque<Waypoint>& GetWaypoints(int agentId) const { return m_Agents.at(agentId).waypoints; }
+		// Where the agent should be at the end of the current step, the target to Seek or Arrive at
+		Vector2 GetTargetPosition(int agentId) const;
+		bool HasReachedGoal(int agentId) const;
+
+		// Cost of waiting a step anywhere but at the goal
+		void SetWaitCost(float waitCost) { m_WaitCost = waitCost; }
+		// Nodes a plan may expand, the deepest part of the window found so far is used when it runs out
+		void SetMaxNrOfExpansions(int maxNrOfExpansions) { m_MaxNrOfExpansions = maxNrOfExpansions; }
+		const SpaceTimeReservationTable& GetReservationTable() const { return m_Reservations; }
+		int GetLastNrOfExpandedNodes() const { return m_LastNrOfExpandedNodes; }
+
+		// IGraphListener
+		virtual void OnNodeModified(int idx) override;
+		virtual void OnGraphCleared() override;
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override;
+
+		//C++ make the class non-copyable
+		CooperativePathfinder(const CooperativePathfinder&) = delete;
+		CooperativePathfinder& operator=(const CooperativePathfinder&) = delete;
+
+	private:
+		struct Agent
+		{
+			int goalIdx;
+			std::deque<Waypoint> waypoints;
+			unsigned int replanTime;
+		};
+
+		// A node at a depth in the window
+		struct SearchRecord
+		{
+			int nodeIdx;
+			int depth;
+			float costSoFar;
+			int parentRecord;
+		};
+
+		struct QueueEntry
+		{
+			float estimatedTotalCost;
+			float costSoFar;
+			int record;
+
+			// the open list is a max heap on this ordering: lowest estimate first, on equal estimates the one closest to the goal
+			bool operator<(const QueueEntry& other) const
+			{
+				if (estimatedTotalCost != other.estimatedTotalCost)
+					return estimatedTotalCost > other.estimatedTotalCost;
+				return costSoFar < other.costSoFar;
+			}
+		};
+
+		void Plan(int agentId, Agent& agent);
+		// Index of the record the plan ends at
+		int SearchWindow(int agentId, int startIdx, int goalIdx, const std::vector<float>& costsToGoal);
+		bool IsGoalFree(int goalIdx, unsigned int time, int agentId) const;
+		const std::vector<float>& GetCostsToGoal(int goalIdx);
+		void ReleaseCostsToGoal(int goalIdx);
+		void UpdateCSR();
+		// Changes the goals and waypoints of every agent, they plan again the next step
+		template<typename T_Func>
+		void RemapAgents(T_Func remap);
+		Waypoint MakeWaypoint(int nodeIdx, unsigned int time) const { return Waypoint{ nodeIdx, time, m_pGraph->GetNodeWorldPos(nodeIdx) }; }
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		int m_WindowSize;
+		int m_ReplanInterval;
+		float m_WaitCost = 1.f;
+		int m_MaxNrOfExpansions = 4096;
+
+		// Snapshot, rebuilt when the graph changed, the transposed one for the costs to the goals of a directed graph
+		GraphCSR m_CSR;
+		GraphCSR m_ReverseCSR;
+		bool m_IsCSRBuilt = false;
+
+		SpaceTimeReservationTable m_Reservations;
+		std::unordered_map<int, Agent> m_Agents;
+		// Order the agents take turns in
+		std::vector<int> m_AgentIds;
+		// Per goal node, dropped when no agent heads there anymore
+		std::unordered_map<int, std::vector<float>> m_CostsToGoals;
+
+		unsigned int m_Time = 0;
+		float m_StepDuration = 0.25f;
+		float m_StepTime = 0.f;
+
+		// Search state, reused between plans
+		std::vector<SearchRecord> m_Records;
+		std::vector<QueueEntry> m_OpenList;
+		// Record of every node and depth reached, keyed like the reservations
+		std::unordered_map<uint64_t, int> m_RecordIds;
+		int m_LastNrOfExpandedNodes = 0;
+	};
+
+	inline void SpaceTimeReservationTable::Reserve(int nodeIdx, unsigned int time, int agentId, int fromIdx)
+	{
+		const uint64_t key = GetKey(nodeIdx, time);
+		if (m_Reservations.emplace(key, Reservation{ agentId, fromIdx }).second)
+			m_AgentKeys[agentId].push_back(key);
+	}
+
+	inline void SpaceTimeReservationTable::Release(int agentId)
+	{
+		auto agentIt = m_AgentKeys.find(agentId);
+		if (agentIt == m_AgentKeys.end())
+			return;
+
+		for (uint64_t key : agentIt->second)
+			m_Reservations.erase(key);
+		m_AgentKeys.erase(agentIt);
+	}
+
+	inline void SpaceTimeReservationTable::Clear()
+	{
+		m_Reservations.clear();
+		m_AgentKeys.clear();
+	}
+
+	inline const SpaceTimeReservationTable::Reservation* SpaceTimeReservationTable::Find(int nodeIdx, unsigned int time) const
+	{
+		auto foundIt = m_Reservations.find(GetKey(nodeIdx, time));
+		return foundIt == m_Reservations.end() ? nullptr : &foundIt->second;
+	}
+
+	inline bool SpaceTimeReservationTable::IsFree(int nodeIdx, unsigned int time, int agentId) const
+	{
+		const Reservation* pReservation = Find(nodeIdx, time);
+		return !pReservation || pReservation->agentId == agentId;
+	}
+
+	inline bool SpaceTimeReservationTable::CanMove(int fromIdx, int toIdx, unsigned int time, int agentId) const
+	{
+		if (!IsFree(toIdx, time + 1, agentId))
+			return false;
+		if (fromIdx == toIdx)
+			return true;
+
+		// The agent arriving where we leave from comes from where we go to
+		const Reservation* pReservation = Find(fromIdx, time + 1);
+		return !pReservation || pReservation->agentId == agentId || pReservation->fromIdx != toIdx;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline CooperativePathfinder<T_NodeType, T_ConnectionType>::CooperativePathfinder(IGraph<T_NodeType, T_ConnectionType>* pGraph, int windowSize, int replanInterval)
+		: m_pGraph(pGraph)
+		, m_WindowSize(windowSize)
+		, m_ReplanInterval(replanInterval)
+	{
+		assert(m_ReplanInterval > 0 && m_ReplanInterval <= m_WindowSize);
+		m_pGraph->AddListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline CooperativePathfinder<T_NodeType, T_ConnectionType>::~CooperativePathfinder()
+	{
+		m_pGraph->RemoveListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::AddAgent(int agentId, T_NodeType* pStartNode, T_NodeType* pGoalNode)
+	{
+		assert(!HasAgent(agentId) && pStartNode && pGoalNode);
+		UpdateCSR();
+
+		Agent& agent = m_Agents[agentId];
+		agent.goalIdx = pGoalNode->GetIndex();
+		agent.waypoints.assign(1, MakeWaypoint(pStartNode->GetIndex(), m_Time));
+		m_AgentIds.push_back(agentId);
+
+		Plan(agentId, agent);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::SetGoal(int agentId, T_NodeType* pGoalNode)
+	{
+		Agent& agent = m_Agents.at(agentId);
+		if (agent.goalIdx == pGoalNode->GetIndex())
+			return;
+
+		const int oldGoalIdx = agent.goalIdx;
+		agent.goalIdx = pGoalNode->GetIndex();
+		ReleaseCostsToGoal(oldGoalIdx);
+
+		UpdateCSR();
+		Plan(agentId, agent);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::RemoveAgent(int agentId)
+	{
+		auto agentIt = m_Agents.find(agentId);
+		if (agentIt == m_Agents.end())
+			return;
+
+		const int goalIdx = agentIt->second.goalIdx;
+		m_Reservations.Release(agentId);
+		m_Agents.erase(agentIt);
+		m_AgentIds.erase(std::find(m_AgentIds.begin(), m_AgentIds.end(), agentId));
+		ReleaseCostsToGoal(goalIdx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::Step()
+	{
+		++m_Time;
+
+		for (auto& agentPair : m_Agents)
+		{
+			std::deque<Waypoint>& waypoints = agentPair.second.waypoints;
+			while (waypoints.size() > 1 && waypoints[1].time <= m_Time)
+				waypoints.pop_front();
+			// Without a plan the agent stays where it is
+			waypoints.front().time = m_Time;
+		}
+
+		// Plans of an older graph can go over connections that aren't there anymore
+		const bool isGraphModified = !m_IsCSRBuilt || m_CSR.GetVersion() != m_pGraph->GetVersion();
+		UpdateCSR();
+
+		// Take turns planning first, the agents that plan early get the free nodes
+		const size_t nrOfAgents = m_AgentIds.size();
+		for (size_t i = 0; i < nrOfAgents; ++i)
+		{
+			const int agentId = m_AgentIds[(m_Time + i) % nrOfAgents];
+			Agent& agent = m_Agents.at(agentId);
+
+			const bool isPlanUsedUp = agent.waypoints.size() == 1 && agent.waypoints.front().nodeIdx != agent.goalIdx;
+			if (isGraphModified || isPlanUsedUp || agent.replanTime <= m_Time)
+				Plan(agentId, agent);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::Update(float deltaT)
+	{
+		m_StepTime += deltaT;
+		while (m_StepTime >= m_StepDuration)
+		{
+			m_StepTime -= m_StepDuration;
+			Step();
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline Vector2 CooperativePathfinder<T_NodeType, T_ConnectionType>::GetTargetPosition(int agentId) const
+	{
+		const std::deque<Waypoint>& waypoints = GetWaypoints(agentId);
+		return waypoints.size() > 1 ? waypoints[1].position : waypoints.front().position;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool CooperativePathfinder<T_NodeType, T_ConnectionType>::HasReachedGoal(int agentId) const
+	{
+		const Agent& agent = m_Agents.at(agentId);
+		return agent.goalIdx != invalid_node_index && agent.waypoints.front().nodeIdx == agent.goalIdx;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::Plan(int agentId, Agent& agent)
+	{
+		m_Reservations.Release(agentId);
+		agent.replanTime = m_Time + m_ReplanInterval;
+
+		// Keeps the position, the node can be gone
+		const Waypoint start{ agent.waypoints.front().nodeIdx, m_Time, agent.waypoints.front().position };
+		const int startIdx = start.nodeIdx;
+		agent.waypoints.assign(1, start);
+
+		// A removed node or one that can't reach the goal, the agent stays out of the way of the others where it is
+		const std::vector<float>& costsToGoal = GetCostsToGoal(agent.goalIdx);
+		if (!m_CSR.IsNodeValid(startIdx) || costsToGoal[startIdx] == FLT_MAX)
+		{
+			for (int depth = 0; depth <= m_WindowSize && m_CSR.IsNodeValid(startIdx); ++depth)
+				m_Reservations.Reserve(startIdx, m_Time + depth, agentId, startIdx);
+			m_LastNrOfExpandedNodes = 0;
+			return;
+		}
+
+		// Track back from the end of the plan
+		std::vector<int> records{};
+		for (int record = SearchWindow(agentId, startIdx, agent.goalIdx, costsToGoal); record != -1; record = m_Records[record].parentRecord)
+			records.push_back(record);
+
+		int fromIdx = startIdx;
+		for (auto it = records.rbegin(); it != records.rend(); ++it)
+		{
+			const SearchRecord& record = m_Records[*it];
+			if (record.depth > 0)
+				agent.waypoints.push_back(MakeWaypoint(record.nodeIdx, m_Time + record.depth));
+			m_Reservations.Reserve(record.nodeIdx, m_Time + record.depth, agentId, fromIdx);
+			fromIdx = record.nodeIdx;
+		}
+
+		// Arrived before the end of the window: stay at the goal for the rest of it
+		const Waypoint& lastWaypoint = agent.waypoints.back();
+		if (lastWaypoint.nodeIdx == agent.goalIdx)
+		{
+			for (unsigned int time = lastWaypoint.time + 1; time <= m_Time + m_WindowSize; ++time)
+				m_Reservations.Reserve(agent.goalIdx, time, agentId, agent.goalIdx);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline int CooperativePathfinder<T_NodeType, T_ConnectionType>::SearchWindow(int agentId, int startIdx, int goalIdx, const std::vector<float>& costsToGoal)
+	{
+		auto getKey = [](int nodeIdx, int depth) { return (uint64_t(depth) << 32) | uint32_t(nodeIdx); };
+
+		m_Records.clear();
+		m_OpenList.clear();
+		m_RecordIds.clear();
+		m_LastNrOfExpandedNodes = 0;
+
+		m_Records.push_back({ startIdx, 0, 0.f, -1 });
+		m_RecordIds[getKey(startIdx, 0)] = 0;
+		m_OpenList.push_back({ costsToGoal[startIdx], 0.f, 0 });
+
+		// Deepest record seen, lowest estimate first, the plan when the search runs out of nodes or expansions
+		int bestRecord = 0;
+		float bestEstimate = costsToGoal[startIdx];
+
+		while (!m_OpenList.empty() && m_LastNrOfExpandedNodes < m_MaxNrOfExpansions)
+		{
+			std::pop_heap(m_OpenList.begin(), m_OpenList.end());
+			const QueueEntry current = m_OpenList.back();
+			m_OpenList.pop_back();
+
+			// Copy, adding records below moves them
+			const SearchRecord record = m_Records[current.record];
+			// A cheaper route to this node and depth was found after this entry was added
+			if (current.costSoFar > record.costSoFar)
+				continue;
+
+			// The rest of the path is left to the next plans, or there is nothing left to plan
+			const unsigned int time = m_Time + record.depth;
+			if (record.depth == m_WindowSize || (record.nodeIdx == goalIdx && IsGoalFree(goalIdx, time, agentId)))
+				return current.record;
+
+			++m_LastNrOfExpandedNodes;
+			if (record.depth > m_Records[bestRecord].depth || (record.depth == m_Records[bestRecord].depth && current.estimatedTotalCost < bestEstimate))
+			{
+				bestRecord = current.record;
+				bestEstimate = current.estimatedTotalCost;
+			}
+
+			// The arcs of the node, and waiting (free at the goal, so agents stay there)
+			const int firstArc = m_CSR.GetFirstArc(record.nodeIdx);
+			const int lastArc = m_CSR.GetLastArc(record.nodeIdx);
+			for (int arc = firstArc; arc <= lastArc; ++arc)
+			{
+				const bool isWaiting = arc == lastArc;
+				const int neighborIdx = isWaiting ? record.nodeIdx : m_CSR.GetArcTarget(arc);
+				const float stepCost = isWaiting ? (record.nodeIdx == goalIdx ? 0.f : m_WaitCost) : m_CSR.GetArcCost(arc);
+
+				if (costsToGoal[neighborIdx] == FLT_MAX || !m_Reservations.CanMove(record.nodeIdx, neighborIdx, time, agentId))
+					continue;
+
+				const float costSoFar = record.costSoFar + stepCost;
+				const uint64_t key = getKey(neighborIdx, record.depth + 1);
+				auto foundIt = m_RecordIds.find(key);
+				if (foundIt != m_RecordIds.end())
+				{
+					SearchRecord& neighborRecord = m_Records[foundIt->second];
+					if (neighborRecord.costSoFar <= costSoFar)
+						continue;
+
+					neighborRecord.costSoFar = costSoFar;
+					neighborRecord.parentRecord = current.record;
+					m_OpenList.push_back({ costSoFar + costsToGoal[neighborIdx], costSoFar, foundIt->second });
+				}
+				else
+				{
+					m_RecordIds.emplace(key, int(m_Records.size()));
+					m_OpenList.push_back({ costSoFar + costsToGoal[neighborIdx], costSoFar, int(m_Records.size()) });
+					m_Records.push_back({ neighborIdx, record.depth + 1, costSoFar, current.record });
+				}
+				std::push_heap(m_OpenList.begin(), m_OpenList.end());
+			}
+		}
+
+		return bestRecord;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool CooperativePathfinder<T_NodeType, T_ConnectionType>::IsGoalFree(int goalIdx, unsigned int time, int agentId) const
+	{
+		for (unsigned int t = time + 1; t <= m_Time + m_WindowSize; ++t)
+		{
+			if (!m_Reservations.IsFree(goalIdx, t, agentId))
+				return false;
+		}
+		return true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline const std::vector<float>& CooperativePathfinder<T_NodeType, T_ConnectionType>::GetCostsToGoal(int goalIdx)
+	{
+		auto foundIt = m_CostsToGoals.find(goalIdx);
+		if (foundIt != m_CostsToGoals.end())
+			return foundIt->second;
+
+		std::vector<float>& costs = m_CostsToGoals[goalIdx];
+		costs.assign(m_CSR.GetNrOfNodes(), FLT_MAX);
+		if (!m_CSR.IsNodeValid(goalIdx))
+			return costs;
+
+		// Dijkstra over the arcs arriving at every node, the arcs leaving it in an undirected graph
+		const GraphCSR& incoming = m_CSR.IsDirectionalGraph() ? m_ReverseCSR : m_CSR;
+		typedef std::pair<float, int> Entry;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> openList;
+		costs[goalIdx] = 0.f;
+		openList.push({ 0.f, goalIdx });
+		while (!openList.empty())
+		{
+			const Entry current = openList.top();
+			openList.pop();
+			if (current.first > costs[current.second])
+				continue;
+
+			for (int arc = incoming.GetFirstArc(current.second); arc < incoming.GetLastArc(current.second); ++arc)
+			{
+				const int neighborIdx = incoming.GetArcTarget(arc);
+				const float cost = current.first + incoming.GetArcCost(arc);
+				if (cost < costs[neighborIdx])
+				{
+					costs[neighborIdx] = cost;
+					openList.push({ cost, neighborIdx });
+				}
+			}
+		}
+		return costs;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::ReleaseCostsToGoal(int goalIdx)
+	{
+		for (const auto& agentPair : m_Agents)
+		{
+			if (agentPair.second.goalIdx == goalIdx)
+				return;
+		}
+		m_CostsToGoals.erase(goalIdx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::UpdateCSR()
+	{
+		if (m_IsCSRBuilt && m_CSR.GetVersion() == m_pGraph->GetVersion())
+			return;
+
+		m_CSR.Build(*m_pGraph);
+		if (m_CSR.IsDirectionalGraph())
+			m_ReverseCSR.BuildTransposed(m_CSR);
+		m_IsCSRBuilt = true;
+		m_CostsToGoals.clear();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::OnNodeModified(int idx)
+	{
+		// Only removed nodes matter, a node added in the same slot later is another node
+		if (m_pGraph->IsNodeValid(idx))
+			return;
+
+		RemapAgents([idx](int nodeIdx) { return nodeIdx == idx ? invalid_node_index : nodeIdx; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::OnGraphCleared()
+	{
+		RemapAgents([](int) { return invalid_node_index; });
+		m_Reservations.Clear();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::OnNodesRemapped(const std::vector<int>& newIndices)
+	{
+		RemapAgents([&newIndices](int nodeIdx) { return GetRemappedNodeIndex(newIndices, nodeIdx); });
+		// Every agent plans again the next step and reserves its new indices
+		m_Reservations.Clear();
+		m_CostsToGoals.clear();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	template <typename T_Func>
+	inline void CooperativePathfinder<T_NodeType, T_ConnectionType>::RemapAgents(T_Func remap)
+	{
+		// The graph version changes as well, so Step plans again for every agent
+		for (auto& agentPair : m_Agents)
+		{
+			Agent& agent = agentPair.second;
+			agent.goalIdx = remap(agent.goalIdx);
+			for (Waypoint& waypoint : agent.waypoints)
+				waypoint.nodeIdx = remap(waypoint.nodeIdx);
+		}
+	}
+}
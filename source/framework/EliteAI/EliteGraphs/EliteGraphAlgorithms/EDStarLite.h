@@ -0,0 +1,403 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EDStarLite.h: Incremental search (D* Lite, Koenig & Likhachev), repairs its previous search instead of starting over.
+// The search runs from the goal to the start, so the start can move (an agent walking its path) without invalidating it.
+// It listens to the graph: connections that are added, removed or change cost are repaired on the next FindPath,
+// only the nodes whose cost to the goal changed because of them are expanded again.
+// With a start that never moves this is LPA*, searching from the goal instead of the start.
+/*=============================================================================*/
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EIGraph.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EHeuristicFunctions.h"
+
+namespace Elite
+{
+	// The graph has to outlive the search
+	template <class T_NodeType, class T_ConnectionType>
+	class DStarLite final : public IGraphListener
+	{
+	public:
+		DStarLite(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction = HeuristicFunctions::Euclidean);
+		virtual ~DStarLite();
+
+		// Starts over for a new start and goal
+		void Initialize(T_NodeType* pStartNode, T_NodeType* pGoalNode);
+		// The agent moved, the search stays valid
+		void MoveStart(T_NodeType* pStartNode);
+		// Repairs the search for the changes to the graph since the last call, then follows it from start to goal
+		// Empty if there is no path
+		std::vector<T_NodeType*> FindPath();
+
+		// Nodes expanded by the last FindPath, to compare with a search from scratch
+		int GetLastNrOfExpandedNodes() const { return m_LastNrOfExpandedNodes; }
+
+		// IGraphListener
+		virtual void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) override {}
+		virtual void OnNodeModified(int idx) override { m_ModifiedNodes.push_back(idx); }
+		virtual void OnConnectionModified(int from, int to) override { m_ModifiedConnections.push_back(std::make_pair(from, to)); }
+		virtual void OnGraphCleared() override { m_IsResetNeeded = true; }
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override;
+
+		//C++ make the class non-copyable
+		DStarLite(const DStarLite&) = delete;
+		DStarLite& operator=(const DStarLite&) = delete;
+
+	private:
+		// Lexicographic priority: (min(g, rhs) + h + km, min(g, rhs))
+		struct Key
+		{
+			float first;
+			float second;
+
+			bool operator<(const Key& other) const { return first < other.first || (first == other.first && second < other.second); }
+			bool operator==(const Key& other) const { return first == other.first && second == other.second; }
+		};
+
+		struct QueueEntry
+		{
+			Key key;
+			int nodeIdx;
+
+			// max heap on this ordering: lowest key first
+			bool operator<(const QueueEntry& other) const { return other.key < key; }
+		};
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+
+		int m_StartIdx = invalid_node_index;
+		int m_LastStartIdx = invalid_node_index;
+		int m_GoalIdx = invalid_node_index;
+		float m_KeyModifier = 0.f;
+
+		// g: cost to the goal as expanded, rhs: one step lookahead, a node is consistent when they are equal
+		std::vector<float> m_G;
+		std::vector<float> m_Rhs;
+		std::vector<Key> m_Keys;
+		std::vector<bool> m_IsInQueue;
+		std::vector<std::vector<int>> m_Predecessors;
+		// Positions the queued keys were calculated with
+		std::vector<Vector2> m_Positions;
+
+		// Open list with lazy removal: an entry only counts while its node is in the queue with the same key
+		std::vector<QueueEntry> m_Queue;
+
+		// Changes to the graph since the last FindPath
+		std::vector<int> m_ModifiedNodes;
+		std::vector<std::pair<int, int>> m_ModifiedConnections;
+		bool m_IsResetNeeded = false;
+
+		int m_LastNrOfExpandedNodes = 0;
+
+		void Reset();
+		void ResizeNodes(int nrOfNodes);
+		void ApplyGraphModifications();
+		void UpdatePredecessors(int from, int to);
+
+		float GetHeuristicCost(int fromIdx, int toIdx) const;
+		Key CalculateKey(int idx) const;
+		void UpdateVertex(int idx);
+		void ComputeShortestPath();
+
+		void Push(int idx, const Key& key);
+		void Remove(int idx) { m_IsInQueue[idx] = false; }
+		bool PopStaleEntries();
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline DStarLite<T_NodeType, T_ConnectionType>::DStarLite(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+	{
+		m_pGraph->AddListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline DStarLite<T_NodeType, T_ConnectionType>::~DStarLite()
+	{
+		m_pGraph->RemoveListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::Initialize(T_NodeType* pStartNode, T_NodeType* pGoalNode)
+	{
+		m_StartIdx = pStartNode ? pStartNode->GetIndex() : invalid_node_index;
+		m_LastStartIdx = m_StartIdx;
+		m_GoalIdx = pGoalNode ? pGoalNode->GetIndex() : invalid_node_index;
+		Reset();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::MoveStart(T_NodeType* pStartNode)
+	{
+		m_StartIdx = pStartNode ? pStartNode->GetIndex() : invalid_node_index;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::vector<T_NodeType*> DStarLite<T_NodeType, T_ConnectionType>::FindPath()
+	{
+		std::vector<T_NodeType*> path{};
+		m_LastNrOfExpandedNodes = 0;
+
+		if (!m_pGraph->IsNodeValid(m_StartIdx) || !m_pGraph->IsNodeValid(m_GoalIdx))
+			return path;
+
+		// Moving the start lowers all heuristics by at most the distance moved, raising the keys of new entries makes up for it
+		if (m_StartIdx != m_LastStartIdx)
+		{
+			if (m_pGraph->IsNodeValid(m_LastStartIdx))
+				m_KeyModifier += GetHeuristicCost(m_LastStartIdx, m_StartIdx);
+			m_LastStartIdx = m_StartIdx;
+		}
+
+		if (m_IsResetNeeded)
+			Reset();
+		else
+			ApplyGraphModifications();
+
+		ComputeShortestPath();
+
+		if (m_G[m_StartIdx] == FLT_MAX)
+			return path;
+
+		// Walk down the costs to the goal
+		path.push_back(m_pGraph->GetNode(m_StartIdx));
+		int currentIdx = m_StartIdx;
+		while (currentIdx != m_GoalIdx && int(path.size()) <= m_pGraph->GetNrOfNodes())
+		{
+			int nextIdx = invalid_node_index;
+			float lowestCost = FLT_MAX;
+			for (auto pConnection : m_pGraph->GetNodeConnections(currentIdx))
+			{
+				const int neighborIdx = pConnection->GetTo();
+				if (!m_pGraph->IsNodeValid(neighborIdx) || m_G[neighborIdx] == FLT_MAX)
+					continue;
+
+				const float cost = pConnection->GetCost() + m_G[neighborIdx];
+				if (cost < lowestCost)
+				{
+					lowestCost = cost;
+					nextIdx = neighborIdx;
+				}
+			}
+
+			if (nextIdx == invalid_node_index)
+				return {};
+
+			path.push_back(m_pGraph->GetNode(nextIdx));
+			currentIdx = nextIdx;
+		}
+
+		if (currentIdx != m_GoalIdx)
+			return {};
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::OnNodesRemapped(const std::vector<int>& newIndices)
+	{
+		// Start and goal keep their nodes, the search starts over on the new indices
+		m_StartIdx = GetRemappedNodeIndex(newIndices, m_StartIdx);
+		m_LastStartIdx = GetRemappedNodeIndex(newIndices, m_LastStartIdx);
+		m_GoalIdx = GetRemappedNodeIndex(newIndices, m_GoalIdx);
+		m_IsResetNeeded = true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::Reset()
+	{
+		m_ModifiedNodes.clear();
+		m_ModifiedConnections.clear();
+		m_IsResetNeeded = false;
+		m_KeyModifier = 0.f;
+		m_Queue.clear();
+
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		m_G.assign(nrOfNodes, FLT_MAX);
+		m_Rhs.assign(nrOfNodes, FLT_MAX);
+		m_Keys.assign(nrOfNodes, Key{ FLT_MAX, FLT_MAX });
+		m_IsInQueue.assign(nrOfNodes, false);
+		m_Positions.resize(nrOfNodes);
+
+		m_Predecessors.assign(nrOfNodes, std::vector<int>());
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			if (!m_pGraph->IsNodeValid(idx))
+				continue;
+
+			m_Positions[idx] = m_pGraph->GetNodePos(idx);
+			for (auto pConnection : m_pGraph->GetNodeConnections(idx))
+				m_Predecessors[pConnection->GetTo()].push_back(idx);
+		}
+
+		if (!m_pGraph->IsNodeValid(m_GoalIdx))
+			return;
+
+		m_Rhs[m_GoalIdx] = 0.f;
+		Push(m_GoalIdx, CalculateKey(m_GoalIdx));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::ResizeNodes(int nrOfNodes)
+	{
+		if (nrOfNodes <= int(m_G.size()))
+			return;
+
+		m_G.resize(nrOfNodes, FLT_MAX);
+		m_Rhs.resize(nrOfNodes, FLT_MAX);
+		m_Keys.resize(nrOfNodes, Key{ FLT_MAX, FLT_MAX });
+		m_IsInQueue.resize(nrOfNodes, false);
+		m_Predecessors.resize(nrOfNodes);
+		m_Positions.resize(nrOfNodes);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::ApplyGraphModifications()
+	{
+		const int nrOfOldNodes = int(m_G.size());
+		ResizeNodes(m_pGraph->GetNrOfNodes());
+
+		// A node that moved changes the heuristics the queued keys are based on
+		for (int idx : m_ModifiedNodes)
+		{
+			if (idx < nrOfOldNodes && m_pGraph->IsNodeValid(idx) && m_pGraph->GetNodePos(idx) != m_Positions[idx])
+			{
+				Reset();
+				return;
+			}
+
+			if (m_pGraph->IsNodeValid(idx))
+				m_Positions[idx] = m_pGraph->GetNodePos(idx);
+		}
+
+		// The cost to the goal of the start of a changed connection depends on it
+		for (const auto& connection : m_ModifiedConnections)
+		{
+			UpdatePredecessors(connection.first, connection.second);
+			UpdateVertex(connection.first);
+		}
+
+		m_ModifiedNodes.clear();
+		m_ModifiedConnections.clear();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::UpdatePredecessors(int from, int to)
+	{
+		std::vector<int>& predecessors = m_Predecessors[to];
+		auto foundIt = std::find(predecessors.begin(), predecessors.end(), from);
+		const bool isConnected = m_pGraph->IsNodeValid(from) && m_pGraph->IsNodeValid(to) && m_pGraph->GetConnection(from, to) != nullptr;
+
+		if (isConnected && foundIt == predecessors.end())
+			predecessors.push_back(from);
+		else if (!isConnected && foundIt != predecessors.end())
+			predecessors.erase(foundIt);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline float DStarLite<T_NodeType, T_ConnectionType>::GetHeuristicCost(int fromIdx, int toIdx) const
+	{
+		const Vector2 toNode = m_pGraph->GetNodePos(toIdx) - m_pGraph->GetNodePos(fromIdx);
+		return m_HeuristicFunction(fabsf(toNode.x), fabsf(toNode.y));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline typename DStarLite<T_NodeType, T_ConnectionType>::Key DStarLite<T_NodeType, T_ConnectionType>::CalculateKey(int idx) const
+	{
+		const float cost = std::min(m_G[idx], m_Rhs[idx]);
+		if (cost == FLT_MAX)
+			return Key{ FLT_MAX, FLT_MAX };
+
+		return Key{ cost + GetHeuristicCost(m_StartIdx, idx) + m_KeyModifier, cost };
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::UpdateVertex(int idx)
+	{
+		if (idx != m_GoalIdx)
+		{
+			// Cheapest way to the goal through one of the neighbors
+			float rhs = FLT_MAX;
+			if (m_pGraph->IsNodeValid(idx))
+			{
+				for (auto pConnection : m_pGraph->GetNodeConnections(idx))
+				{
+					const int neighborIdx = pConnection->GetTo();
+					if (m_pGraph->IsNodeValid(neighborIdx) && m_G[neighborIdx] != FLT_MAX)
+						rhs = std::min(rhs, pConnection->GetCost() + m_G[neighborIdx]);
+				}
+			}
+			m_Rhs[idx] = rhs;
+		}
+
+		if (m_G[idx] != m_Rhs[idx])
+			Push(idx, CalculateKey(idx));
+		else
+			Remove(idx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::ComputeShortestPath()
+	{
+		while (PopStaleEntries() && (m_Queue.front().key < CalculateKey(m_StartIdx) || m_Rhs[m_StartIdx] != m_G[m_StartIdx]))
+		{
+			const int currentIdx = m_Queue.front().nodeIdx;
+			const Key oldKey = m_Queue.front().key;
+			const Key newKey = CalculateKey(currentIdx);
+			++m_LastNrOfExpandedNodes;
+
+			if (oldKey < newKey)
+			{
+				// queued before the start moved
+				Push(currentIdx, newKey);
+			}
+			else if (m_G[currentIdx] > m_Rhs[currentIdx])
+			{
+				// overconsistent: the cost to the goal went down, pass it on to the predecessors
+				m_G[currentIdx] = m_Rhs[currentIdx];
+				Remove(currentIdx);
+				for (int predecessorIdx : m_Predecessors[currentIdx])
+					UpdateVertex(predecessorIdx);
+			}
+			else
+			{
+				// underconsistent: the cost to the goal went up, everything that went through this node has to be checked
+				m_G[currentIdx] = FLT_MAX;
+				UpdateVertex(currentIdx);
+				for (int predecessorIdx : m_Predecessors[currentIdx])
+					UpdateVertex(predecessorIdx);
+			}
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DStarLite<T_NodeType, T_ConnectionType>::Push(int idx, const Key& key)
+	{
+		m_Keys[idx] = key;
+		m_IsInQueue[idx] = true;
+		m_Queue.push_back({ key, idx });
+		std::push_heap(m_Queue.begin(), m_Queue.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool DStarLite<T_NodeType, T_ConnectionType>::PopStaleEntries()
+	{
+		// Drops entries of nodes that were removed or pushed again with another key, returns false when the queue is empty
+		while (!m_Queue.empty())
+		{
+			const QueueEntry& top = m_Queue.front();
+			if (m_IsInQueue[top.nodeIdx] && m_Keys[top.nodeIdx] == top.key)
+				return true;
+
+			std::pop_heap(m_Queue.begin(), m_Queue.end());
+			m_Queue.pop_back();
+		}
+		return false;
+	}
+
+	// Incremental search between a fixed start and goal
+	template <class T_NodeType, class T_ConnectionType>
+	using LPAStar = DStarLite<T_NodeType, T_ConnectionType>;
+}
@@ -0,0 +1,249 @@
+#include "stdafx.h"
+#include "EDistanceTable.h"
+
+using namespace Elite;
+
+namespace
+{
+	// Dijkstra state of one thread, a node only counts as reached in the search that stamped it with its id
+	struct SearchState
+	{
+		typedef std::pair<float, int> QueueEntry;
+		std::vector<QueueEntry> openList;
+		std::vector<float> costs;
+		std::vector<unsigned int> searchIds;
+		unsigned int searchId = 0;
+
+		explicit SearchState(int nrOfNodes) : costs(nrOfNodes), searchIds(nrOfNodes, 0) {}
+
+		void Begin(int startIdx)
+		{
+			++searchId;
+			openList.clear();
+			Reach(startIdx, 0.f);
+		}
+
+		bool IsReached(int idx) const { return searchIds[idx] == searchId; }
+		float GetCost(int idx) const { return IsReached(idx) ? costs[idx] : FLT_MAX; }
+
+		void Reach(int idx, float cost)
+		{
+			searchIds[idx] = searchId;
+			costs[idx] = cost;
+			openList.push_back({ cost, idx });
+			std::push_heap(openList.begin(), openList.end(), std::greater<QueueEntry>{});
+		}
+
+		QueueEntry Pop()
+		{
+			std::pop_heap(openList.begin(), openList.end(), std::greater<QueueEntry>{});
+			const QueueEntry current = openList.back();
+			openList.pop_back();
+			return current;
+		}
+	};
+
+	// Calls func(begin, end, state) over [0, count), a search state per range
+	template<class T_Func>
+	void ForEachRange(int count, int nrOfNodes, ThreadPool* pThreadPool, T_Func func)
+	{
+		auto forRange = [nrOfNodes, &func](int begin, int end)
+		{
+			SearchState state(nrOfNodes);
+			func(begin, end, state);
+		};
+
+		if (pThreadPool)
+			pThreadPool->ParallelFor(count, 1, forRange);
+		else if (count > 0)
+			forRange(0, count);
+	}
+
+	// Upward search of a hierarchy, fills settled with the nodes it didn't stall at and their costs
+	void SearchUpward(const ContractionHierarchy& hierarchy, int startIdx, bool isForward, SearchState& state, std::vector<std::pair<int, float>>& settled)
+	{
+		settled.clear();
+		if (startIdx < 0 || startIdx >= hierarchy.GetNrOfNodes() || hierarchy.GetRank(startIdx) == -1)
+			return;
+
+		state.Begin(startIdx);
+		while (!state.openList.empty())
+		{
+			const SearchState::QueueEntry current = state.Pop();
+			const int idx = current.second;
+			if (current.first > state.costs[idx])
+				continue;
+
+			// Stall on demand (see ContractionHierarchyQuery::Settle), a stalled node has the wrong cost
+			bool isStalled = false;
+			const int firstStallArc = isForward ? hierarchy.GetFirstDownArc(idx) : hierarchy.GetFirstUpArc(idx);
+			const int lastStallArc = isForward ? hierarchy.GetLastDownArc(idx) : hierarchy.GetLastUpArc(idx);
+			for (int arcIdx = firstStallArc; arcIdx < lastStallArc && !isStalled; ++arcIdx)
+			{
+				const ContractionHierarchy::Arc& arc = isForward ? hierarchy.GetDownArc(arcIdx) : hierarchy.GetUpArc(arcIdx);
+				isStalled = state.GetCost(arc.target) + arc.cost < current.first;
+			}
+			if (isStalled)
+				continue;
+
+			settled.push_back({ idx, current.first });
+
+			const int firstArc = isForward ? hierarchy.GetFirstUpArc(idx) : hierarchy.GetFirstDownArc(idx);
+			const int lastArc = isForward ? hierarchy.GetLastUpArc(idx) : hierarchy.GetLastDownArc(idx);
+			for (int arcIdx = firstArc; arcIdx < lastArc; ++arcIdx)
+			{
+				const ContractionHierarchy::Arc& arc = isForward ? hierarchy.GetUpArc(arcIdx) : hierarchy.GetDownArc(arcIdx);
+				const float cost = current.first + arc.cost;
+				if (cost < state.GetCost(arc.target))
+					state.Reach(arc.target, cost);
+			}
+		}
+	}
+}
+
+void DistanceMatrix::Resize(int nrOfSources, int nrOfTargets)
+{
+	m_NrOfSources = nrOfSources;
+	m_NrOfTargets = nrOfTargets;
+	m_Costs.assign(size_t(nrOfSources) * nrOfTargets, FLT_MAX);
+}
+
+int DistanceMatrix::GetNearestTarget(int sourceIndex) const
+{
+	int nearestTarget = -1;
+	float nearestCost = FLT_MAX;
+	const float* pRow = GetRow(sourceIndex);
+	for (int targetIndex = 0; targetIndex < m_NrOfTargets; ++targetIndex)
+	{
+		if (pRow[targetIndex] < nearestCost)
+		{
+			nearestCost = pRow[targetIndex];
+			nearestTarget = targetIndex;
+		}
+	}
+	return nearestTarget;
+}
+
+void DistanceMatrix::Compute(const GraphCSR& graph, const GraphCSR& reverseGraph, const std::vector<int>& sources, const std::vector<int>& targets, ThreadPool* pThreadPool)
+{
+	Resize(int(sources.size()), int(targets.size()));
+
+	// Search from the smaller of the two sets, from the targets the costs are those of the arcs the other way around
+	const bool isReversed = targets.size() < sources.size();
+	const GraphCSR& searchGraph = isReversed ? reverseGraph : graph;
+	const std::vector<int>& starts = isReversed ? targets : sources;
+	const std::vector<int>& ends = isReversed ? sources : targets;
+
+	// Positions of the ends at every node, as linked lists: a node can be in the list more than once
+	const int nrOfNodes = graph.GetNrOfNodes();
+	std::vector<int> firstEnds(nrOfNodes, -1);
+	std::vector<int> nextEnds(ends.size(), -1);
+	int nrOfEndNodes = 0;
+	for (int i = 0; i < int(ends.size()); ++i)
+	{
+		if (!graph.IsNodeValid(ends[i]))
+			continue;
+
+		if (firstEnds[ends[i]] == -1)
+			++nrOfEndNodes;
+		nextEnds[i] = firstEnds[ends[i]];
+		firstEnds[ends[i]] = i;
+	}
+
+	ForEachRange(int(starts.size()), nrOfNodes, pThreadPool, [&](int begin, int end, SearchState& state)
+	{
+		for (int startIndex = begin; startIndex < end; ++startIndex)
+		{
+			const int startIdx = starts[startIndex];
+			if (!graph.IsNodeValid(startIdx))
+				continue;
+
+			// Stops once every end is settled
+			int nrOfEndNodesLeft = nrOfEndNodes;
+			state.Begin(startIdx);
+			while (!state.openList.empty() && nrOfEndNodesLeft > 0)
+			{
+				const SearchState::QueueEntry current = state.Pop();
+				const int idx = current.second;
+				if (current.first > state.costs[idx])
+					continue;
+
+				if (firstEnds[idx] != -1)
+				{
+					--nrOfEndNodesLeft;
+					for (int endIndex = firstEnds[idx]; endIndex != -1; endIndex = nextEnds[endIndex])
+					{
+						if (isReversed)
+							SetCost(endIndex, startIndex, current.first);
+						else
+							SetCost(startIndex, endIndex, current.first);
+					}
+				}
+
+				for (int arc = searchGraph.GetFirstArc(idx); arc < searchGraph.GetLastArc(idx); ++arc)
+				{
+					const int neighborIdx = searchGraph.GetArcTarget(arc);
+					const float cost = current.first + searchGraph.GetArcCost(arc);
+					if (cost < state.GetCost(neighborIdx))
+						state.Reach(neighborIdx, cost);
+				}
+			}
+		}
+	});
+}
+
+void DistanceMatrix::Compute(const ContractionHierarchy& hierarchy, const std::vector<int>& sources, const std::vector<int>& targets, ThreadPool* pThreadPool)
+{
+	Resize(int(sources.size()), int(targets.size()));
+	const int nrOfNodes = hierarchy.GetNrOfNodes();
+
+	// Backward upward searches, every target's own list of the nodes it settled
+	std::vector<std::vector<std::pair<int, float>>> targetSpaces(targets.size());
+	ForEachRange(int(targets.size()), nrOfNodes, pThreadPool, [&](int begin, int end, SearchState& state)
+	{
+		for (int targetIndex = begin; targetIndex < end; ++targetIndex)
+			SearchUpward(hierarchy, targets[targetIndex], false, state, targetSpaces[targetIndex]);
+	});
+
+	// Buckets: the targets that settled every node with their costs, sorted on node
+	struct BucketEntry
+	{
+		int targetIndex;
+		float cost;
+	};
+	std::vector<int> bucketOffsets(nrOfNodes + 1, 0);
+	for (const auto& space : targetSpaces)
+	{
+		for (const auto& settled : space)
+			++bucketOffsets[settled.first + 1];
+	}
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+		bucketOffsets[idx + 1] += bucketOffsets[idx];
+
+	std::vector<BucketEntry> buckets(bucketOffsets[nrOfNodes]);
+	std::vector<int> cursors(bucketOffsets.begin(), bucketOffsets.end() - 1);
+	for (int targetIndex = 0; targetIndex < int(targets.size()); ++targetIndex)
+	{
+		for (const auto& settled : targetSpaces[targetIndex])
+			buckets[cursors[settled.first]++] = { targetIndex, settled.second };
+	}
+
+	// Forward upward searches, the cheapest meeting over the buckets of the nodes they settle
+	ForEachRange(int(sources.size()), nrOfNodes, pThreadPool, [&](int begin, int end, SearchState& state)
+	{
+		std::vector<std::pair<int, float>> space{};
+		for (int sourceIndex = begin; sourceIndex < end; ++sourceIndex)
+		{
+			SearchUpward(hierarchy, sources[sourceIndex], true, state, space);
+			float* pRow = &m_Costs[size_t(sourceIndex) * m_NrOfTargets];
+			for (const auto& settled : space)
+			{
+				for (int entry = bucketOffsets[settled.first]; entry < bucketOffsets[settled.first + 1]; ++entry)
+				{
+					const BucketEntry& bucketEntry = buckets[entry];
+					pRow[bucketEntry.targetIndex] = std::min(pRow[bucketEntry.targetIndex], settled.second + bucketEntry.cost);
+				}
+			}
+		}
+	});
+}
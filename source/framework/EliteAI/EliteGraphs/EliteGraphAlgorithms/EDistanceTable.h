@@ -0,0 +1,127 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EDistanceTable.h: Costs from every node of one set to every node of another (agents to cover points, to resources)
+// in one go, instead of a search per pair.
+// Without a hierarchy it is a Dijkstra search per source that stops once it settled all targets, or per target over
+// the reversed arcs when there are fewer targets. With a contraction hierarchy (see EContractionHierarchy.h) it is
+// the bucket algorithm of Knopp et al.: an upward search back from every target leaves its costs in buckets at the
+// nodes it settles, the upward search from every source then only has to look in the buckets of the nodes it settles.
+// The searches run in parallel when there is a thread pool. The table belongs to the caller, who keeps it for as long
+// as the costs are needed and can fill the same one again to reuse its memory.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EContractionHierarchy.h"
+#include "framework\EliteHelpers\EThreadPool.h"
+
+namespace Elite
+{
+	// Dense, row per source
+	class DistanceMatrix final
+	{
+	public:
+		void Resize(int nrOfSources, int nrOfTargets);
+
+		int GetNrOfSources() const { return m_NrOfSources; }
+		int GetNrOfTargets() const { return m_NrOfTargets; }
+		// By position in the lists of sources and targets, FLT_MAX when the target can't be reached
+		float GetCost(int sourceIndex, int targetIndex) const { return m_Costs[size_t(sourceIndex) * m_NrOfTargets + targetIndex]; }
+		void SetCost(int sourceIndex, int targetIndex, float cost) { m_Costs[size_t(sourceIndex) * m_NrOfTargets + targetIndex] = cost; }
+		const float* GetRow(int sourceIndex) const { return &m_Costs[size_t(sourceIndex) * m_NrOfTargets]; }
+
+		// Position of the cheapest target to reach from the source, -1 if none can be reached
+		int GetNearestTarget(int sourceIndex) const;
+
+		// Dijkstra searches from the sources, or from the targets over the reverse snapshot (the arcs arriving at every node,
+		// the snapshot itself for an undirected graph) when there are fewer targets
+		void Compute(const GraphCSR& graph, const GraphCSR& reverseGraph, const std::vector<int>& sources, const std::vector<int>& targets, ThreadPool* pThreadPool = nullptr);
+		// Bucket based, on a hierarchy built for the graph
+		void Compute(const ContractionHierarchy& hierarchy, const std::vector<int>& sources, const std::vector<int>& targets, ThreadPool* pThreadPool = nullptr);
+
+	private:
+		int m_NrOfSources = 0;
+		int m_NrOfTargets = 0;
+		std::vector<float> m_Costs;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	class DistanceTable final
+	{
+	public:
+		explicit DistanceTable(IGraph<T_NodeType, T_ConnectionType>* pGraph, ThreadPool* pThreadPool = nullptr);
+
+		// Fills distances with the costs from every source to every target on the current graph
+		void GetDistances(const std::vector<int>& sources, const std::vector<int>& targets, DistanceMatrix& distances);
+		void GetDistances(const std::vector<T_NodeType*>& sources, const std::vector<T_NodeType*>& targets, DistanceMatrix& distances);
+
+		// Used while it's built for the current version of the graph, not owned
+		void SetContractionHierarchy(const ContractionHierarchy* pHierarchy) { m_pHierarchy = pHierarchy; }
+		// Snapshot the tables are computed on, to build a hierarchy for
+		const GraphCSR& GetCSR() { UpdateCSR(); return m_CSR; }
+
+		//C++ make the class non-copyable
+		DistanceTable(const DistanceTable&) = delete;
+		DistanceTable& operator=(const DistanceTable&) = delete;
+
+	private:
+		void UpdateCSR();
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		ThreadPool* m_pThreadPool;
+		const ContractionHierarchy* m_pHierarchy = nullptr;
+
+		// Snapshot, rebuilt when the graph changed, the reverse one only for directed graphs
+		GraphCSR m_CSR;
+		GraphCSR m_ReverseCSR;
+		bool m_IsCSRBuilt = false;
+
+		std::vector<int> m_Sources;
+		std::vector<int> m_Targets;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline DistanceTable<T_NodeType, T_ConnectionType>::DistanceTable(IGraph<T_NodeType, T_ConnectionType>* pGraph, ThreadPool* pThreadPool)
+		: m_pGraph(pGraph)
+		, m_pThreadPool(pThreadPool)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DistanceTable<T_NodeType, T_ConnectionType>::GetDistances(const std::vector<int>& sources, const std::vector<int>& targets, DistanceMatrix& distances)
+	{
+		UpdateCSR();
+
+		if (m_pHierarchy && m_pHierarchy->IsBuiltFor(m_CSR))
+			distances.Compute(*m_pHierarchy, sources, targets, m_pThreadPool);
+		else
+			distances.Compute(m_CSR, m_CSR.IsDirectionalGraph() ? m_ReverseCSR : m_CSR, sources, targets, m_pThreadPool);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DistanceTable<T_NodeType, T_ConnectionType>::GetDistances(const std::vector<T_NodeType*>& sources, const std::vector<T_NodeType*>& targets, DistanceMatrix& distances)
+	{
+		m_Sources.clear();
+		for (T_NodeType* pNode : sources)
+			m_Sources.push_back(pNode ? pNode->GetIndex() : invalid_node_index);
+
+		m_Targets.clear();
+		for (T_NodeType* pNode : targets)
+			m_Targets.push_back(pNode ? pNode->GetIndex() : invalid_node_index);
+
+		GetDistances(m_Sources, m_Targets, distances);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void DistanceTable<T_NodeType, T_ConnectionType>::UpdateCSR()
+	{
+		if (m_IsCSRBuilt && m_CSR.GetVersion() == m_pGraph->GetVersion())
+			return;
+
+		m_CSR.Build(*m_pGraph);
+		if (m_CSR.IsDirectionalGraph())
+			m_ReverseCSR.BuildTransposed(m_CSR);
+		m_IsCSRBuilt = true;
+	}
+}
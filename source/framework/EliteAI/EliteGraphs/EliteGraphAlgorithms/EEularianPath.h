@@ -1,5 +1,5 @@
 #pragma once
-#include <stack>
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
 
 namespace Elite
 {
@@ -10,6 +10,8 @@ namespace Elite
 		eulerian,
 	};
 
+	// Works on a CSR snapshot of the graph, which is only rebuilt when the topology of the graph changed
+	// The graph itself is never modified
 	template <class T_NodeType, class T_ConnectionType>
 	class EulerianPath
 	{
@@ -21,10 +23,19 @@ namespace Elite
 		std::vector<T_NodeType*> FindPath(Eulerianity& eulerianity) const;
 
 	private:
+		void UpdateCSR() const;
 		void VisitAllNodesDFS(int startIdx, std::vector<bool>& visited) const;
 		bool IsConnected() const;
 
 		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+
+		// Snapshot and scratch memory, reused between calls
+		mutable GraphCSR m_CSR;
+		mutable bool m_IsCSRBuilt = false;
+		mutable std::vector<bool> m_UsedArcs;
+		mutable std::vector<int> m_Cursors;
+		mutable std::vector<int> m_NodeStack;
+		mutable std::vector<bool> m_Visited;
 	};
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -36,18 +47,18 @@ namespace Elite
 	template<class T_NodeType, class T_ConnectionType>
 	inline Eulerianity EulerianPath<T_NodeType, T_ConnectionType>::IsEulerian() const
 	{
+		UpdateCSR();
+
 		// If the graph is not connected, there can be no Eulerian Trail
 		if (IsConnected() == false)
 			return Eulerianity::notEulerian;
 
-		// Count nodes with odd degree 
-		auto activeNodes = m_pGraph->GetAllNodes();
+		// Count nodes with odd degree
 		int oddCount = 0;
-		for (auto node : activeNodes)
+		for (int idx = 0; idx < m_CSR.GetNrOfNodes(); ++idx)
 		{
-			auto connections = m_pGraph->GetNodeConnections(node);
 			// checks if is an odd amount
-			if (connections.size() & 1)
+			if (m_CSR.IsNodeValid(idx) && (m_CSR.GetDegree(idx) & 1))
 				oddCount++;
 		}
 
@@ -57,7 +68,7 @@ namespace Elite
 
 		// A connected graph with exactly 2 nodes with an odd degree is Semi-Eulerian (unless there are only 2 nodes)
 		// An Euler trail can be made, but only starting and ending in these 2 nodes
-		if (oddCount == 2 && activeNodes.size() != 2)
+		if (oddCount == 2 && m_CSR.GetNrOfActiveNodes() != 2)
 			return Eulerianity::semiEulerian;
 
 		// A connected graph with no odd nodes is Eulerian
@@ -67,105 +78,72 @@ namespace Elite
 	template<class T_NodeType, class T_ConnectionType>
 	inline std::vector<T_NodeType*> EulerianPath<T_NodeType, T_ConnectionType>::FindPath(Eulerianity& eulerianity) const
 	{
-		// Get a copy of the graph because this algorithm involves removing edges (do not change original graph)
-		auto graphCopy = m_pGraph->Clone();
-		auto path = vector<T_NodeType*>();
-		int nrOfNodes = graphCopy->GetNrOfNodes();
-		stack<int> nodeStack;
-		int currentIndex{};
-
+		auto path = std::vector<T_NodeType*>();
 
 		// Check if there can be an Euler path
 		// If this graph is not eulerian, return the empty path
-		// Else we need to find a valid starting index for the algorithm
-		if (eulerianity == Eulerianity::notEulerian) return path;
-
-		// Start algorithm loop
-
-		// 1.----------------------
-		// see the amount of degrees aka connections that the nodes have
-		// if all nodes have an even amount of connections, choose any
-		// otherwise if there are exactly 2 nodes with an odd amount of connections choose one of them
-		// otherwise no euler path/circuit exists
+		if (eulerianity == Eulerianity::notEulerian)
+			return path;
 
-		// odd count == 2
+		UpdateCSR();
 
-		auto activeNodes = graphCopy->GetAllNodes();
-
-		if (eulerianity == Eulerianity::semiEulerian) {
+		// Start in a node with an odd degree if there is one, the trail has to end in the other one
+		// Otherwise start in any node that has connections
+		int startIdx = invalid_node_index;
+		for (int idx = 0; idx < m_CSR.GetNrOfNodes(); ++idx)
+		{
+			if (!m_CSR.IsNodeValid(idx) || m_CSR.GetDegree(idx) == 0)
+				continue;
 
+			if (startIdx == invalid_node_index)
+				startIdx = idx;
 
-			for (auto node : activeNodes)
+			if (m_CSR.GetDegree(idx) & 1)
 			{
-				auto connections = graphCopy->GetNodeConnections(node);
-				// checks if is an odd amount
-				if (connections.size() & 1)
-					currentIndex = node->GetIndex();
+				startIdx = idx;
+				break;
 			}
-
-		};
-
-		if (eulerianity == Eulerianity::eulerian)
-		{
-			currentIndex = activeNodes.at(0)->GetIndex();
 		}
 
-		// 2.----------------------
-		// if current node has no neighbors
-		// add it to the path
-		// remove the last node from the stack
-		// set the current node to this one
+		if (startIdx == invalid_node_index)
+			return path;
 
-		auto currentNode = activeNodes.at(currentIndex);
+		// Hierholzer: follow unused arcs until getting stuck, the node where that happens is the next one of the (reversed) path
+		// An arc is used up together with its twin, every node keeps a cursor to its first arc that might still be unused
+		m_UsedArcs.assign(m_CSR.GetNrOfArcs(), false);
+		m_Cursors.resize(m_CSR.GetNrOfNodes());
+		for (int idx = 0; idx < m_CSR.GetNrOfNodes(); ++idx)
+			m_Cursors[idx] = m_CSR.GetFirstArc(idx);
 
-		auto connections = graphCopy->GetNodeConnections(currentNode);
+		path.reserve(m_CSR.IsDirectionalGraph() ? m_CSR.GetNrOfArcs() + 1 : m_CSR.GetNrOfArcs() / 2 + 1);
+		m_NodeStack.clear();
+		m_NodeStack.push_back(startIdx);
 
-		// ALGORITHM LOOP
-		while (connections.size() > 0 || nodeStack.size() > 0)
+		while (!m_NodeStack.empty())
 		{
-			if (connections.size() < 1)
-			{
-				// if has no neighbors
-				path.push_back(currentNode);
-
-				// if the stack isn't empty, pop the last element
-				//if (nodeStack.size() > 0)
-				//{
-				currentIndex = nodeStack.top();
-				currentNode = activeNodes.at(currentIndex);
-				nodeStack.pop();
-				//}
+			const int currentIdx = m_NodeStack.back();
+			int& cursor = m_Cursors[currentIdx];
+			while (cursor < m_CSR.GetLastArc(currentIdx) && m_UsedArcs[cursor])
+				++cursor;
 
+			if (cursor == m_CSR.GetLastArc(currentIdx))
+			{
+				// if has no neighbors left, add it to the path
+				path.push_back(m_pGraph->GetNode(currentIdx));
+				m_NodeStack.pop_back();
 			}
 			else
 			{
-				// does have neighbors
-
-				// add it to the stack
-				nodeStack.push(currentIndex);
-
-				auto neighborIndex = connections.front()->GetTo();
-
-				// take a neighbor
-				graphCopy.get()->RemoveConnection(connections.front());
-
-				currentNode = activeNodes.at(neighborIndex);
-
-				connections = graphCopy->GetNodeConnections(currentNode);
+				// take a neighbor and remove the connection to it
+				const int arc = cursor++;
+				m_UsedArcs[arc] = true;
+				if (m_CSR.GetArcTwin(arc) != invalid_arc_index)
+					m_UsedArcs[m_CSR.GetArcTwin(arc)] = true;
 
+				m_NodeStack.push_back(m_CSR.GetArcTarget(arc));
 			}
 		}
 
-		// ELSE if it does have neighbors
-		// add the node to the stack
-		// take any of its neighbors
-		// remove the edge between selected neighbor and that node
-		// set that neighbor as the current node
-
-
-
-		// repeat 2. until the current node has no more connections
-		// and the stack is empty (while loop)
 		// obtained path will be in reverse
 		std::reverse(path.begin(), path.end());
 
@@ -173,37 +151,56 @@ namespace Elite
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
-	inline void EulerianPath<T_NodeType, T_ConnectionType>::VisitAllNodesDFS(int startIdx, std::vector<bool>& visited) const
+	inline void EulerianPath<T_NodeType, T_ConnectionType>::UpdateCSR() const
 	{
-		// mark the visited node
-		visited[startIdx] = true;
+		// Positions and costs don't matter here, so only a change in topology requires a new snapshot
+		if (m_IsCSRBuilt && m_CSR.GetTopologyVersion() == m_pGraph->GetTopologyVersion())
+			return;
 
+		m_CSR.Build(*m_pGraph);
+		m_IsCSRBuilt = true;
+	}
 
-		// recursively visit any valid connected nodes that were not visited before
-		for (T_ConnectionType* connection : m_pGraph->GetNodeConnections(startIdx))
-			if (visited[connection->GetTo()] == false)
-				VisitAllNodesDFS(connection->GetTo(), visited);
+	template<class T_NodeType, class T_ConnectionType>
+	inline void EulerianPath<T_NodeType, T_ConnectionType>::VisitAllNodesDFS(int startIdx, std::vector<bool>& visited) const
+	{
+		// iterative, with an explicit stack so large graphs can't overflow the call stack
+		m_NodeStack.clear();
+		m_NodeStack.push_back(startIdx);
+		visited[startIdx] = true;
 
+		while (!m_NodeStack.empty())
+		{
+			const int currentIdx = m_NodeStack.back();
+			m_NodeStack.pop_back();
 
+			// visit any valid connected nodes that were not visited before
+			for (int arc = m_CSR.GetFirstArc(currentIdx); arc < m_CSR.GetLastArc(currentIdx); ++arc)
+			{
+				const int neighborIdx = m_CSR.GetArcTarget(arc);
+				if (visited[neighborIdx] == false)
+				{
+					// mark the visited node
+					visited[neighborIdx] = true;
+					m_NodeStack.push_back(neighborIdx);
+				}
+			}
+		}
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
 	inline bool EulerianPath<T_NodeType, T_ConnectionType>::IsConnected() const
 	{
-		auto activeNodes = m_pGraph->GetAllNodes();
-		vector<bool> visited(m_pGraph->GetNrOfNodes(), false);
-
-		if (activeNodes.size() > 1 && m_pGraph->GetAllConnections().size() == 0)
+		if (m_CSR.GetNrOfActiveNodes() > 1 && m_CSR.GetNrOfArcs() == 0)
 			return false;
 
 		// find a valid starting node that has connections
 		int connectedIdx = invalid_node_index;
-		for (auto node : activeNodes)
+		for (int idx = 0; idx < m_CSR.GetNrOfNodes(); ++idx)
 		{
-			auto connections = m_pGraph->GetNodeConnections(node);
-			if (connections.size() != 0)
+			if (m_CSR.IsNodeValid(idx) && m_CSR.GetDegree(idx) != 0)
 			{
-				connectedIdx = node->GetIndex();
+				connectedIdx = idx;
 				break;
 			}
 		}
@@ -213,16 +210,17 @@ namespace Elite
 			return false;
 
 		// start a depth-first-search traversal from the node that has at least one connection
-		VisitAllNodesDFS(connectedIdx, visited);
+		m_Visited.assign(m_CSR.GetNrOfNodes(), false);
+		VisitAllNodesDFS(connectedIdx, m_Visited);
 
 		// if a node was never visited, this graph is not connected
-		for (auto node : activeNodes)
+		for (int idx = 0; idx < m_CSR.GetNrOfNodes(); ++idx)
 		{
-			if (visited[node->GetIndex()] == false)
+			if (m_CSR.IsNodeValid(idx) && m_Visited[idx] == false)
 				return false;
 		}
 
 		return true;
 	}
 
-}
\ No newline at end of file
+}
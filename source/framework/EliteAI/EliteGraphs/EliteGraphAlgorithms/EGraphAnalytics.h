@@ -0,0 +1,386 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphAnalytics.h: Reachability queries on a graph: breadth first search and (strongly) connected components.
+// The components are computed once per topology version of the graph, after that asking whether
+// two nodes can reach each other is a lookup, which lets a pathfinder reject impossible requests before searching.
+/*=============================================================================*/
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+
+namespace Elite
+{
+	template <class T_NodeType, class T_ConnectionType>
+	class GraphAnalytics
+	{
+	public:
+		GraphAnalytics(IGraph<T_NodeType, T_ConnectionType>* pGraph);
+
+		// Number of connections on the shortest route from startIdx to every node, -1 for the nodes it can't reach
+		// Direction optimizing: while the frontier is large, the unvisited nodes look for a parent in the frontier instead
+		const std::vector<int>& BreadthFirstSearch(int startIdx, bool isDirectionOptimizing = true) const;
+
+		// Connected components of an undirected graph, strongly connected components of a directed graph
+		// Removed nodes are in component invalid_node_index
+		int GetNrOfComponents() const;
+		int GetComponentId(int idx) const;
+		const std::vector<int>& GetComponentIds() const;
+		// Components when ignoring the direction of the connections, the same as GetComponentId in undirected graphs
+		int GetWeakComponentId(int idx) const;
+
+		// True if there certainly is no path from 'from' to 'to'
+		// In a directed graph, nodes of the same weak component can still be unreachable, only a search can tell
+		bool IsUnreachable(int from, int to) const;
+		// True if there certainly is a path from 'from' to 'to' (both in the same (strongly) connected component)
+		bool IsReachable(int from, int to) const;
+
+		// Snapshot the results are based on
+		const GraphCSR& GetCSR() const { UpdateCSR(); return m_CSR; }
+
+	private:
+		void UpdateCSR() const;
+		void UpdateComponents() const;
+		void ComputeWeakComponents() const;
+		void ComputeStrongComponents() const;
+		int FindRoot(int idx) const;
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+
+		// Snapshot and results, rebuilt when the topology of the graph changed
+		mutable GraphCSR m_CSR;
+		mutable GraphCSR m_TransposedCSR;
+		mutable bool m_IsCSRBuilt = false;
+		mutable bool m_IsTransposedCSRBuilt = false;
+		mutable bool m_AreComponentsComputed = false;
+
+		mutable std::vector<int> m_ComponentIds;
+		mutable std::vector<int> m_WeakComponentIds;
+		mutable int m_NrOfComponents = 0;
+
+		// Scratch memory, reused between calls
+		mutable std::vector<int> m_Distances;
+		mutable std::vector<int> m_Frontier;
+		mutable std::vector<int> m_NextFrontier;
+		mutable std::vector<int> m_Parents;
+		mutable std::vector<int> m_Indices;
+		mutable std::vector<int> m_LowLinks;
+		mutable std::vector<bool> m_IsOnStack;
+		mutable std::vector<int> m_NodeStack;
+		mutable std::vector<std::pair<int, int>> m_CallStack;
+	};
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline GraphAnalytics<T_NodeType, T_ConnectionType>::GraphAnalytics(IGraph<T_NodeType, T_ConnectionType>* pGraph)
+		: m_pGraph(pGraph)
+	{
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline const std::vector<int>& GraphAnalytics<T_NodeType, T_ConnectionType>::BreadthFirstSearch(int startIdx, bool isDirectionOptimizing) const
+	{
+		UpdateCSR();
+
+		const int nrOfNodes = m_CSR.GetNrOfNodes();
+		m_Distances.assign(nrOfNodes, -1);
+		if (!m_CSR.IsNodeValid(startIdx))
+			return m_Distances;
+
+		// Bottom-up steps need the arcs arriving at a node, which are the outgoing ones in an undirected graph
+		const GraphCSR* pIncoming = &m_CSR;
+		if (isDirectionOptimizing && m_CSR.IsDirectionalGraph())
+		{
+			if (!m_IsTransposedCSRBuilt)
+			{
+				m_TransposedCSR.BuildTransposed(m_CSR);
+				m_IsTransposedCSRBuilt = true;
+			}
+			pIncoming = &m_TransposedCSR;
+		}
+
+		// Switch thresholds as proposed by Beamer et al.: go bottom-up when the frontier has more arcs than
+		// 1/14th of the unexplored ones, go back top-down when the frontier has less than 1/24th of the nodes
+		const int topDownFactor = 14;
+		const int bottomUpFactor = 24;
+
+		m_Distances[startIdx] = 0;
+		m_Frontier.clear();
+		m_Frontier.push_back(startIdx);
+
+		int level = 0;
+		int nrOfUnexploredArcs = m_CSR.GetNrOfArcs() - m_CSR.GetDegree(startIdx);
+		int nrOfFrontierArcs = m_CSR.GetDegree(startIdx);
+		bool isTopDown = true;
+
+		while (!m_Frontier.empty())
+		{
+			if (isDirectionOptimizing)
+			{
+				if (isTopDown && nrOfFrontierArcs > nrOfUnexploredArcs / topDownFactor)
+					isTopDown = false;
+				else if (!isTopDown && int(m_Frontier.size()) < nrOfNodes / bottomUpFactor)
+					isTopDown = true;
+			}
+
+			m_NextFrontier.clear();
+			nrOfFrontierArcs = 0;
+
+			if (isTopDown)
+			{
+				// every node of the frontier visits its neighbors
+				for (int currentIdx : m_Frontier)
+				{
+					for (int arc = m_CSR.GetFirstArc(currentIdx); arc < m_CSR.GetLastArc(currentIdx); ++arc)
+					{
+						const int neighborIdx = m_CSR.GetArcTarget(arc);
+						if (m_Distances[neighborIdx] != -1)
+							continue;
+
+						m_Distances[neighborIdx] = level + 1;
+						m_NextFrontier.push_back(neighborIdx);
+						nrOfFrontierArcs += m_CSR.GetDegree(neighborIdx);
+					}
+				}
+			}
+			else
+			{
+				// every unvisited node stops at the first parent it finds in the frontier
+				for (int idx = 0; idx < nrOfNodes; ++idx)
+				{
+					if (m_Distances[idx] != -1 || !m_CSR.IsNodeValid(idx))
+						continue;
+
+					for (int arc = pIncoming->GetFirstArc(idx); arc < pIncoming->GetLastArc(idx); ++arc)
+					{
+						if (m_Distances[pIncoming->GetArcTarget(arc)] != level)
+							continue;
+
+						m_Distances[idx] = level + 1;
+						m_NextFrontier.push_back(idx);
+						nrOfFrontierArcs += m_CSR.GetDegree(idx);
+						break;
+					}
+				}
+			}
+
+			nrOfUnexploredArcs -= nrOfFrontierArcs;
+			m_Frontier.swap(m_NextFrontier);
+			++level;
+		}
+
+		return m_Distances;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline int GraphAnalytics<T_NodeType, T_ConnectionType>::GetNrOfComponents() const
+	{
+		UpdateComponents();
+		return m_NrOfComponents;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline int GraphAnalytics<T_NodeType, T_ConnectionType>::GetComponentId(int idx) const
+	{
+		UpdateComponents();
+		return m_CSR.IsNodeValid(idx) ? m_ComponentIds[idx] : invalid_node_index;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline const std::vector<int>& GraphAnalytics<T_NodeType, T_ConnectionType>::GetComponentIds() const
+	{
+		UpdateComponents();
+		return m_ComponentIds;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline int GraphAnalytics<T_NodeType, T_ConnectionType>::GetWeakComponentId(int idx) const
+	{
+		UpdateComponents();
+		return m_CSR.IsNodeValid(idx) ? m_WeakComponentIds[idx] : invalid_node_index;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline bool GraphAnalytics<T_NodeType, T_ConnectionType>::IsUnreachable(int from, int to) const
+	{
+		UpdateComponents();
+		if (!m_CSR.IsNodeValid(from) || !m_CSR.IsNodeValid(to))
+			return true;
+
+		return m_WeakComponentIds[from] != m_WeakComponentIds[to];
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline bool GraphAnalytics<T_NodeType, T_ConnectionType>::IsReachable(int from, int to) const
+	{
+		UpdateComponents();
+		if (!m_CSR.IsNodeValid(from) || !m_CSR.IsNodeValid(to))
+			return false;
+
+		return m_ComponentIds[from] == m_ComponentIds[to];
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void GraphAnalytics<T_NodeType, T_ConnectionType>::UpdateCSR() const
+	{
+		// Reachability doesn't depend on positions and costs, so only a change in topology requires a new snapshot
+		if (m_IsCSRBuilt && m_CSR.GetTopologyVersion() == m_pGraph->GetTopologyVersion())
+			return;
+
+		m_CSR.Build(*m_pGraph);
+		m_IsCSRBuilt = true;
+		m_IsTransposedCSRBuilt = false;
+		m_AreComponentsComputed = false;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void GraphAnalytics<T_NodeType, T_ConnectionType>::UpdateComponents() const
+	{
+		UpdateCSR();
+		if (m_AreComponentsComputed)
+			return;
+
+		ComputeWeakComponents();
+		if (m_CSR.IsDirectionalGraph())
+		{
+			ComputeStrongComponents();
+		}
+		else
+		{
+			m_ComponentIds = m_WeakComponentIds;
+		}
+
+		m_AreComponentsComputed = true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void GraphAnalytics<T_NodeType, T_ConnectionType>::ComputeWeakComponents() const
+	{
+		const int nrOfNodes = m_CSR.GetNrOfNodes();
+
+		// Union-find over all arcs, the parent of a root is -(size of its set)
+		m_Parents.assign(nrOfNodes, -1);
+		for (int from = 0; from < nrOfNodes; ++from)
+		{
+			for (int arc = m_CSR.GetFirstArc(from); arc < m_CSR.GetLastArc(from); ++arc)
+			{
+				int rootA = FindRoot(from);
+				int rootB = FindRoot(m_CSR.GetArcTarget(arc));
+				if (rootA == rootB)
+					continue;
+
+				// union by size, the smaller set is hung below the larger one
+				if (m_Parents[rootA] > m_Parents[rootB])
+					std::swap(rootA, rootB);
+				m_Parents[rootA] += m_Parents[rootB];
+				m_Parents[rootB] = rootA;
+			}
+		}
+
+		// Number the sets in order of their first node, the ids of the roots are temporarily stored in m_WeakComponentIds
+		int nrOfComponents = 0;
+		m_WeakComponentIds.assign(nrOfNodes, invalid_node_index);
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			if (!m_CSR.IsNodeValid(idx))
+				continue;
+
+			const int root = FindRoot(idx);
+			if (m_WeakComponentIds[root] == invalid_node_index)
+				m_WeakComponentIds[root] = nrOfComponents++;
+			m_WeakComponentIds[idx] = m_WeakComponentIds[root];
+		}
+
+		m_NrOfComponents = nrOfComponents;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void GraphAnalytics<T_NodeType, T_ConnectionType>::ComputeStrongComponents() const
+	{
+		const int nrOfNodes = m_CSR.GetNrOfNodes();
+
+		// Tarjan, with an explicit call stack of (node, next arc to visit) so large graphs can't overflow the call stack
+		m_Indices.assign(nrOfNodes, -1);
+		m_LowLinks.assign(nrOfNodes, 0);
+		m_IsOnStack.assign(nrOfNodes, false);
+		m_ComponentIds.assign(nrOfNodes, invalid_node_index);
+		m_NodeStack.clear();
+		m_CallStack.clear();
+
+		int nextIndex = 0;
+		int nrOfComponents = 0;
+
+		for (int startIdx = 0; startIdx < nrOfNodes; ++startIdx)
+		{
+			if (!m_CSR.IsNodeValid(startIdx) || m_Indices[startIdx] != -1)
+				continue;
+
+			m_Indices[startIdx] = m_LowLinks[startIdx] = nextIndex++;
+			m_NodeStack.push_back(startIdx);
+			m_IsOnStack[startIdx] = true;
+			m_CallStack.push_back({ startIdx, m_CSR.GetFirstArc(startIdx) });
+
+			while (!m_CallStack.empty())
+			{
+				const int currentIdx = m_CallStack.back().first;
+				const int arc = m_CallStack.back().second;
+
+				if (arc < m_CSR.GetLastArc(currentIdx))
+				{
+					++m_CallStack.back().second;
+
+					const int neighborIdx = m_CSR.GetArcTarget(arc);
+					if (m_Indices[neighborIdx] == -1)
+					{
+						// descend into the neighbor
+						m_Indices[neighborIdx] = m_LowLinks[neighborIdx] = nextIndex++;
+						m_NodeStack.push_back(neighborIdx);
+						m_IsOnStack[neighborIdx] = true;
+						m_CallStack.push_back({ neighborIdx, m_CSR.GetFirstArc(neighborIdx) });
+					}
+					else if (m_IsOnStack[neighborIdx])
+					{
+						m_LowLinks[currentIdx] = std::min(m_LowLinks[currentIdx], m_Indices[neighborIdx]);
+					}
+					continue;
+				}
+
+				// all arcs visited: a node that can't reach anything earlier on the stack is the root of a component
+				if (m_LowLinks[currentIdx] == m_Indices[currentIdx])
+				{
+					int memberIdx = invalid_node_index;
+					do
+					{
+						memberIdx = m_NodeStack.back();
+						m_NodeStack.pop_back();
+						m_IsOnStack[memberIdx] = false;
+						m_ComponentIds[memberIdx] = nrOfComponents;
+					} while (memberIdx != currentIdx);
+
+					++nrOfComponents;
+				}
+
+				// return to the caller
+				m_CallStack.pop_back();
+				if (!m_CallStack.empty())
+				{
+					const int callerIdx = m_CallStack.back().first;
+					m_LowLinks[callerIdx] = std::min(m_LowLinks[callerIdx], m_LowLinks[currentIdx]);
+				}
+			}
+		}
+
+		m_NrOfComponents = nrOfComponents;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline int GraphAnalytics<T_NodeType, T_ConnectionType>::FindRoot(int idx) const
+	{
+		// path halving: every visited node is hung below its grandparent
+		while (m_Parents[idx] >= 0)
+		{
+			if (m_Parents[m_Parents[idx]] >= 0)
+				m_Parents[idx] = m_Parents[m_Parents[idx]];
+			idx = m_Parents[idx];
+		}
+		return idx;
+	}
+}
@@ -0,0 +1,46 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EHeuristicFunctions.h: Estimates of the remaining cost for informed searches, based on the
+// absolute difference in x and y between a node and the goal.
+/*=============================================================================*/
+#pragma once
+
+namespace Elite
+{
+	typedef float(*Heuristic)(float, float);
+
+	struct HeuristicFunctions
+	{
+		// Sum of the differences, only admissible without diagonal movement
+		static float Manhattan(float x, float y)
+		{
+			return x + y;
+		}
+
+		// Straight line distance
+		static float Euclidean(float x, float y)
+		{
+			return sqrtf(x * x + y * y);
+		}
+
+		// Square root of the Manhattan distance, cheap but not admissible
+		static float Sqrt(float x, float y)
+		{
+			return sqrtf(x + y);
+		}
+
+		// Exact distance on a grid with diagonal movement costing sqrt(2)
+		static float Octile(float x, float y)
+		{
+			const float f = 0.414213562f; // sqrt(2) - 1
+			return (x < y) ? f * x + y : f * y + x;
+		}
+
+		// Exact distance on a grid with diagonal movement costing 1
+		static float Chebyshev(float x, float y)
+		{
+			return std::max(x, y);
+		}
+	};
+}
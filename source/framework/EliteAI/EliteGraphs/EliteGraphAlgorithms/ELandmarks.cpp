@@ -0,0 +1,278 @@
+#include "stdafx.h"
+#include "ELandmarks.h"
+
+#include "framework\EliteHelpers\EMemoryMappedFile.h"
+
+using namespace Elite;
+
+namespace
+{
+	struct LandmarkFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t fingerprint;
+		int32_t nrOfNodes;
+		int32_t nrOfLandmarks;
+		uint32_t isDirectionalGraph;
+	};
+
+	// Cost from startIdx to every node, written to costs[idx * stride] (FLT_MAX if unreachable)
+	void Dijkstra(const GraphCSR& graph, int startIdx, float* pCosts, size_t stride)
+	{
+		typedef std::pair<float, int> QueueEntry;
+		std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> openList;
+		std::vector<float> costs(graph.GetNrOfNodes(), FLT_MAX);
+
+		costs[startIdx] = 0.f;
+		openList.push({ 0.f, startIdx });
+		while (!openList.empty())
+		{
+			const QueueEntry current = openList.top();
+			openList.pop();
+			if (current.first > costs[current.second])
+				continue;
+
+			for (int arc = graph.GetFirstArc(current.second); arc < graph.GetLastArc(current.second); ++arc)
+			{
+				const int neighborIdx = graph.GetArcTarget(arc);
+				const float cost = current.first + graph.GetArcCost(arc);
+				if (cost < costs[neighborIdx])
+				{
+					costs[neighborIdx] = cost;
+					openList.push({ cost, neighborIdx });
+				}
+			}
+		}
+
+		for (size_t idx = 0; idx < costs.size(); ++idx)
+			pCosts[idx * stride] = costs[idx];
+	}
+}
+
+void Landmarks::Build(const GraphCSR& graph, int nrOfLandmarks, ThreadPool* pThreadPool)
+{
+	m_NrOfNodes = graph.GetNrOfNodes();
+	m_IsDirectionalGraph = graph.IsDirectionalGraph();
+	m_Version = graph.GetVersion();
+	m_Fingerprint = graph.GetFingerprint();
+	m_IsBuilt = true;
+
+	SelectLandmarks(graph, nrOfLandmarks);
+
+	const size_t stride = m_LandmarkNodes.size();
+	m_CostsFrom.assign(size_t(m_NrOfNodes) * stride, FLT_MAX);
+	m_CostsTo.clear();
+
+	// Costs to a landmark are costs from it with every connection reversed
+	GraphCSR transposed{};
+	if (m_IsDirectionalGraph)
+	{
+		m_CostsTo.assign(size_t(m_NrOfNodes) * stride, FLT_MAX);
+		transposed.BuildTransposed(graph);
+	}
+
+	auto computeCosts = [&](int begin, int end)
+	{
+		for (int landmark = begin; landmark < end; ++landmark)
+		{
+			Dijkstra(graph, m_LandmarkNodes[landmark], m_CostsFrom.data() + landmark, stride);
+			if (m_IsDirectionalGraph)
+				Dijkstra(transposed, m_LandmarkNodes[landmark], m_CostsTo.data() + landmark, stride);
+		}
+	};
+
+	if (pThreadPool)
+		pThreadPool->ParallelFor(int(stride), 1, computeCosts);
+	else
+		computeCosts(0, int(stride));
+}
+
+bool Landmarks::Save(const std::string& path) const
+{
+	if (!m_IsBuilt)
+		return false;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	LandmarkFileHeader header{};
+	header.magic = LANDMARK_FILE_MAGIC;
+	header.version = LANDMARK_FILE_VERSION;
+	header.fingerprint = m_Fingerprint;
+	header.nrOfNodes = m_NrOfNodes;
+	header.nrOfLandmarks = GetNrOfLandmarks();
+	header.isDirectionalGraph = m_IsDirectionalGraph ? 1 : 0;
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(m_LandmarkNodes.data()), std::streamsize(m_LandmarkNodes.size() * sizeof(int32_t)));
+	file.write(reinterpret_cast<const char*>(m_CostsFrom.data()), std::streamsize(m_CostsFrom.size() * sizeof(float)));
+	file.write(reinterpret_cast<const char*>(m_CostsTo.data()), std::streamsize(m_CostsTo.size() * sizeof(float)));
+	return bool(file);
+}
+
+bool Landmarks::Load(const std::string& path, const GraphCSR& graph)
+{
+	MemoryMappedFile file{};
+	if (!file.Open(path) || file.GetSize() < sizeof(LandmarkFileHeader))
+		return false;
+
+	const LandmarkFileHeader& header = *reinterpret_cast<const LandmarkFileHeader*>(file.GetData());
+	if (header.magic != LANDMARK_FILE_MAGIC || header.version != LANDMARK_FILE_VERSION
+		|| header.nrOfNodes != graph.GetNrOfNodes() || header.nrOfLandmarks < 0 || header.nrOfLandmarks > header.nrOfNodes
+		|| (header.isDirectionalGraph != 0) != graph.IsDirectionalGraph()
+		|| header.fingerprint != graph.GetFingerprint())
+		return false;
+
+	const size_t nrOfLandmarks = size_t(header.nrOfLandmarks);
+	const size_t nrOfCosts = size_t(header.nrOfNodes) * nrOfLandmarks;
+	const size_t nrOfTables = header.isDirectionalGraph ? 2 : 1;
+	if (file.GetSize() != sizeof(LandmarkFileHeader) + nrOfLandmarks * sizeof(int32_t) + nrOfTables * nrOfCosts * sizeof(float))
+		return false;
+
+	const int32_t* pLandmarkNodes = reinterpret_cast<const int32_t*>(file.GetData() + sizeof(LandmarkFileHeader));
+	const float* pCosts = reinterpret_cast<const float*>(pLandmarkNodes + nrOfLandmarks);
+
+	m_LandmarkNodes.assign(pLandmarkNodes, pLandmarkNodes + nrOfLandmarks);
+	m_CostsFrom.assign(pCosts, pCosts + nrOfCosts);
+	if (header.isDirectionalGraph)
+		m_CostsTo.assign(pCosts + nrOfCosts, pCosts + 2 * nrOfCosts);
+	else
+		m_CostsTo.clear();
+
+	m_NrOfNodes = header.nrOfNodes;
+	m_IsDirectionalGraph = header.isDirectionalGraph != 0;
+
+	// A matching fingerprint doesn't make the costs right, wrong ones would make A* miss the shortest paths
+	if (!IsConsistentWith(graph))
+	{
+		*this = Landmarks{};
+		return false;
+	}
+
+	m_Version = graph.GetVersion();
+	m_Fingerprint = header.fingerprint;
+	m_IsBuilt = true;
+	return true;
+}
+
+bool Landmarks::LoadOrBuild(const std::string& path, const GraphCSR& graph, int nrOfLandmarks, ThreadPool* pThreadPool)
+{
+	if (Load(path, graph))
+		return true;
+
+	Build(graph, nrOfLandmarks, pThreadPool);
+	Save(path);
+	return false;
+}
+
+bool Landmarks::IsConsistentWith(const GraphCSR& graph) const
+{
+	const size_t nrOfLandmarks = m_LandmarkNodes.size();
+	std::vector<bool> isLandmark(m_NrOfNodes, false);
+	for (size_t landmark = 0; landmark < nrOfLandmarks; ++landmark)
+	{
+		const int landmarkIdx = m_LandmarkNodes[landmark];
+		if (!graph.IsNodeValid(landmarkIdx) || isLandmark[landmarkIdx])
+			return false;
+
+		isLandmark[landmarkIdx] = true;
+		if (GetCostFromLandmark(int(landmark), landmarkIdx) != 0.f || GetCostToLandmark(int(landmark), landmarkIdx) != 0.f)
+			return false;
+	}
+
+	auto isCostValid = [](float cost) { return cost == FLT_MAX || (cost >= 0.f && cost < FLT_MAX); };
+	if (!std::all_of(m_CostsFrom.begin(), m_CostsFrom.end(), isCostValid) || !std::all_of(m_CostsTo.begin(), m_CostsTo.end(), isCostValid))
+		return false;
+
+	// The searches that made the tables relaxed every connection: following one never gives a lower cost
+	for (int from = 0; from < m_NrOfNodes; ++from)
+	{
+		for (int arc = graph.GetFirstArc(from); arc < graph.GetLastArc(from); ++arc)
+		{
+			const int to = graph.GetArcTarget(arc);
+			const float cost = graph.GetArcCost(arc);
+			for (size_t landmark = 0; landmark < nrOfLandmarks; ++landmark)
+			{
+				const float costFrom = GetCostFromLandmark(int(landmark), from);
+				if (costFrom != FLT_MAX && GetCostFromLandmark(int(landmark), to) > costFrom + cost)
+					return false;
+
+				const float costTo = GetCostToLandmark(int(landmark), to);
+				if (m_IsDirectionalGraph && costTo != FLT_MAX && GetCostToLandmark(int(landmark), from) > cost + costTo)
+					return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+void Landmarks::SelectLandmarks(const GraphCSR& graph, int nrOfLandmarks)
+{
+	m_LandmarkNodes.clear();
+
+	// Connections to the closest landmark, a breadth first search per landmark
+	std::vector<int> hopsToLandmarks(m_NrOfNodes, INT32_MAX);
+	std::vector<int> hops(m_NrOfNodes);
+	std::vector<int> frontier{};
+
+	auto updateHops = [&](int startIdx)
+	{
+		std::fill(hops.begin(), hops.end(), INT32_MAX);
+		hops[startIdx] = 0;
+		frontier.assign(1, startIdx);
+		for (size_t i = 0; i < frontier.size(); ++i)
+		{
+			const int idx = frontier[i];
+			for (int arc = graph.GetFirstArc(idx); arc < graph.GetLastArc(idx); ++arc)
+			{
+				const int neighborIdx = graph.GetArcTarget(arc);
+				if (hops[neighborIdx] == INT32_MAX)
+				{
+					hops[neighborIdx] = hops[idx] + 1;
+					frontier.push_back(neighborIdx);
+				}
+			}
+		}
+
+		for (int idx = 0; idx < m_NrOfNodes; ++idx)
+			hopsToLandmarks[idx] = std::min(hopsToLandmarks[idx], hops[idx]);
+	};
+
+	// The farthest node from any node lies on the edge of the graph, start from there
+	int candidateIdx = invalid_node_index;
+	for (int idx = 0; idx < m_NrOfNodes && candidateIdx == invalid_node_index; ++idx)
+	{
+		if (graph.IsNodeValid(idx))
+			candidateIdx = idx;
+	}
+	if (candidateIdx == invalid_node_index)
+		return;
+
+	updateHops(candidateIdx);
+	for (int idx = 0; idx < m_NrOfNodes; ++idx)
+	{
+		if (hops[idx] != INT32_MAX && hops[idx] > hops[candidateIdx])
+			candidateIdx = idx;
+	}
+	std::fill(hopsToLandmarks.begin(), hopsToLandmarks.end(), INT32_MAX);
+
+	while (int(m_LandmarkNodes.size()) < nrOfLandmarks)
+	{
+		m_LandmarkNodes.push_back(candidateIdx);
+		updateHops(candidateIdx);
+
+		// Farthest from all landmarks so far, nodes no landmark reaches come first
+		candidateIdx = invalid_node_index;
+		for (int idx = 0; idx < m_NrOfNodes; ++idx)
+		{
+			if (graph.IsNodeValid(idx) && hopsToLandmarks[idx] > 0
+				&& (candidateIdx == invalid_node_index || hopsToLandmarks[idx] > hopsToLandmarks[candidateIdx]))
+				candidateIdx = idx;
+		}
+		if (candidateIdx == invalid_node_index)
+			return;
+	}
+}
@@ -0,0 +1,105 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ELandmarks.h: Landmarks for the ALT heuristic (A*, Landmarks, Triangle inequality).
+// For a few landmark nodes the cost from and to every node is precomputed. By the triangle inequality
+// cost(n, t) >= cost(L, t) - cost(L, n) and cost(n, t) >= cost(n, L) - cost(t, L), the largest of these
+// over all landmarks is a lower bound that knows about walls and detours, unlike the straight line distance.
+// Landmarks are picked farthest apart from each other (in connections), the costs take a Dijkstra search per landmark.
+// The tables can be saved next to the graph file, a file only loads for the graph it was built for.
+/*=============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+#include "framework\EliteHelpers\EThreadPool.h"
+
+namespace Elite
+{
+	const uint32_t LANDMARK_FILE_MAGIC{ 0x4B4D4C45 }; // "ELMK"
+	const uint32_t LANDMARK_FILE_VERSION{ 1 };
+
+	class Landmarks final
+	{
+	public:
+		Landmarks() = default;
+
+		// The Dijkstra searches of the landmarks run in parallel when there is a thread pool
+		void Build(const GraphCSR& graph, int nrOfLandmarks, ThreadPool* pThreadPool = nullptr);
+
+		bool Save(const std::string& path) const;
+		// Fails if the file doesn't exist, isn't a landmark file, was built for another graph or its costs don't fit the graph
+		bool Load(const std::string& path, const GraphCSR& graph);
+		// Loads the file, or builds the landmarks and saves them there when the file can't be loaded. Returns whether it was loaded
+		bool LoadOrBuild(const std::string& path, const GraphCSR& graph, int nrOfLandmarks, ThreadPool* pThreadPool = nullptr);
+
+		// Only a lower bound while the graph is the one it was built for
+		bool IsBuiltFor(const GraphCSR& graph) const { return m_IsBuilt && graph.GetVersion() == m_Version && graph.GetNrOfNodes() == m_NrOfNodes; }
+
+		int GetNrOfLandmarks() const { return int(m_LandmarkNodes.size()); }
+		const std::vector<int>& GetLandmarkNodes() const { return m_LandmarkNodes; }
+		int GetNrOfNodes() const { return m_NrOfNodes; }
+
+		// FLT_MAX if there is no path
+		float GetCostFromLandmark(int landmark, int idx) const { return m_CostsFrom[size_t(idx) * m_LandmarkNodes.size() + landmark]; }
+		float GetCostToLandmark(int landmark, int idx) const { return (m_IsDirectionalGraph ? m_CostsTo : m_CostsFrom)[size_t(idx) * m_LandmarkNodes.size() + landmark]; }
+
+		// Lower bound on the cost from one node to another
+		float GetLowerBound(int fromIdx, int toIdx) const;
+
+	private:
+		// Costs per node, the costs of the landmarks of a node are next to each other: [idx * nrOfLandmarks + landmark]
+		std::vector<int> m_LandmarkNodes;
+		std::vector<float> m_CostsFrom;
+		std::vector<float> m_CostsTo; // only for directional graphs, the same as m_CostsFrom otherwise
+
+		int m_NrOfNodes = 0;
+		bool m_IsDirectionalGraph = false;
+		bool m_IsBuilt = false;
+		unsigned int m_Version = 0;
+		// Identifies the graph in the file, versions only count while the graph is alive
+		uint32_t m_Fingerprint = 0;
+
+		void SelectLandmarks(const GraphCSR& graph, int nrOfLandmarks);
+		// Checks the tables read from a file: distinct valid landmarks at cost 0 from themselves, and no connection
+		// of the graph that leads to a cheaper cost than the table has, which keeps the bounds admissible
+		bool IsConsistentWith(const GraphCSR& graph) const;
+	};
+
+	inline float Landmarks::GetLowerBound(int fromIdx, int toIdx) const
+	{
+		const size_t nrOfLandmarks = m_LandmarkNodes.size();
+		if (nrOfLandmarks == 0)
+			return 0.f;
+
+		const float* pFrom = &m_CostsFrom[size_t(fromIdx) * nrOfLandmarks];
+		const float* pTo = &m_CostsFrom[size_t(toIdx) * nrOfLandmarks];
+
+		float lowerBound = 0.f;
+		for (size_t landmark = 0; landmark < nrOfLandmarks; ++landmark)
+		{
+			// Skip landmarks that can't reach both nodes
+			if (pFrom[landmark] == FLT_MAX || pTo[landmark] == FLT_MAX)
+				continue;
+
+			lowerBound = std::max(lowerBound, pTo[landmark] - pFrom[landmark]);
+			if (!m_IsDirectionalGraph)
+				lowerBound = std::max(lowerBound, pFrom[landmark] - pTo[landmark]);
+		}
+
+		if (!m_IsDirectionalGraph)
+			return lowerBound;
+
+		pFrom = &m_CostsTo[size_t(fromIdx) * nrOfLandmarks];
+		pTo = &m_CostsTo[size_t(toIdx) * nrOfLandmarks];
+		for (size_t landmark = 0; landmark < nrOfLandmarks; ++landmark)
+		{
+			if (pFrom[landmark] == FLT_MAX || pTo[landmark] == FLT_MAX)
+				continue;
+
+			lowerBound = std::max(lowerBound, pFrom[landmark] - pTo[landmark]);
+		}
+		return lowerBound;
+	}
+}
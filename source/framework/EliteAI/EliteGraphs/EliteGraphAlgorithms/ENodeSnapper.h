@@ -0,0 +1,152 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ENodeSnapper.h: Maps any world position to the nearest node of a graph, to start and end path requests at.
+// Unlike GetNodeIdxAtWorldPos it always finds a node, also outside a grid or away from the nodes of a Graph2D.
+// The nodes are kept in a k-d tree (see EGraphKdTree.h) over their world positions, rebuilt only when a node
+// was added, removed or moved: the snapper listens to the graph (see IGraphListener) and only checks the positions
+// of the nodes it was told about, so adding connections or changing their costs every frame doesn't cost a rebuild.
+// Passing component ids (see GraphAnalytics::GetComponentIds) restricts the result to the nodes of one
+// component, e.g. the nearest node an agent can actually reach.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteGraphs\EGraphKdTree.h"
+
+namespace Elite
+{
+	// The graph has to outlive the snapper
+	template <class T_NodeType, class T_ConnectionType>
+	class NodeSnapper final : public IGraphListener
+	{
+	public:
+		explicit NodeSnapper(IGraph<T_NodeType, T_ConnectionType>* pGraph);
+		~NodeSnapper();
+
+		// Nearest valid node, invalid_node_index when the graph has none (or none within maxDistance)
+		int GetNearestNodeIdx(const Vector2& pos, float maxDistance = FLT_MAX) const;
+		T_NodeType* GetNearestNode(const Vector2& pos, float maxDistance = FLT_MAX) const;
+
+		// Nearest node with componentIds[idx] == componentId, the ids have to be up to date with the graph
+		int GetNearestNodeIdx(const Vector2& pos, const std::vector<int>& componentIds, int componentId, float maxDistance = FLT_MAX) const;
+
+		// IGraphListener
+		void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) override;
+		void OnNodeModified(int idx) override;
+		void OnGraphCleared() override { m_AreNodesChanged = true; }
+		void OnNodesRemapped(const std::vector<int>& newIndices) override { m_AreNodesChanged = true; }
+
+		//C++ make the class non-copyable
+		NodeSnapper(const NodeSnapper&) = delete;
+		NodeSnapper& operator=(const NodeSnapper&) = delete;
+
+	private:
+		void UpdateTree() const;
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+
+		// Tree with the positions and nodes it was built from
+		mutable GraphKdTree m_Tree;
+		mutable std::vector<Vector2> m_Positions;
+		mutable std::vector<int> m_Indices;
+		mutable bool m_IsTreeBuilt = false;
+
+		// Changes since the tree was built: nodes were added or removed, or the nodes that may have moved
+		// (past one per node of the tree all positions are compared instead)
+		mutable bool m_AreNodesChanged = false;
+		mutable std::vector<int> m_ModifiedNodes;
+		mutable bool m_AreAllNodesModified = false;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline NodeSnapper<T_NodeType, T_ConnectionType>::NodeSnapper(IGraph<T_NodeType, T_ConnectionType>* pGraph)
+		: m_pGraph(pGraph)
+	{
+		m_pGraph->AddListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline NodeSnapper<T_NodeType, T_ConnectionType>::~NodeSnapper()
+	{
+		m_pGraph->RemoveListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline int NodeSnapper<T_NodeType, T_ConnectionType>::GetNearestNodeIdx(const Vector2& pos, float maxDistance) const
+	{
+		UpdateTree();
+		return m_Tree.FindNearest(pos, maxDistance);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline T_NodeType* NodeSnapper<T_NodeType, T_ConnectionType>::GetNearestNode(const Vector2& pos, float maxDistance) const
+	{
+		const int idx = GetNearestNodeIdx(pos, maxDistance);
+		return idx != invalid_node_index ? m_pGraph->GetNode(idx) : nullptr;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline int NodeSnapper<T_NodeType, T_ConnectionType>::GetNearestNodeIdx(const Vector2& pos, const std::vector<int>& componentIds, int componentId, float maxDistance) const
+	{
+		UpdateTree();
+		return m_Tree.FindNearest(pos, [&componentIds, componentId](int idx)
+		{
+			return idx < int(componentIds.size()) && componentIds[idx] == componentId;
+		}, maxDistance);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void NodeSnapper<T_NodeType, T_ConnectionType>::OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged)
+	{
+		if (nrOfNodesChanged)
+			m_AreNodesChanged = true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void NodeSnapper<T_NodeType, T_ConnectionType>::OnNodeModified(int idx)
+	{
+		if (m_AreAllNodesModified)
+			return;
+
+		m_ModifiedNodes.push_back(idx);
+		if (m_ModifiedNodes.size() > m_Indices.size())
+		{
+			m_ModifiedNodes.clear();
+			m_AreAllNodesModified = true;
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void NodeSnapper<T_NodeType, T_ConnectionType>::UpdateTree() const
+	{
+		const int nrOfNodes = m_pGraph->GetNrOfNodes();
+		bool isChanged = !m_IsTreeBuilt || m_AreNodesChanged || nrOfNodes != int(m_Positions.size());
+
+		// Same nodes, only rebuilt if one of them moved
+		auto isMoved = [this](int idx) { return m_pGraph->IsNodeValid(idx) && m_pGraph->GetNodeWorldPos(idx) != m_Positions[idx]; };
+		if (!isChanged && m_AreAllNodesModified)
+			isChanged = std::any_of(m_Indices.begin(), m_Indices.end(), isMoved);
+		else if (!isChanged)
+			isChanged = std::any_of(m_ModifiedNodes.begin(), m_ModifiedNodes.end(), isMoved);
+
+		m_ModifiedNodes.clear();
+		m_AreAllNodesModified = false;
+		if (!isChanged)
+			return;
+
+		m_Positions.resize(nrOfNodes);
+		m_Indices.clear();
+		for (int idx = 0; idx < nrOfNodes; ++idx)
+		{
+			if (!m_pGraph->IsNodeValid(idx))
+				continue;
+
+			m_Positions[idx] = m_pGraph->GetNodeWorldPos(idx);
+			m_Indices.push_back(idx);
+		}
+		m_Tree.Build(m_Indices, m_Positions);
+
+		m_AreNodesChanged = false;
+		m_IsTreeBuilt = true;
+	}
+}
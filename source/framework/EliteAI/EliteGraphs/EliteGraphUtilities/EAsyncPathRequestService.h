@@ -0,0 +1,386 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EAsyncPathRequestService.h: Path requests searched on worker threads.
+// Every search runs on an immutable CSR snapshot of the graph, shared between the searches that started
+// while the graph stayed the same, so the graph itself can keep changing on the main thread.
+// Finished searches go through a lock-free queue that Update empties on the main thread (call it from
+// IApp::Update). A result found on a snapshot that is out of date by then is handed out flagged as outdated when
+// only costs changed, and searched again when connections were added or removed (a few times at most, so a graph
+// that keeps changing doesn't starve the request).
+// The service listens to the graph: a request to or from a removed node fails, and Compact remaps the requests.
+/*=============================================================================*/
+#pragma once
+#include <memory>
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAStar.h"
+#include "framework\EliteHelpers\EMPSCQueue.h"
+#include "framework\EliteHelpers\EThreadPool.h"
+
+namespace Elite
+{
+	struct AsyncPathRequestStatistics
+	{
+		int nrOfRequests = 0;
+		int nrOfFoundPaths = 0;
+		int nrOfFailedRequests = 0;
+		// replaced by a new request of the same requester or cancelled before they were done
+		int nrOfCancelledRequests = 0;
+		// searched again because connections were added or removed while searching
+		int nrOfOutdatedResults = 0;
+		// handed out flagged as outdated: costs changed while searching, or the retries ran out
+		int nrOfOutdatedPaths = 0;
+		int nrOfSnapshots = 0;
+
+		// time between the request and the callback, in milliseconds
+		float averageLatency = 0.f;
+		float maxLatency = 0.f;
+	};
+
+	// The thread pool has to outlive the service
+	template <class T_NodeType, class T_ConnectionType>
+	class AsyncPathRequestService final : public IGraphListener
+	{
+	public:
+		struct PathResult
+		{
+			int requesterId;
+			// empty if there is no path
+			std::vector<T_NodeType*> path;
+			float cost;
+			// found on an older version of the graph, the path still exists but can be more expensive than the cost
+			bool isOutdated;
+		};
+		typedef std::function<void(const PathResult&)> PathCallback;
+
+		AsyncPathRequestService(IGraph<T_NodeType, T_ConnectionType>* pGraph, ThreadPool* pThreadPool, Heuristic hFunction = HeuristicFunctions::Euclidean);
+		// Waits for the searches that are still running
+		~AsyncPathRequestService();
+
+		// The callback is called from Update, a new request of the same requester replaces the previous one
+		void RequestPath(int requesterId, T_NodeType* pStartNode, T_NodeType* pGoalNode, PathCallback callback);
+		void CancelRequest(int requesterId);
+		bool HasRequest(int requesterId) const { return m_Requests.find(requesterId) != m_Requests.end(); }
+
+		// Main thread: calls the callbacks of the finished searches
+		void Update();
+
+		int GetNrOfSearchesInFlight() const { return m_NrOfSearchesInFlight.load(); }
+		// Times a request is searched again after connections changed, before its path is handed out outdated
+		void SetMaxNrOfRetries(int maxNrOfRetries) { m_MaxNrOfRetries = maxNrOfRetries; }
+		int GetMaxNrOfRetries() const { return m_MaxNrOfRetries; }
+		const AsyncPathRequestStatistics& GetStatistics() const { return m_Statistics; }
+		void ResetStatistics() { m_Statistics = AsyncPathRequestStatistics{}; }
+		// Adds the statistics to the current ImGui window
+		void RenderStatistics() const;
+
+		// IGraphListener
+		virtual void OnNodeModified(int idx) override;
+		virtual void OnGraphCleared() override;
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override;
+
+		//C++ make the class non-copyable
+		AsyncPathRequestService(const AsyncPathRequestService&) = delete;
+		AsyncPathRequestService& operator=(const AsyncPathRequestService&) = delete;
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Request
+		{
+			int startIdx;
+			int goalIdx;
+			unsigned int sequence;
+			Clock::time_point requestTime;
+			PathCallback callback;
+			int nrOfRetries;
+			// Compact changed the indices after the search started, its path means nothing anymore
+			bool isRemapped;
+		};
+
+		// Only what the worker found, node pointers are looked up on the main thread
+		struct SearchResult
+		{
+			int requesterId;
+			unsigned int sequence;
+			unsigned int version;
+			unsigned int topologyVersion;
+			std::vector<int> path;
+			float cost;
+		};
+
+		const std::shared_ptr<const GraphCSR>& GetSnapshot();
+		void StartSearch(int requesterId, Request& request);
+		void FinishRequest(const SearchResult& result, bool isOutdated);
+		// Every connection on the path is still in the graph
+		bool IsPathValid(const std::vector<int>& path) const;
+		// Changes the start and goal of every request, searches in flight are searched again once they come in
+		template<typename T_Func>
+		void RemapRequests(T_Func remap);
+
+		std::unique_ptr<AStarSearch> AcquireSearch();
+		void ReleaseSearch(std::unique_ptr<AStarSearch> pSearch);
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		ThreadPool* m_pThreadPool;
+		Heuristic m_HeuristicFunction;
+		int m_MaxNrOfRetries = 3;
+
+		// Main thread only
+		std::shared_ptr<const GraphCSR> m_pSnapshot;
+		std::unordered_map<int, Request> m_Requests;
+		unsigned int m_NextSequence = 0;
+		AsyncPathRequestStatistics m_Statistics;
+		float m_TotalLatency = 0.f;
+
+		// Shared with the workers
+		MPSCQueue<SearchResult> m_Results;
+		std::atomic<int> m_NrOfSearchesInFlight{ 0 };
+		// Notified when the last search in flight is done, for the destructor
+		std::mutex m_InFlightMutex;
+		std::condition_variable m_NoSearchesInFlight;
+		std::vector<std::unique_ptr<AStarSearch>> m_Searches;
+		std::mutex m_SearchesMutex;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline AsyncPathRequestService<T_NodeType, T_ConnectionType>::AsyncPathRequestService(IGraph<T_NodeType, T_ConnectionType>* pGraph, ThreadPool* pThreadPool, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_pThreadPool(pThreadPool)
+		, m_HeuristicFunction(hFunction)
+	{
+		m_pGraph->AddListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline AsyncPathRequestService<T_NodeType, T_ConnectionType>::~AsyncPathRequestService()
+	{
+		m_pGraph->RemoveListener(this);
+
+		// the searches still use the queue and the searches of this service
+		std::unique_lock<std::mutex> lock(m_InFlightMutex);
+		m_NoSearchesInFlight.wait(lock, [this]() { return m_NrOfSearchesInFlight.load() == 0; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::RequestPath(int requesterId, T_NodeType* pStartNode, T_NodeType* pGoalNode, PathCallback callback)
+	{
+		const int startIdx = pStartNode ? pStartNode->GetIndex() : invalid_node_index;
+		const int goalIdx = pGoalNode ? pGoalNode->GetIndex() : invalid_node_index;
+		++m_Statistics.nrOfRequests;
+
+		auto foundIt = m_Requests.find(requesterId);
+		if (foundIt != m_Requests.end())
+		{
+			// Same path as the one being searched, wait for that one
+			if (foundIt->second.startIdx == startIdx && foundIt->second.goalIdx == goalIdx)
+			{
+				foundIt->second.callback = std::move(callback);
+				return;
+			}
+
+			// the result of the running search is ignored once it comes in
+			++m_Statistics.nrOfCancelledRequests;
+		}
+
+		Request& request = m_Requests[requesterId];
+		request = Request{ startIdx, goalIdx, m_NextSequence++, Clock::now(), std::move(callback), 0, false };
+		StartSearch(requesterId, request);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::CancelRequest(int requesterId)
+	{
+		if (m_Requests.erase(requesterId) > 0)
+			++m_Statistics.nrOfCancelledRequests;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::Update()
+	{
+		m_Results.PopAll([this](const SearchResult& result)
+		{
+			// Replaced or cancelled while searching
+			auto foundIt = m_Requests.find(result.requesterId);
+			if (foundIt == m_Requests.end() || foundIt->second.sequence != result.sequence)
+				return;
+
+			// The path could go through connections that are gone, or miss new ones
+			Request& request = foundIt->second;
+			const bool isTopologyChanged = result.topologyVersion != m_pGraph->GetTopologyVersion();
+			if (request.isRemapped || (isTopologyChanged && request.nrOfRetries < m_MaxNrOfRetries))
+			{
+				++m_Statistics.nrOfOutdatedResults;
+				if (!request.isRemapped)
+					++request.nrOfRetries;
+				StartSearch(result.requesterId, request);
+				return;
+			}
+
+			// Only costs changed, or out of retries: still a path as long as its connections are there
+			if (isTopologyChanged && !IsPathValid(result.path))
+			{
+				FinishRequest(SearchResult{ result.requesterId, result.sequence, result.version, result.topologyVersion, {}, 0.f }, true);
+				return;
+			}
+
+			FinishRequest(result, result.version != m_pGraph->GetVersion());
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::RenderStatistics() const
+	{
+		ImGui::Text("Async path requests");
+		ImGui::Indent();
+		ImGui::Text("In flight: %d", GetNrOfSearchesInFlight());
+		ImGui::Text("Requests: %d", m_Statistics.nrOfRequests);
+		ImGui::Text("Found: %d", m_Statistics.nrOfFoundPaths);
+		ImGui::Text("Failed: %d", m_Statistics.nrOfFailedRequests);
+		ImGui::Text("Cancelled: %d", m_Statistics.nrOfCancelledRequests);
+		ImGui::Text("Outdated: %d (handed out %d)", m_Statistics.nrOfOutdatedResults, m_Statistics.nrOfOutdatedPaths);
+		ImGui::Text("Snapshots: %d", m_Statistics.nrOfSnapshots);
+		ImGui::Text("Latency: %.2f ms (max %.2f)", m_Statistics.averageLatency, m_Statistics.maxLatency);
+		ImGui::Unindent();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline const std::shared_ptr<const GraphCSR>& AsyncPathRequestService<T_NodeType, T_ConnectionType>::GetSnapshot()
+	{
+		// Searches still running keep their own snapshot alive
+		if (!m_pSnapshot || m_pSnapshot->GetVersion() != m_pGraph->GetVersion())
+		{
+			m_pSnapshot = std::make_shared<const GraphCSR>(*m_pGraph);
+			++m_Statistics.nrOfSnapshots;
+		}
+		return m_pSnapshot;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::StartSearch(int requesterId, Request& request)
+	{
+		request.isRemapped = false;
+		std::shared_ptr<const GraphCSR> pSnapshot = GetSnapshot();
+		const int startIdx = request.startIdx;
+		const int goalIdx = request.goalIdx;
+		const unsigned int sequence = request.sequence;
+
+		++m_NrOfSearchesInFlight;
+		m_pThreadPool->Enqueue([this, pSnapshot, requesterId, startIdx, goalIdx, sequence]()
+		{
+			std::unique_ptr<AStarSearch> pSearch = AcquireSearch();
+
+			const Vector2 goalPos = pSnapshot->IsNodeValid(goalIdx) ? pSnapshot->GetNodePos(goalIdx) : Vector2{};
+			pSearch->Begin(pSnapshot.get(), { PathEndpoint{ startIdx, 0.f } }, { PathEndpoint{ goalIdx, 0.f } }, goalPos);
+			pSearch->Continue((std::numeric_limits<int>::max)());
+			m_Results.Push(SearchResult{ requesterId, sequence, pSnapshot->GetVersion(), pSnapshot->GetTopologyVersion(), pSearch->GetPath(), pSearch->GetPathCost() });
+
+			ReleaseSearch(std::move(pSearch));
+
+			// Notified under the lock, the destructor can't finish in between
+			std::lock_guard<std::mutex> lock(m_InFlightMutex);
+			if (--m_NrOfSearchesInFlight == 0)
+				m_NoSearchesInFlight.notify_all();
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::FinishRequest(const SearchResult& result, bool isOutdated)
+	{
+		auto foundIt = m_Requests.find(result.requesterId);
+		Request request = std::move(foundIt->second);
+		m_Requests.erase(foundIt);
+
+		if (result.path.empty())
+			++m_Statistics.nrOfFailedRequests;
+		else
+			++m_Statistics.nrOfFoundPaths;
+		if (isOutdated && !result.path.empty())
+			++m_Statistics.nrOfOutdatedPaths;
+
+		const float latency = std::chrono::duration<float, std::milli>(Clock::now() - request.requestTime).count();
+		m_TotalLatency += latency;
+		m_Statistics.averageLatency = m_TotalLatency / float(m_Statistics.nrOfFoundPaths + m_Statistics.nrOfFailedRequests);
+		m_Statistics.maxLatency = std::max(m_Statistics.maxLatency, latency);
+
+		if (!request.callback)
+			return;
+
+		// Update checked that every node on the path exists
+		PathResult pathResult{ result.requesterId, {}, result.cost, isOutdated && !result.path.empty() };
+		pathResult.path.reserve(result.path.size());
+		for (int idx : result.path)
+			pathResult.path.push_back(m_pGraph->GetNode(idx));
+		request.callback(pathResult);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool AsyncPathRequestService<T_NodeType, T_ConnectionType>::IsPathValid(const std::vector<int>& path) const
+	{
+		for (size_t i = 0; i < path.size(); ++i)
+		{
+			if (!m_pGraph->IsNodeValid(path[i]) || (i > 0 && !m_pGraph->GetConnection(path[i - 1], path[i])))
+				return false;
+		}
+		return true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline std::unique_ptr<AStarSearch> AsyncPathRequestService<T_NodeType, T_ConnectionType>::AcquireSearch()
+	{
+		// Searches keep their memory between requests, one per worker at most
+		{
+			std::lock_guard<std::mutex> lock(m_SearchesMutex);
+			if (!m_Searches.empty())
+			{
+				std::unique_ptr<AStarSearch> pSearch = std::move(m_Searches.back());
+				m_Searches.pop_back();
+				return pSearch;
+			}
+		}
+		return std::unique_ptr<AStarSearch>(new AStarSearch(m_HeuristicFunction));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::ReleaseSearch(std::unique_ptr<AStarSearch> pSearch)
+	{
+		std::lock_guard<std::mutex> lock(m_SearchesMutex);
+		m_Searches.push_back(std::move(pSearch));
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::OnNodeModified(int idx)
+	{
+		// Only removed nodes matter, a node added in the same slot later is another node
+		if (m_pGraph->IsNodeValid(idx))
+			return;
+
+		RemapRequests([idx](int requestIdx) { return requestIdx == idx ? invalid_node_index : requestIdx; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::OnGraphCleared()
+	{
+		RemapRequests([](int) { return invalid_node_index; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::OnNodesRemapped(const std::vector<int>& newIndices)
+	{
+		RemapRequests([&newIndices](int requestIdx) { return GetRemappedNodeIndex(newIndices, requestIdx); });
+
+		// The searches in flight return old indices, Update searches them again
+		for (auto& requestPair : m_Requests)
+			requestPair.second.isRemapped = true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	template <typename T_Func>
+	inline void AsyncPathRequestService<T_NodeType, T_ConnectionType>::RemapRequests(T_Func remap)
+	{
+		for (auto& requestPair : m_Requests)
+		{
+			requestPair.second.startIdx = remap(requestPair.second.startIdx);
+			requestPair.second.goalIdx = remap(requestPair.second.goalIdx);
+		}
+	}
+}
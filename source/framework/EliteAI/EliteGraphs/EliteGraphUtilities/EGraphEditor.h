@@ -4,6 +4,7 @@
 #include "framework\EliteAI\EliteGraphs\EGraphConnectionTypes.h"
 #include "framework\EliteAI\EliteGraphs\EGridGraph.h"
 #include "framework\EliteAI\EliteGraphs\EGraph2D.h"
+#include "framework\EliteAI\EliteGraphs\EImplicitGridGraph.h"
 
 namespace Elite
 {
@@ -17,11 +18,14 @@ namespace Elite
 		bool UpdateGraph(Graph2D<T_NodeType, T_ConnectionType>* pGraph);
 
 		bool UpdateGraph(GridGraph<GridTerrainNode, GraphConnection>* pGraph);
+		bool UpdateGraph(ImplicitGridGraph* pGraph);
 
 		template <class T_NodeType, class T_ConnectionType>
 		bool UpdateGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph);
 
 	private:
+		void UpdateTerrainUI();
+
 		int m_SelectedNodeIdx = -1;
 		int m_SelectedTerrainType = (int)TerrainType::Ground;
 
@@ -56,7 +60,7 @@ namespace Elite
 				{
 					if (pGraph->IsUniqueConnection(m_SelectedNodeIdx, clickedIdx))
 					{
-						pGraph->AddConnection(new T_ConnectionType(m_SelectedNodeIdx, clickedIdx));
+						pGraph->AddConnection(pGraph->AllocateConnection(m_SelectedNodeIdx, clickedIdx));
 						hasGraphChanged = true;
 					}
 				}
@@ -69,7 +73,7 @@ namespace Elite
 			}
 			else
 			{
-				pGraph->AddNode(new T_NodeType(pGraph->GetNextFreeNodeIndex(), m_MousePos));
+				pGraph->AddNode(pGraph->AllocateNode(pGraph->GetNextFreeNodeIndex(), m_MousePos));
 				hasGraphChanged = true;
 			}
 		}
@@ -94,6 +98,10 @@ namespace Elite
 			}
 		}
 
+		// The selected node can disappear when the graph is replaced (e.g. loaded from a file)
+		if (m_SelectedNodeIdx != invalid_node_index && !pGraph->IsNodeValid(m_SelectedNodeIdx))
+			m_SelectedNodeIdx = invalid_node_index;
+
 		// Update pNode, edge and debug drawing positions
 		if (m_SelectedNodeIdx != invalid_node_index)
 		{
@@ -101,7 +109,7 @@ namespace Elite
 			if (m_IsLeftMouseBtnPressed)
 			{
 				DEBUGRENDERER2D->DrawCircle(nodePos, pGraph->GetNodeRadius(pGraph->GetNode(m_SelectedNodeIdx)), { 1,1,1 }, -1);
-				pGraph->GetNode(m_SelectedNodeIdx)->SetPosition(m_MousePos);
+				pGraph->SetNodePosition(m_SelectedNodeIdx, m_MousePos);
 				hasGraphChanged = true;
 			}
 
@@ -0,0 +1,284 @@
+#include "stdafx.h"
+#include "EGraphFile.h"
+
+using namespace Elite;
+
+namespace
+{
+	// Byte offsets of the sections, derived from the header only
+	// 64-bit, so the counts of a corrupt header can't wrap around in a 32-bit build
+	struct GraphFileLayout
+	{
+		uint64_t positions;
+		uint64_t isValid;
+		uint64_t terrain;
+		uint64_t offsets;
+		uint64_t targets;
+		uint64_t costs;
+		uint64_t size;
+	};
+
+	uint64_t AlignSection(uint64_t offset)
+	{
+		return (offset + 3) & ~uint64_t(3);
+	}
+
+	GraphFileLayout GetLayout(const GraphFileHeader& header)
+	{
+		const uint64_t nrOfNodes = uint64_t(header.nrOfNodes);
+		const uint64_t nrOfArcs = uint64_t(header.nrOfArcs);
+
+		GraphFileLayout layout{};
+		layout.positions = AlignSection(sizeof(GraphFileHeader));
+		layout.isValid = AlignSection(layout.positions + nrOfNodes * sizeof(Vector2));
+		layout.terrain = AlignSection(layout.isValid + nrOfNodes * sizeof(uint8_t));
+		layout.offsets = AlignSection(layout.terrain + ((header.flags & GRAPH_FILE_HAS_TERRAIN) ? nrOfNodes * sizeof(TerrainType) : 0));
+		layout.targets = AlignSection(layout.offsets + (nrOfNodes + 1) * sizeof(int32_t));
+		layout.costs = AlignSection(layout.targets + nrOfArcs * sizeof(int32_t));
+		layout.size = layout.costs + nrOfArcs * sizeof(float);
+		return layout;
+	}
+
+	void WritePadding(std::ofstream& file, uint64_t sectionOffset)
+	{
+		const char zeros[4]{};
+		const uint64_t position = uint64_t(file.tellp());
+		if (sectionOffset > position)
+			file.write(zeros, std::streamsize(sectionOffset - position));
+	}
+}
+
+bool GraphFileView::Open(const std::string& path)
+{
+	Close();
+
+	if (!m_File.Open(path) || m_File.GetSize() < sizeof(GraphFileHeader))
+	{
+		Close();
+		return false;
+	}
+
+	const uint8_t* pData = m_File.GetData();
+	m_pHeader = reinterpret_cast<const GraphFileHeader*>(pData);
+
+	if (m_pHeader->magic != GRAPH_FILE_MAGIC || m_pHeader->version != GRAPH_FILE_VERSION
+		|| m_pHeader->nrOfNodes < 0 || m_pHeader->nrOfArcs < 0)
+	{
+		Close();
+		return false;
+	}
+
+	const GraphFileLayout layout = GetLayout(*m_pHeader);
+	if (m_File.GetSize() < layout.size)
+	{
+		Close();
+		return false;
+	}
+
+	// Everything points straight into the mapped file, the size check above keeps the offsets within size_t
+	m_pPositions = reinterpret_cast<const Vector2*>(pData + size_t(layout.positions));
+	m_pIsValid = pData + size_t(layout.isValid);
+	m_pTerrain = (m_pHeader->flags & GRAPH_FILE_HAS_TERRAIN) ? reinterpret_cast<const TerrainType*>(pData + size_t(layout.terrain)) : nullptr;
+	m_pOffsets = reinterpret_cast<const int32_t*>(pData + size_t(layout.offsets));
+	m_pTargets = reinterpret_cast<const int32_t*>(pData + size_t(layout.targets));
+	m_pCosts = reinterpret_cast<const float*>(pData + size_t(layout.costs));
+
+	// The accessors and LoadGraphFile index with the offsets and targets without checking them
+	if (!IsAdjacencyValid())
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+bool GraphFileView::IsAdjacencyValid() const
+{
+	const int nrOfNodes = m_pHeader->nrOfNodes;
+	if (m_pOffsets[0] != 0 || m_pOffsets[nrOfNodes] != m_pHeader->nrOfArcs)
+		return false;
+
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		// Also keeps every offset within [0, nrOfArcs]
+		if (m_pOffsets[idx + 1] < m_pOffsets[idx])
+			return false;
+
+		// A removed node has no arcs, and no arc goes to one
+		if (!m_pIsValid[idx] && m_pOffsets[idx + 1] != m_pOffsets[idx])
+			return false;
+
+		for (int arc = m_pOffsets[idx]; arc < m_pOffsets[idx + 1]; ++arc)
+		{
+			const int target = m_pTargets[arc];
+			if (target < 0 || target >= nrOfNodes || !m_pIsValid[target])
+				return false;
+		}
+	}
+	return true;
+}
+
+void GraphFileView::Close()
+{
+	m_File.Close();
+
+	m_pHeader = nullptr;
+	m_pPositions = nullptr;
+	m_pIsValid = nullptr;
+	m_pTerrain = nullptr;
+	m_pOffsets = nullptr;
+	m_pTargets = nullptr;
+	m_pCosts = nullptr;
+}
+
+bool Elite::WriteGraphFile(const std::string& path, const GraphCSR& graph, const GraphFileHeader* pGridHeader, const std::vector<TerrainType>* pTerrain)
+{
+	GraphFileHeader header{};
+	if (pGridHeader)
+		header = *pGridHeader;
+
+	header.magic = GRAPH_FILE_MAGIC;
+	header.version = GRAPH_FILE_VERSION;
+	header.nrOfNodes = graph.GetNrOfNodes();
+	header.nrOfArcs = graph.GetNrOfArcs();
+	if (graph.IsDirectionalGraph())
+		header.flags |= GRAPH_FILE_DIRECTIONAL;
+	if (pTerrain)
+		header.flags |= GRAPH_FILE_HAS_TERRAIN;
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+
+	const GraphFileLayout layout = GetLayout(header);
+	const int nrOfNodes = graph.GetNrOfNodes();
+
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	WritePadding(file, layout.positions);
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		const Vector2 pos = graph.GetNodePos(idx);
+		file.write(reinterpret_cast<const char*>(&pos), sizeof(pos));
+	}
+
+	WritePadding(file, layout.isValid);
+	for (int idx = 0; idx < nrOfNodes; ++idx)
+	{
+		const uint8_t isValid = graph.IsNodeValid(idx) ? 1 : 0;
+		file.write(reinterpret_cast<const char*>(&isValid), sizeof(isValid));
+	}
+
+	if (pTerrain)
+	{
+		WritePadding(file, layout.terrain);
+		file.write(reinterpret_cast<const char*>(pTerrain->data()), std::streamsize(pTerrain->size() * sizeof(TerrainType)));
+	}
+
+	WritePadding(file, layout.offsets);
+	for (int idx = 0; idx <= nrOfNodes; ++idx)
+	{
+		const int32_t offset = idx < nrOfNodes ? graph.GetFirstArc(idx) : graph.GetNrOfArcs();
+		file.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+	}
+
+	WritePadding(file, layout.targets);
+	for (int arc = 0; arc < graph.GetNrOfArcs(); ++arc)
+	{
+		const int32_t target = graph.GetArcTarget(arc);
+		file.write(reinterpret_cast<const char*>(&target), sizeof(target));
+	}
+
+	WritePadding(file, layout.costs);
+	for (int arc = 0; arc < graph.GetNrOfArcs(); ++arc)
+	{
+		const float cost = graph.GetArcCost(arc);
+		file.write(reinterpret_cast<const char*>(&cost), sizeof(cost));
+	}
+
+	return bool(file);
+}
+
+bool Elite::WriteGraphFile(const std::string& path, const GridGraph<GridTerrainNode, GraphConnection>& graph)
+{
+	GraphFileHeader gridHeader{};
+	gridHeader.flags = GRAPH_FILE_GRID | (graph.IsConnectedDiagonally() ? GRAPH_FILE_CONNECTED_DIAGONALLY : 0);
+	gridHeader.columns = graph.GetColumns();
+	gridHeader.rows = graph.GetRows();
+	gridHeader.cellSize = graph.GetCellSize();
+	gridHeader.costStraight = graph.GetDefaultCostStraight();
+	gridHeader.costDiagonal = graph.GetDefaultCostDiagonal();
+
+	std::vector<TerrainType> terrain(graph.GetNrOfNodes());
+	for (int idx = 0; idx < graph.GetNrOfNodes(); ++idx)
+		terrain[idx] = graph.GetNode(idx)->GetTerrainType();
+
+	return WriteGraphFile(path, GraphCSR(graph), &gridHeader, &terrain);
+}
+
+bool Elite::LoadGraphFile(const GraphFileView& file, GridGraph<GridTerrainNode, GraphConnection>* pGraph)
+{
+	if (!file.IsOpen() || !file.IsGridGraph() || file.IsDirectionalGraph() != pGraph->IsDirectionalGraph())
+		return false;
+
+	// In 64-bit, the product of two corrupt counts can't wrap around to the number of nodes
+	const GraphFileHeader& header = file.GetHeader();
+	if (header.columns <= 0 || header.rows <= 0 || int64_t(header.columns) * int64_t(header.rows) != int64_t(file.GetNrOfNodes()))
+		return false;
+
+	// The connections of the file are used instead of generated ones, they include the edits made after generating
+	pGraph->InitializeGrid(header.columns, header.rows, header.cellSize, (header.flags & GRAPH_FILE_CONNECTED_DIAGONALLY) != 0,
+		header.costStraight, header.costDiagonal, GraphCSR(file));
+
+	if (file.HasTerrain())
+	{
+		for (int idx = 0; idx < file.GetNrOfNodes(); ++idx)
+			pGraph->GetNode(idx)->SetTerrainType(file.GetTerrainType(idx));
+	}
+
+	return true;
+}
+
+void GraphCSR::Build(const GraphFileView& file)
+{
+	// Nothing is copied, the owned arrays of a previous snapshot are released
+	m_Offsets = std::vector<int>{};
+	m_Targets = std::vector<int>{};
+	m_Costs = std::vector<float>{};
+	m_Twins = std::vector<int>{};
+	m_Positions = std::vector<Vector2>{};
+	m_Valid = std::vector<uint8_t>{};
+
+	if (!file.IsOpen())
+	{
+		m_Offsets.assign(1, 0);
+		m_IsDirectionalGraph = false;
+		m_NrOfActiveNodes = 0;
+		m_Version = 0;
+		m_TopologyVersion = 0;
+		UseOwnArrays();
+		return;
+	}
+
+	m_pOffsets = file.m_pOffsets;
+	m_pTargets = file.m_pTargets;
+	m_pCosts = file.m_pCosts;
+	m_pPositions = file.m_pPositions;
+	m_pValid = file.m_pIsValid;
+	m_NrOfNodes = file.GetNrOfNodes();
+	m_NrOfArcs = file.GetNrOfArcs();
+	m_IsFileSnapshot = true;
+
+	m_NrOfActiveNodes = 0;
+	for (int idx = 0; idx < m_NrOfNodes; ++idx)
+	{
+		if (m_pValid[idx])
+			++m_NrOfActiveNodes;
+	}
+
+	// A file has no version, it doesn't change while it is open
+	m_IsDirectionalGraph = file.IsDirectionalGraph();
+	m_Version = 0;
+	m_TopologyVersion = 0;
+}
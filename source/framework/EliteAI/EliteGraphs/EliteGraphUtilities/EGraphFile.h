@@ -0,0 +1,133 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGraphFile.h: Binary graph file format, opened through a memory mapping so nothing has to be parsed.
+// The searches (AStarSearch, Landmarks, ContractionHierarchy, ...) run on a GraphCSR of the open file, GraphCSR csr(file),
+// which reads the arrays of the mapping in place. LoadGraphFile only copies a file into a graph to edit it.
+// Layout (every section starts at a multiple of 4 bytes):
+//	- GraphFileHeader
+//	- Vector2 positions[nrOfNodes]		(GetNodePos of the graph, column and row for grid graphs)
+//	- uint8_t isValid[nrOfNodes]		(removed nodes are stored as well, so indices don't change)
+//	- TerrainType terrain[nrOfNodes]	(only with GRAPH_FILE_HAS_TERRAIN)
+//	- int32_t offsets[nrOfNodes + 1]	(CSR adjacency, see EGraphCSR.h)
+//	- int32_t targets[nrOfArcs]
+//	- float costs[nrOfArcs]
+// Files are written and read in the byte order of the machine.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteGraphs\EGraphCSR.h"
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+#include "framework\EliteAI\EliteGraphs\EGraph2D.h"
+#include "framework\EliteHelpers\EMemoryMappedFile.h"
+
+namespace Elite
+{
+	const uint32_t GRAPH_FILE_MAGIC{ 0x46524745 }; // "EGRF"
+	const uint32_t GRAPH_FILE_VERSION{ 1 };
+
+	// GraphFileHeader::flags
+	const uint32_t GRAPH_FILE_DIRECTIONAL{ 1 << 0 };
+	const uint32_t GRAPH_FILE_GRID{ 1 << 1 };
+	const uint32_t GRAPH_FILE_CONNECTED_DIAGONALLY{ 1 << 2 };
+	const uint32_t GRAPH_FILE_HAS_TERRAIN{ 1 << 3 };
+
+	struct GraphFileHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t flags;
+		int32_t nrOfNodes;
+		int32_t nrOfArcs;
+
+		// Grid graphs only
+		int32_t columns;
+		int32_t rows;
+		int32_t cellSize;
+		float costStraight;
+		float costDiagonal;
+	};
+
+	// Read-only view on a graph file, with the same accessors as GraphCSR
+	// The accessors read the mapped file, Open goes over the adjacency once to check it
+	class GraphFileView final
+	{
+	public:
+		GraphFileView() = default;
+		~GraphFileView() = default;
+
+		// Fails if the file doesn't exist, isn't a graph file, has another version, is truncated
+		// or has arcs that don't fit its nodes (offsets out of order, targets that aren't valid nodes)
+		bool Open(const std::string& path);
+		// Has to be called before overwriting the file that is open
+		void Close();
+		bool IsOpen() const { return m_File.IsOpen(); }
+
+		const GraphFileHeader& GetHeader() const { return *m_pHeader; }
+		bool IsDirectionalGraph() const { return (m_pHeader->flags & GRAPH_FILE_DIRECTIONAL) != 0; }
+		bool IsGridGraph() const { return (m_pHeader->flags & GRAPH_FILE_GRID) != 0; }
+		bool HasTerrain() const { return m_pTerrain != nullptr; }
+
+		// Nodes
+		int GetNrOfNodes() const { return m_pHeader->nrOfNodes; }
+		bool IsNodeValid(int idx) const { return idx >= 0 && idx < GetNrOfNodes() && m_pIsValid[idx]; }
+		Vector2 GetNodePos(int idx) const { return m_pPositions[idx]; }
+		TerrainType GetTerrainType(int idx) const { return m_pTerrain[idx]; }
+		int GetDegree(int idx) const { return m_pOffsets[idx + 1] - m_pOffsets[idx]; }
+
+		// Arcs
+		int GetNrOfArcs() const { return m_pHeader->nrOfArcs; }
+		int GetFirstArc(int idx) const { return m_pOffsets[idx]; }
+		int GetLastArc(int idx) const { return m_pOffsets[idx + 1]; }
+		int GetArcTarget(int arc) const { return m_pTargets[arc]; }
+		float GetArcCost(int arc) const { return m_pCosts[arc]; }
+
+		//C++ make the class non-copyable
+		GraphFileView(const GraphFileView&) = delete;
+		GraphFileView& operator=(const GraphFileView&) = delete;
+
+	private:
+		// Points to the arrays below
+		friend class GraphCSR;
+
+		bool IsAdjacencyValid() const;
+
+		MemoryMappedFile m_File;
+
+		const GraphFileHeader* m_pHeader = nullptr;
+		const Vector2* m_pPositions = nullptr;
+		const uint8_t* m_pIsValid = nullptr;
+		const TerrainType* m_pTerrain = nullptr;
+		const int32_t* m_pOffsets = nullptr;
+		const int32_t* m_pTargets = nullptr;
+		const float* m_pCosts = nullptr;
+	};
+
+	// Writing
+	// -------
+	// pGridHeader provides the grid settings and flags of a grid graph, the counts are taken from the snapshot
+	bool WriteGraphFile(const std::string& path, const GraphCSR& graph, const GraphFileHeader* pGridHeader = nullptr, const std::vector<TerrainType>* pTerrain = nullptr);
+	bool WriteGraphFile(const std::string& path, const GridGraph<GridTerrainNode, GraphConnection>& graph);
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	bool WriteGraphFile(const std::string& path, const Graph2D<T_NodeType, T_ConnectionType, T_Allocator>& graph)
+	{
+		return WriteGraphFile(path, GraphCSR(graph));
+	}
+
+	// Loading into an editable graph
+	// ------------------------------
+	// Replaces the contents of the graph in one bulk build, fails if the file and the graph don't agree on being directional
+	bool LoadGraphFile(const GraphFileView& file, GridGraph<GridTerrainNode, GraphConnection>* pGraph);
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	bool LoadGraphFile(const GraphFileView& file, Graph2D<T_NodeType, T_ConnectionType, T_Allocator>* pGraph)
+	{
+		if (!file.IsOpen() || file.IsDirectionalGraph() != pGraph->IsDirectionalGraph())
+			return false;
+
+		// Removed nodes are kept as removed nodes, so the indices are those of the file
+		pGraph->Build(GraphCSR(file));
+		return true;
+	}
+}
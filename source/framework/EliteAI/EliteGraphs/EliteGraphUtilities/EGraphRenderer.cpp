@@ -3,14 +3,103 @@
 
 namespace Elite
 {
-	void GraphRenderer::RenderCircleNode(Vector2 pos, std::string text /*= ""*/, float radius /*= 3.0f*/, Elite::Color col /*= DEFAULT_NODE_COLOR*/, float depth /*= 0.0f*/) const
+	const std::string& GraphRenderer::LabelCache::GetText(size_t slot, LabelValue label)
+	{
+		if (slot >= m_Values.size())
+		{
+			// precision -1: not formatted yet
+			m_Values.resize(slot + 1, LabelValue{ 0.f, -1 });
+			m_Texts.resize(slot + 1);
+		}
+
+		LabelValue& cached = m_Values[slot];
+		if (cached.value != label.value || cached.precision != label.precision)
+		{
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), "%.*f", label.precision, label.value);
+			m_Texts[slot] = buffer;
+			cached = label;
+		}
+		return m_Texts[slot];
+	}
+
+	void GraphRenderer::LabelCache::Clear()
+	{
+		m_Values.clear();
+		m_Texts.clear();
+	}
+
+	GraphRenderer::View GraphRenderer::GetView() const
+	{
+		const Camera2D* pCamera = DEBUGRENDERER2D->GetActiveCamera();
+		if (!pCamera)
+			return View{ Vector2{ -FLT_MAX, -FLT_MAX }, Vector2{ FLT_MAX, FLT_MAX }, true };
+
+		View view{};
+		pCamera->GetWorldBounds(view.lower, view.upper);
+
+		const float pixelsPerUnit = float(pCamera->GetHeight()) / (view.upper.y - view.lower.y);
+		view.showLabels = pixelsPerUnit >= m_LabelMinPixelsPerUnit;
+		return view;
+	}
+
+	void GraphRenderer::GetCellsInView(const View& view, int columns, int rows, int cellSize, int margin, int& firstCol, int& lastCol, int& firstRow, int& lastRow) const
+	{
+		// Cell (c, r) covers [c * cellSize, (c + 1) * cellSize], clamp in float first, the view can be far outside the grid
+		auto toCell = [cellSize](float coordinate, int nrOfCells)
+		{
+			return int(floorf(Clamp(coordinate / cellSize, -1.f, float(nrOfCells))));
+		};
+
+		firstCol = std::max(toCell(view.lower.x, columns) - margin, 0);
+		lastCol = std::min(toCell(view.upper.x, columns) + margin, columns - 1);
+		firstRow = std::max(toCell(view.lower.y, rows) - margin, 0);
+		lastRow = std::min(toCell(view.upper.y, rows) + margin, rows - 1);
+	}
+
+	void GraphRenderer::BeginLabels(const void* pGraph, unsigned int version) const
+	{
+		if (pGraph != m_pLabelGraph || version != m_LabelGraphVersion)
+		{
+			m_NodeLabels.Clear();
+			m_ConnectionLabels.Clear();
+			m_pLabelGraph = pGraph;
+			m_LabelGraphVersion = version;
+		}
+		m_NrOfLabels = 0;
+	}
+
+	void GraphRenderer::AddLabel(const Vector2& pos, const std::string& text) const
+	{
+		if (m_NrOfLabels == int(m_LabelTexts.size()))
+		{
+			m_LabelPositions.emplace_back();
+			m_LabelTexts.emplace_back();
+		}
+
+		m_LabelPositions[m_NrOfLabels] = pos;
+		m_LabelTexts[m_NrOfLabels] = text;
+		++m_NrOfLabels;
+	}
+
+	void GraphRenderer::EndLabels() const
+	{
+		if (m_NrOfLabels == 0)
+			return;
+
+		m_LabelStrings.resize(m_NrOfLabels);
+		for (int i = 0; i < m_NrOfLabels; ++i)
+			m_LabelStrings[i] = m_LabelTexts[i].c_str();
+
+		DEBUGRENDERER2D->DrawStrings(m_LabelPositions.data(), m_LabelStrings.data(), m_NrOfLabels);
+	}
+
+	void GraphRenderer::RenderCircleNode(Vector2 pos, float radius /*= 3.0f*/, Elite::Color col /*= DEFAULT_NODE_COLOR*/, float depth /*= 0.0f*/) const
 	{
 		DEBUGRENDERER2D->DrawSolidCircle(pos, radius, { 0,0 }, col, depth);
-		const auto stringOffset = Vector2{ -0.5f, 1.f };
-		DEBUGRENDERER2D->DrawString(pos + stringOffset, text.c_str());
 	}
 
-	void GraphRenderer::RenderRectNode(Vector2 pos, std::string text /*= ""*/, float width /* = 3.0f*/, Elite::Color col /*= DEFAULT_NODE_COLOR*/, float depth /*= 0.0f*/) const
+	void GraphRenderer::RenderRectNode(Vector2 pos, float width /* = 3.0f*/, Elite::Color col /*= DEFAULT_NODE_COLOR*/, float depth /*= 0.0f*/) const
 	{
 		Vector2 verts[4]
 		{
@@ -21,18 +110,78 @@ namespace Elite
 		};
 
 		DEBUGRENDERER2D->DrawSolidPolygon(&verts[0], 4, col, depth);
-
-		const auto stringOffset = Vector2{ -0.5f, 1.f };
-		DEBUGRENDERER2D->DrawString(pos + stringOffset, text.c_str());
 	}
 
-	
-
-	void GraphRenderer::RenderConnection(GraphConnection* con, Elite::Vector2 toPos, Elite::Vector2 fromPos, std::string text, Elite::Color col, float depth/*= 0.0f*/) const
+	void GraphRenderer::RenderGraph(
+		ImplicitGridGraph* pGraph,
+		bool renderNodes,
+		bool renderNodeNumbers,
+		bool renderConnections,
+		bool renderConnectionsCosts) const
 	{
-		auto center = toPos + (fromPos - toPos) / 2;
+		const View view = GetView();
+		renderNodeNumbers = renderNodeNumbers && view.showLabels;
+		renderConnectionsCosts = renderConnectionsCosts && view.showLabels;
+		// No version, the labels compare their values
+		BeginLabels(pGraph, 0);
 
+		const int cellSize = pGraph->GetCellSize();
+		int firstCol, lastCol, firstRow, lastRow;
+
+		if (renderNodes)
+		{
+			//Nodes/Grid
+			GetCellsInView(view, pGraph->GetColumns(), pGraph->GetRows(), cellSize, 0, firstCol, lastCol, firstRow, lastRow);
+			for (int r = firstRow; r <= lastRow; ++r)
+			{
+				for (int c = firstCol; c <= lastCol; ++c)
+				{
+					const int idx = pGraph->GetIndex(c, r);
+					const Vector2 cellPos = pGraph->GetNodeWorldPos(idx);
+
+					RenderRectNode(cellPos, float(cellSize), pGraph->GetNodeColor(idx), 0.1f);
+					if (renderNodeNumbers)
+						AddLabel(cellPos + Vector2{ -0.5f, 1.f }, m_NodeLabels.GetText(idx, LabelValue{ float(idx), 0 }));
+				}
+			}
+		}
+
+		if (renderConnections)
+		{
+			// A connection to a cell in view can start in the cell next to the view
+			GetCellsInView(view, pGraph->GetColumns(), pGraph->GetRows(), cellSize, 1, firstCol, lastCol, firstRow, lastRow);
+			for (int r = firstRow; r <= lastRow; ++r)
+			{
+				for (int c = firstCol; c <= lastCol; ++c)
+				{
+					const int idx = pGraph->GetIndex(c, r);
+					const Vector2 fromPos = pGraph->GetNodeWorldPos(idx);
+					size_t slot = size_t(idx) * m_GridConnectionSlots;
+
+					//Connections are generated on the fly, an undirected connection is only drawn once
+					pGraph->ForEachConnection(idx, [&](int neighborIdx, float cost)
+					{
+						const size_t conSlot = slot++;
+						if (!pGraph->IsDirectionalGraph() && neighborIdx < idx)
+							return;
+
+						const Vector2 toPos = pGraph->GetNodeWorldPos(neighborIdx);
+						if (!view.Overlaps(toPos, fromPos))
+							return;
+
+						RenderConnection(toPos, fromPos);
+						if (renderConnectionsCosts)
+							AddLabel(toPos + (fromPos - toPos) / 2, m_ConnectionLabels.GetText(conSlot, GetConnectionLabel(cost)));
+					});
+				}
+			}
+		}
+
+		EndLabels();
+	}
+
+	void GraphRenderer::RenderConnection(Elite::Vector2 toPos, Elite::Vector2 fromPos, Elite::Color col, float depth/*= 0.0f*/) const
+	{
 		DEBUGRENDERER2D->DrawSegment(toPos, fromPos, col, depth);
-		DEBUGRENDERER2D->DrawString(center, text.c_str());
 	}
-}
\ No newline at end of file
+}
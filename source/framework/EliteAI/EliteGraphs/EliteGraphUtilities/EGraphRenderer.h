@@ -5,10 +5,13 @@
 #include "framework\EliteAI\EliteGraphs\EGraphConnectionTypes.h"
 #include "framework\EliteAI\EliteGraphs\EGridGraph.h"
 #include "framework\EliteAI\EliteGraphs\EGraph2D.h"
+#include "framework\EliteAI\EliteGraphs\EImplicitGridGraph.h"
 #include  <type_traits>
 
-namespace Elite 
+namespace Elite
 {
+	// Only what is in view of the active camera gets drawn. Labels are formatted once and reused until their value
+	// changes (or the graph changes version) and all labels of a graph are drawn together after the geometry.
 	class GraphRenderer final
 	{
 	public:
@@ -18,20 +21,66 @@ namespace Elite
 		template<class T_NodeType, class T_ConnectionType>
 		void RenderGraph(IGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderConnections, bool renderNodeTxt = true, bool renderConnectionTxt = true) const;
 
+		// Only visits the nodes and connections in view, found through the spatial grid of the graph
+		template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+		void RenderGraph(Graph2D<T_NodeType, T_ConnectionType, T_Allocator>* pGraph, bool renderNodes, bool renderConnections, bool renderNodeTxt = true, bool renderConnectionTxt = true) const;
+
 		template<class T_NodeType, class T_ConnectionType>
 		void RenderGraph(GridGraph<T_NodeType, T_ConnectionType>* pGraph, bool renderNodes, bool renderNodeTxt, bool renderConnections, bool renderConnectionsCosts) const;
 
+		void RenderGraph(ImplicitGridGraph* pGraph, bool renderNodes, bool renderNodeTxt, bool renderConnections, bool renderConnectionsCosts) const;
+
 		template<class T_NodeType, class T_ConnectionType>
 		void HighlightNodes(GridGraph<T_NodeType, T_ConnectionType>* pGraph, std::vector<T_NodeType*> path, Color col = HIGHLIGHTED_NODE_COLOR) const;
 
 		void SetNumberPrintPrecision(int precision) { m_FloatPrintPrecision = precision; }
+		// Labels are hidden when one world unit is smaller than this on screen, they would only overlap
+		void SetLabelMinPixelsPerUnit(float pixels) { m_LabelMinPixelsPerUnit = pixels; }
 
 	private:
-		void RenderCircleNode(Vector2 pos, std::string text = "", float radius = DEFAULT_NODE_RADIUS, Elite::Color col = DEFAULT_NODE_COLOR, float depth = 0.0f) const;
-		void RenderRectNode(Vector2 pos, std::string text = "", float width = DEFAULT_NODE_RADIUS, Elite::Color col = DEFAULT_NODE_COLOR, float depth = 0.0f) const;
-		void RenderConnection(GraphConnection* con, Elite::Vector2 toPos, Elite::Vector2 fromPos, std::string text, Elite::Color col = DEFAULT_CONNECTION_COLOR, float depth = 0.0f) const;
+		// The part of the world in view of the active camera, everything is in view without a camera
+		struct View
+		{
+			Vector2 lower;
+			Vector2 upper;
+			bool showLabels;
+
+			bool Contains(const Vector2& pos, float margin) const;
+			bool Overlaps(const Vector2& p1, const Vector2& p2) const;
+		};
 
-		// Get correct color/text depending on the pNode/pConnection type
+		struct LabelValue
+		{
+			float value;
+			int precision;
+		};
+
+		// Formatted labels per slot (node index or connection), a label is only formatted again when its value changes
+		class LabelCache final
+		{
+		public:
+			const std::string& GetText(size_t slot, LabelValue label);
+			void Clear();
+
+		private:
+			std::vector<LabelValue> m_Values;
+			std::vector<std::string> m_Texts;
+		};
+
+		View GetView() const;
+		// First and last column and row of the cells in view, extended by margin cells. The range is empty when no cell is in view
+		void GetCellsInView(const View& view, int columns, int rows, int cellSize, int margin, int& firstCol, int& lastCol, int& firstRow, int& lastRow) const;
+
+		// Labels are collected while drawing the geometry and drawn in EndLabels
+		void BeginLabels(const void* pGraph, unsigned int version) const;
+		void AddLabel(const Vector2& pos, const std::string& text) const;
+		void EndLabels() const;
+
+		void RenderCircleNode(Vector2 pos, float radius = DEFAULT_NODE_RADIUS, Elite::Color col = DEFAULT_NODE_COLOR, float depth = 0.0f) const;
+		void RenderRectNode(Vector2 pos, float width = DEFAULT_NODE_RADIUS, Elite::Color col = DEFAULT_NODE_COLOR, float depth = 0.0f) const;
+		void RenderConnection(Elite::Vector2 toPos, Elite::Vector2 fromPos, Elite::Color col = DEFAULT_CONNECTION_COLOR, float depth = 0.0f) const;
+
+		// Get correct color/label depending on the pNode/pConnection type
 		template<class T_NodeType, typename = typename enable_if<! is_base_of<GraphNode2D, T_NodeType>::value>::type>
 		Elite::Color GetNodeColor(T_NodeType* pNode) const;
 		Elite::Color GetNodeColor(GraphNode2D* pNode) const;
@@ -42,99 +91,207 @@ namespace Elite
 		Elite::Color GetConnectionColor(GraphConnection2D* pConnection) const;
 
 		template<class T_NodeType>
-		std::string GetNodeText(T_NodeType* pNode) const;
-		std::string GetNodeText(InfluenceNode* pNode) const;
+		LabelValue GetNodeLabel(T_NodeType* pNode) const;
+		LabelValue GetNodeLabel(InfluenceNode* pNode) const;
 
 		template<class T_ConnectionType>
-		std::string GetConnectionText(T_ConnectionType* pConnection) const;
-	
+		LabelValue GetConnectionLabel(T_ConnectionType* pConnection) const;
+		LabelValue GetConnectionLabel(float cost) const;
+
 		//C++ make the class non-copyable
 		GraphRenderer(const GraphRenderer&) = delete;
 		GraphRenderer& operator=(const GraphRenderer&) = delete;
 
 		// variables
 		int m_FloatPrintPrecision = 1;
+		float m_LabelMinPixelsPerUnit = 3.f;
+
+		// Slots of grid connections, a cell has at most this many connections
+		static const int m_GridConnectionSlots = 8;
+
+		// The caches belong to the last rendered graph
+		mutable const void* m_pLabelGraph = nullptr;
+		mutable unsigned int m_LabelGraphVersion = 0;
+		mutable LabelCache m_NodeLabels;
+		mutable LabelCache m_ConnectionLabels;
+
+		// Labels of the current graph, the strings keep their memory between frames
+		mutable std::vector<Vector2> m_LabelPositions;
+		mutable std::vector<std::string> m_LabelTexts;
+		mutable std::vector<const char*> m_LabelStrings;
+		mutable int m_NrOfLabels = 0;
 	};
 
+	inline bool GraphRenderer::View::Contains(const Vector2& pos, float margin) const
+	{
+		return pos.x + margin >= lower.x && pos.x - margin <= upper.x && pos.y + margin >= lower.y && pos.y - margin <= upper.y;
+	}
+
+	inline bool GraphRenderer::View::Overlaps(const Vector2& p1, const Vector2& p2) const
+	{
+		return std::max(p1.x, p2.x) >= lower.x && std::min(p1.x, p2.x) <= upper.x && std::max(p1.y, p2.y) >= lower.y && std::min(p1.y, p2.y) <= upper.y;
+	}
 
 	template<class T_NodeType, class T_ConnectionType>
 	void GraphRenderer::RenderGraph(
-		IGraph<T_NodeType, T_ConnectionType>* pGraph, 
-		bool renderNodes, 
-		bool renderConnections, 
-		bool renderNodeTxt /*= true*/, 
+		IGraph<T_NodeType, T_ConnectionType>* pGraph,
+		bool renderNodes,
+		bool renderConnections,
+		bool renderNodeTxt /*= true*/,
 		bool renderConnectionTxt /*= true*/) const
 	{
-		for (auto node : pGraph->GetAllNodes())
+		const View view = GetView();
+		renderNodeTxt = renderNodeTxt && view.showLabels;
+		renderConnectionTxt = renderConnectionTxt && view.showLabels;
+		BeginLabels(pGraph, pGraph->GetVersion());
+
+		// Connection labels are cached in the order the connections are visited
+		size_t connectionSlot = 0;
+		for (auto node : pGraph->GetActiveNodes())
 		{
-			if (renderNodes)
+			const Vector2 nodePos = pGraph->GetNodeWorldPos(node);
+			if (renderNodes && view.Contains(nodePos, DEFAULT_NODE_RADIUS))
 			{
-				std::string nodeTxt = "";
+				RenderCircleNode(nodePos, DEFAULT_NODE_RADIUS, GetNodeColor(node));
 				if (renderNodeTxt)
-					nodeTxt = GetNodeText(node);
-
-				RenderCircleNode(pGraph->GetNodeWorldPos(node),	nodeTxt, DEFAULT_NODE_RADIUS, GetNodeColor(node));
+					AddLabel(nodePos + Vector2{ -0.5f, 1.f }, m_NodeLabels.GetText(node->GetIndex(), GetNodeLabel(node)));
 			}
-		
+
 			if (renderConnections)
 			{
 				//Connections
 				for (auto con : pGraph->GetNodeConnections(node->GetIndex()))
 				{
-					std::string conTxt = "";
-					if (renderConnectionTxt)
-						conTxt = GetConnectionText(con);
+					const size_t slot = connectionSlot++;
+					const Vector2 toPos = pGraph->GetNodeWorldPos(con->GetTo());
+					const Vector2 fromPos = pGraph->GetNodeWorldPos(con->GetFrom());
+					if (!view.Overlaps(toPos, fromPos))
+						continue;
 
-					RenderConnection(con, pGraph->GetNodeWorldPos(con->GetTo()), pGraph->GetNodeWorldPos(con->GetFrom()), conTxt, GetConnectionColor(con));
+					RenderConnection(toPos, fromPos, GetConnectionColor(con));
+					if (renderConnectionTxt)
+						AddLabel(toPos + (fromPos - toPos) / 2, m_ConnectionLabels.GetText(slot, GetConnectionLabel(con)));
 				}
 			}
 		}
+
+		EndLabels();
+	}
+
+	template<class T_NodeType, class T_ConnectionType, template<class> class T_Allocator>
+	void GraphRenderer::RenderGraph(
+		Graph2D<T_NodeType, T_ConnectionType, T_Allocator>* pGraph,
+		bool renderNodes,
+		bool renderConnections,
+		bool renderNodeTxt /*= true*/,
+		bool renderConnectionTxt /*= true*/) const
+	{
+		const View view = GetView();
+		renderNodeTxt = renderNodeTxt && view.showLabels;
+		renderConnectionTxt = renderConnectionTxt && view.showLabels;
+		BeginLabels(pGraph, pGraph->GetVersion());
+
+		if (renderNodes)
+		{
+			const Vector2 margin{ DEFAULT_NODE_RADIUS, DEFAULT_NODE_RADIUS };
+			pGraph->ForEachNodeInRect(view.lower - margin, view.upper + margin, [&](T_NodeType* node)
+			{
+				const Vector2 nodePos = pGraph->GetNodeWorldPos(node);
+				if (!view.Contains(nodePos, DEFAULT_NODE_RADIUS))
+					return;
+
+				RenderCircleNode(nodePos, DEFAULT_NODE_RADIUS, GetNodeColor(node));
+				if (renderNodeTxt)
+					AddLabel(nodePos + Vector2{ -0.5f, 1.f }, m_NodeLabels.GetText(node->GetIndex(), GetNodeLabel(node)));
+			});
+		}
+
+		if (renderConnections)
+		{
+			// Connection labels are cached in the order the connections are visited
+			size_t connectionSlot = 0;
+			pGraph->ForEachConnectionInRect(view.lower, view.upper, [&](T_ConnectionType* con)
+			{
+				const Vector2 toPos = pGraph->GetNodeWorldPos(con->GetTo());
+				const Vector2 fromPos = pGraph->GetNodeWorldPos(con->GetFrom());
+				if (!view.Overlaps(toPos, fromPos))
+					return;
+
+				RenderConnection(toPos, fromPos, GetConnectionColor(con));
+				if (renderConnectionTxt)
+					AddLabel(toPos + (fromPos - toPos) / 2, m_ConnectionLabels.GetText(connectionSlot++, GetConnectionLabel(con)));
+			});
+		}
+
+		EndLabels();
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
 	void GraphRenderer::RenderGraph(
-		GridGraph<T_NodeType, T_ConnectionType>* pGraph, 
-		bool renderNodes, 
+		GridGraph<T_NodeType, T_ConnectionType>* pGraph,
+		bool renderNodes,
 		bool renderNodeNumbers,
-		bool renderConnections, 
+		bool renderConnections,
 		bool renderConnectionsCosts) const
 	{
+		const View view = GetView();
+		renderNodeNumbers = renderNodeNumbers && view.showLabels;
+		renderConnectionsCosts = renderConnectionsCosts && view.showLabels;
+		BeginLabels(pGraph, pGraph->GetVersion());
+
+		const int cellSize = pGraph->m_CellSize;
+		int firstCol, lastCol, firstRow, lastRow;
+
 		if (renderNodes)
 		{
 			//Nodes/Grid
-			for (auto r = 0; r < pGraph->m_NrOfRows; ++r)
+			GetCellsInView(view, pGraph->m_NrOfColumns, pGraph->m_NrOfRows, cellSize, 0, firstCol, lastCol, firstRow, lastRow);
+			for (auto r = firstRow; r <= lastRow; ++r)
 			{
-				for (auto c = 0; c < pGraph->m_NrOfColumns; ++c)
+				for (auto c = firstCol; c <= lastCol; ++c)
 				{
 					int idx = r * pGraph->m_NrOfColumns + c;
 					Vector2 cellPos{ pGraph->GetNodeWorldPos(idx) };
-					int cellSize = pGraph->m_CellSize;
 
 					//Node
-					std::string nodeTxt{};
+					RenderRectNode(cellPos, float(cellSize), GetNodeColor(pGraph->GetNode(idx)), 0.1f);
 					if (renderNodeNumbers)
-						nodeTxt = GetNodeText(pGraph->GetNode(idx));
-
-					RenderRectNode(cellPos, nodeTxt, float(cellSize), GetNodeColor(pGraph->GetNode(idx)), 0.1f);
+						AddLabel(cellPos + Vector2{ -0.5f, 1.f }, m_NodeLabels.GetText(idx, GetNodeLabel(pGraph->GetNode(idx))));
 				}
 			}
 		}
 
 		if (renderConnections)
 		{
-			for (auto node : pGraph->GetAllNodes())
+			// A connection to a cell in view can start in the cell next to the view
+			GetCellsInView(view, pGraph->m_NrOfColumns, pGraph->m_NrOfRows, cellSize, 1, firstCol, lastCol, firstRow, lastRow);
+			for (auto r = firstRow; r <= lastRow; ++r)
 			{
-				//Connections
-				for (auto con : pGraph->GetNodeConnections(node->GetIndex()))
+				for (auto c = firstCol; c <= lastCol; ++c)
 				{
-					std::string conTxt{ };
-					if (renderConnectionsCosts)
-						conTxt = GetConnectionText(con);
-
-					RenderConnection(con, pGraph->GetNodeWorldPos(con->GetTo()), pGraph->GetNodeWorldPos(con->GetFrom()), conTxt, GetConnectionColor(con));
+					int idx = r * pGraph->m_NrOfColumns + c;
+					if (!pGraph->IsNodeValid(idx))
+						continue;
+
+					//Connections
+					size_t slot = size_t(idx) * m_GridConnectionSlots;
+					for (auto con : pGraph->GetNodeConnections(idx))
+					{
+						const Vector2 toPos = pGraph->GetNodeWorldPos(con->GetTo());
+						const Vector2 fromPos = pGraph->GetNodeWorldPos(con->GetFrom());
+						if (view.Overlaps(toPos, fromPos))
+						{
+							RenderConnection(toPos, fromPos, GetConnectionColor(con));
+							if (renderConnectionsCosts)
+								AddLabel(toPos + (fromPos - toPos) / 2, m_ConnectionLabels.GetText(slot, GetConnectionLabel(con)));
+						}
+						++slot;
+					}
 				}
 			}
 		}
+
+		EndLabels();
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -145,7 +302,6 @@ namespace Elite
 			//Node
 			RenderCircleNode(
 				pGraph->GetNodeWorldPos(node),
-				"",
 				3.1f,
 				col,
 				-0.2f
@@ -181,26 +337,26 @@ namespace Elite
 	}
 
 	template<class T_NodeType>
-	inline std::string GraphRenderer::GetNodeText(T_NodeType* pNode) const
+	inline GraphRenderer::LabelValue GraphRenderer::GetNodeLabel(T_NodeType* pNode) const
 	{
-		std::stringstream ss;
-		ss << std::fixed << std::setprecision(m_FloatPrintPrecision) << pNode->GetIndex();
-		return ss.str();
+		// indices have no decimals
+		return LabelValue{ float(pNode->GetIndex()), 0 };
 	}
 
-	inline std::string GraphRenderer::GetNodeText(InfluenceNode* pNode) const
+	inline GraphRenderer::LabelValue GraphRenderer::GetNodeLabel(InfluenceNode* pNode) const
 	{
-		std::stringstream ss;
-		ss << std::fixed << std::setprecision(m_FloatPrintPrecision) << pNode->GetInfluence();
-		return ss.str();
+		return LabelValue{ pNode->GetInfluence(), m_FloatPrintPrecision };
 	}
 
 	template<class T_ConnectionType>
-	std::string GraphRenderer::GetConnectionText(T_ConnectionType* pConnection) const
+	GraphRenderer::LabelValue GraphRenderer::GetConnectionLabel(T_ConnectionType* pConnection) const
+	{
+		return GetConnectionLabel(pConnection->GetCost());
+	}
+
+	inline GraphRenderer::LabelValue GraphRenderer::GetConnectionLabel(float cost) const
 	{
-		std::stringstream ss;
-		ss << std::fixed << std::setprecision(m_FloatPrintPrecision) << pConnection->GetCost();
-		return ss.str();
+		return LabelValue{ cost, m_FloatPrintPrecision };
 	}
 
 }
@@ -0,0 +1,189 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EGridTerrainRenderer.h: Draws the cells of a GridGraph as one quad with a texel per cell.
+// The texture stays alive between frames, only the cells modified since the last frame are uploaded again
+// (the graph tells its listeners about them, see IGraph::MarkNodeDirty), instead of two triangles per cell every frame.
+// Meant for the apps that draw a GridGraph: terrain grids (GridTerrainNode) and influence maps on a grid (the node colors
+// set by InfluenceMap::SetNodeColorsBasedOnInfluence, followed by MarkAllCellsDirty).
+// Render replaces GraphRenderer::RenderGraph(GridGraph*) for the cells.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphRenderer.h"
+
+namespace Elite
+{
+	// The graph has to outlive the renderer
+	template<class T_NodeType, class T_ConnectionType>
+	class GridTerrainRenderer final : public IGraphListener
+	{
+	public:
+		explicit GridTerrainRenderer(GridGraph<T_NodeType, T_ConnectionType>* pGraph);
+		~GridTerrainRenderer();
+
+		// Connections are culled to the view of the camera and drawn on top of the cells
+		void Render(bool renderConnections = false, bool renderConnectionCosts = false);
+
+		// For cells changed without telling the graph
+		void MarkCellDirty(int idx);
+		void MarkAllCellsDirty() { m_IsGridDirty = true; }
+
+		GraphRenderer& GetGraphRenderer() { return m_GraphRenderer; }
+
+		// IGraphListener
+		void OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged) override;
+		void OnNodeModified(int idx) override { MarkCellDirty(idx); }
+		void OnGraphCleared() override { m_IsGridDirty = true; }
+
+	private:
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		GraphRenderer m_GraphRenderer{};
+
+		int m_ColorGridID = -1;
+		int m_NrOfColumns = 0;
+		int m_NrOfRows = 0;
+
+		// The whole texture has to be created again
+		bool m_IsGridDirty = true;
+		// Rectangle around the dirty cells, empty when m_DirtyFirstCol > m_DirtyLastCol
+		int m_DirtyFirstCol = 0;
+		int m_DirtyLastCol = -1;
+		int m_DirtyFirstRow = 0;
+		int m_DirtyLastRow = -1;
+
+		std::vector<Color> m_Colors;
+
+		void CreateColorGrid();
+		void UpdateDirtyCells();
+
+		template<class T_CellType, typename = typename enable_if<!is_base_of<GridTerrainNode, T_CellType>::value && !is_base_of<GraphNode2D, T_CellType>::value>::type>
+		static Color GetCellColor(T_CellType* pNode) { return DEFAULT_NODE_COLOR; }
+		static Color GetCellColor(GridTerrainNode* pNode) { return pNode->GetColor(); }
+		static Color GetCellColor(GraphNode2D* pNode) { return pNode->GetColor(); }
+
+		//C++ make the class non-copyable
+		GridTerrainRenderer(const GridTerrainRenderer&) = delete;
+		GridTerrainRenderer& operator=(const GridTerrainRenderer&) = delete;
+	};
+
+	template<class T_NodeType, class T_ConnectionType>
+	GridTerrainRenderer<T_NodeType, T_ConnectionType>::GridTerrainRenderer(GridGraph<T_NodeType, T_ConnectionType>* pGraph)
+		: m_pGraph(pGraph)
+	{
+		m_pGraph->AddListener(this);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	GridTerrainRenderer<T_NodeType, T_ConnectionType>::~GridTerrainRenderer()
+	{
+		m_pGraph->RemoveListener(this);
+		if (m_ColorGridID != -1)
+			DEBUGRENDERER2D->DeleteColorGrid(m_ColorGridID);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridTerrainRenderer<T_NodeType, T_ConnectionType>::Render(bool renderConnections, bool renderConnectionCosts)
+	{
+		// The grid can be initialized again with another size
+		if (m_pGraph->GetColumns() != m_NrOfColumns || m_pGraph->GetRows() != m_NrOfRows)
+			m_IsGridDirty = true;
+
+		if (m_IsGridDirty)
+			CreateColorGrid();
+		else if (m_DirtyFirstCol <= m_DirtyLastCol)
+			UpdateDirtyCells();
+
+		if (m_ColorGridID != -1)
+		{
+			// Same depth as the cells drawn by GraphRenderer
+			const float cellSize = float(m_pGraph->GetCellSize());
+			DEBUGRENDERER2D->DrawColorGrid(m_ColorGridID, ZeroVector2, Vector2{ m_NrOfColumns * cellSize, m_NrOfRows * cellSize }, 0.1f);
+		}
+
+		if (renderConnections)
+			m_GraphRenderer.RenderGraph(m_pGraph, false, false, true, renderConnectionCosts);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridTerrainRenderer<T_NodeType, T_ConnectionType>::MarkCellDirty(int idx)
+	{
+		if (m_NrOfColumns == 0)
+			return;
+
+		const int col = idx % m_NrOfColumns;
+		const int row = idx / m_NrOfColumns;
+		if (m_DirtyFirstCol > m_DirtyLastCol)
+		{
+			m_DirtyFirstCol = m_DirtyLastCol = col;
+			m_DirtyFirstRow = m_DirtyLastRow = row;
+			return;
+		}
+
+		m_DirtyFirstCol = std::min(m_DirtyFirstCol, col);
+		m_DirtyLastCol = std::max(m_DirtyLastCol, col);
+		m_DirtyFirstRow = std::min(m_DirtyFirstRow, row);
+		m_DirtyLastRow = std::max(m_DirtyLastRow, row);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridTerrainRenderer<T_NodeType, T_ConnectionType>::OnGraphModified(bool nrOfNodesChanged, bool nrOfConnectionsChanged)
+	{
+		if (nrOfNodesChanged)
+			m_IsGridDirty = true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridTerrainRenderer<T_NodeType, T_ConnectionType>::CreateColorGrid()
+	{
+		if (m_ColorGridID != -1)
+		{
+			DEBUGRENDERER2D->DeleteColorGrid(m_ColorGridID);
+			m_ColorGridID = -1;
+		}
+
+		m_NrOfColumns = m_pGraph->GetColumns();
+		m_NrOfRows = m_pGraph->GetRows();
+		m_IsGridDirty = false;
+		m_DirtyFirstCol = 0;
+		m_DirtyLastCol = -1;
+
+		// Nodes are still being added
+		const int nrOfCells = m_NrOfColumns * m_NrOfRows;
+		if (nrOfCells == 0 || m_pGraph->GetNrOfNodes() < nrOfCells)
+		{
+			m_IsGridDirty = true;
+			return;
+		}
+
+		// Cell indices are row by row from the bottom, the order of the texture
+		m_Colors.resize(nrOfCells);
+		for (int idx = 0; idx < nrOfCells; ++idx)
+			m_Colors[idx] = GetCellColor(m_pGraph->GetNode(idx));
+
+		m_ColorGridID = DEBUGRENDERER2D->CreateColorGrid(m_NrOfColumns, m_NrOfRows, m_Colors.data());
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridTerrainRenderer<T_NodeType, T_ConnectionType>::UpdateDirtyCells()
+	{
+		// One upload for the rectangle around all dirty cells, a brush stroke only touches cells close to each other
+		const int width = m_DirtyLastCol - m_DirtyFirstCol + 1;
+		const int height = m_DirtyLastRow - m_DirtyFirstRow + 1;
+		m_Colors.resize(size_t(width) * height);
+
+		for (int r = 0; r < height; ++r)
+		{
+			for (int c = 0; c < width; ++c)
+			{
+				const int idx = m_pGraph->GetIndex(m_DirtyFirstCol + c, m_DirtyFirstRow + r);
+				m_Colors[r * width + c] = GetCellColor(m_pGraph->GetNode(idx));
+			}
+		}
+
+		DEBUGRENDERER2D->UpdateColorGrid(m_ColorGridID, m_DirtyFirstCol, m_DirtyFirstRow, width, height, m_Colors.data());
+		m_DirtyFirstCol = 0;
+		m_DirtyLastCol = -1;
+	}
+}
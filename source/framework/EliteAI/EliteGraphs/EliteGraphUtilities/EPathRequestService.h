@@ -0,0 +1,367 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EPathRequestService.h: Queue of path requests, searched a bit every frame within a time budget.
+// Requests are handled one at a time, highest priority first. A search that doesn't finish within
+// the budget of this frame continues the next frame, so the frame time stays the same no matter how
+// many agents ask for a path. An agent that asks again replaces its previous request.
+// The first search after the graph changed rebuilds the snapshot AStar searches on, which isn't sliced.
+// The service listens to the graph: a request to or from a removed node fails, and Compact remaps the requests.
+/*=============================================================================*/
+#pragma once
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAStar.h"
+
+namespace Elite
+{
+	struct PathRequestStatistics
+	{
+		int nrOfRequests = 0;
+		int nrOfFoundPaths = 0;
+		int nrOfFailedRequests = 0;
+		// replaced by a new request of the same requester before they were handled
+		int nrOfCancelledRequests = 0;
+		// asked again for the same start and goal while still waiting, the first request is kept
+		int nrOfDeduplicatedRequests = 0;
+		// searches that started over because the nodes they ran on were added, removed or remapped
+		int nrOfRestarts = 0;
+
+		// time between the first request and the callback, in milliseconds
+		float averageLatency = 0.f;
+		float maxLatency = 0.f;
+		// time spent searching in the last Update, in microseconds
+		int lastUpdateTime = 0;
+		int maxUpdateTime = 0;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	class PathRequestService final : public IGraphListener
+	{
+	public:
+		struct PathResult
+		{
+			int requesterId;
+			// empty if there is no path
+			std::vector<T_NodeType*> path;
+			float cost;
+		};
+		typedef std::function<void(const PathResult&)> PathCallback;
+
+		PathRequestService(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction = HeuristicFunctions::Euclidean, int budget = 1000);
+		~PathRequestService();
+
+		// Higher priorities are searched first, requests with the same priority in the order they came in
+		// The callback is called from Update, the nodes have to stay in the graph until then
+		void RequestPath(int requesterId, T_NodeType* pStartNode, T_NodeType* pGoalNode, int priority, PathCallback callback);
+		void CancelRequest(int requesterId);
+		bool HasRequest(int requesterId) const;
+
+		// Searches until the budget is used up, calls the callbacks of the finished requests
+		void Update();
+
+		// Time to spend searching per Update, in microseconds
+		void SetBudget(int budget) { m_Budget = budget; }
+		int GetBudget() const { return m_Budget; }
+
+		// Requests waiting or being searched
+		int GetQueueDepth() const { return int(m_Requests.size()) + (m_IsSearching ? 1 : 0); }
+		const PathRequestStatistics& GetStatistics() const { return m_Statistics; }
+		void ResetStatistics() { m_Statistics = PathRequestStatistics{}; }
+		// Adds the statistics to the current ImGui window
+		void RenderStatistics() const;
+
+		// IGraphListener
+		virtual void OnNodeModified(int idx) override;
+		virtual void OnGraphCleared() override;
+		virtual void OnNodesRemapped(const std::vector<int>& newIndices) override;
+
+		//C++ make the class non-copyable
+		PathRequestService(const PathRequestService&) = delete;
+		PathRequestService& operator=(const PathRequestService&) = delete;
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		struct Request
+		{
+			int startIdx;
+			int goalIdx;
+			int priority;
+			unsigned int sequence;
+			Clock::time_point requestTime;
+			PathCallback callback;
+		};
+
+		struct QueueEntry
+		{
+			int priority;
+			unsigned int sequence;
+			int requesterId;
+
+			// max heap on this ordering: highest priority first, then the oldest
+			bool operator<(const QueueEntry& other) const
+			{
+				if (priority != other.priority)
+					return priority < other.priority;
+				return sequence > other.sequence;
+			}
+		};
+
+		// Nodes expanded between two looks at the clock
+		static const int m_NrOfExpansionsPerSlice = 64;
+
+		bool StartNextRequest();
+		void BeginActiveSearch();
+		void FinishActiveRequest(SearchStatus status);
+		// Changes the start and goal of every request, the active search starts over if its own changed
+		template<typename T_Func>
+		void RemapRequests(T_Func remap);
+
+		IGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		AStar<T_NodeType, T_ConnectionType> m_AStar;
+		int m_Budget;
+
+		// Waiting requests by requester, the queue keeps entries of replaced requests until they come up
+		std::unordered_map<int, Request> m_Requests;
+		std::vector<QueueEntry> m_Queue;
+		unsigned int m_NextSequence = 0;
+
+		bool m_IsSearching = false;
+		// The active search runs on indices that changed
+		bool m_IsRestartNeeded = false;
+		int m_ActiveRequesterId = 0;
+		Request m_ActiveRequest;
+
+		PathRequestStatistics m_Statistics;
+		float m_TotalLatency = 0.f;
+	};
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline PathRequestService<T_NodeType, T_ConnectionType>::PathRequestService(IGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, int budget)
+		: m_pGraph(pGraph)
+		, m_AStar(pGraph, hFunction)
+		, m_Budget(budget)
+	{
+		m_pGraph->AddListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline PathRequestService<T_NodeType, T_ConnectionType>::~PathRequestService()
+	{
+		m_pGraph->RemoveListener(this);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::RequestPath(int requesterId, T_NodeType* pStartNode, T_NodeType* pGoalNode, int priority, PathCallback callback)
+	{
+		const int startIdx = pStartNode ? pStartNode->GetIndex() : invalid_node_index;
+		const int goalIdx = pGoalNode ? pGoalNode->GetIndex() : invalid_node_index;
+		Clock::time_point requestTime = Clock::now();
+		++m_Statistics.nrOfRequests;
+
+		// Same path as the one being searched: let it finish
+		if (m_IsSearching && m_ActiveRequesterId == requesterId)
+		{
+			if (m_ActiveRequest.startIdx == startIdx && m_ActiveRequest.goalIdx == goalIdx)
+			{
+				m_ActiveRequest.callback = std::move(callback);
+				++m_Statistics.nrOfDeduplicatedRequests;
+				return;
+			}
+
+			m_IsSearching = false;
+			++m_Statistics.nrOfCancelledRequests;
+		}
+
+		auto foundIt = m_Requests.find(requesterId);
+		if (foundIt != m_Requests.end())
+		{
+			// Same path as the waiting one: keep its place in the queue unless the priority went up
+			Request& waitingRequest = foundIt->second;
+			if (waitingRequest.startIdx == startIdx && waitingRequest.goalIdx == goalIdx)
+			{
+				++m_Statistics.nrOfDeduplicatedRequests;
+				if (priority <= waitingRequest.priority)
+				{
+					waitingRequest.callback = std::move(callback);
+					return;
+				}
+
+				requestTime = waitingRequest.requestTime;
+			}
+			else
+			{
+				++m_Statistics.nrOfCancelledRequests;
+			}
+		}
+
+		const unsigned int sequence = m_NextSequence++;
+		m_Requests[requesterId] = Request{ startIdx, goalIdx, priority, sequence, requestTime, std::move(callback) };
+		m_Queue.push_back({ priority, sequence, requesterId });
+		std::push_heap(m_Queue.begin(), m_Queue.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::CancelRequest(int requesterId)
+	{
+		if (m_IsSearching && m_ActiveRequesterId == requesterId)
+		{
+			m_IsSearching = false;
+			++m_Statistics.nrOfCancelledRequests;
+		}
+
+		if (m_Requests.erase(requesterId) > 0)
+			++m_Statistics.nrOfCancelledRequests;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool PathRequestService<T_NodeType, T_ConnectionType>::HasRequest(int requesterId) const
+	{
+		return (m_IsSearching && m_ActiveRequesterId == requesterId) || m_Requests.find(requesterId) != m_Requests.end();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::Update()
+	{
+		const Clock::time_point updateStart = Clock::now();
+		const Clock::time_point deadline = updateStart + std::chrono::microseconds(m_Budget);
+
+		do
+		{
+			if (!m_IsSearching && !StartNextRequest())
+				break;
+
+			if (m_IsRestartNeeded)
+			{
+				m_Statistics.nrOfRestarts += m_AStar.GetLastNrOfRestarts() + 1;
+				BeginActiveSearch();
+			}
+
+			const SearchStatus status = m_AStar.ContinueSearch(m_NrOfExpansionsPerSlice);
+			if (status != SearchStatus::Searching)
+				FinishActiveRequest(status);
+		} while (Clock::now() < deadline);
+
+		const auto updateTime = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - updateStart);
+		m_Statistics.lastUpdateTime = int(updateTime.count());
+		m_Statistics.maxUpdateTime = std::max(m_Statistics.maxUpdateTime, m_Statistics.lastUpdateTime);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::RenderStatistics() const
+	{
+		ImGui::Text("Path requests");
+		ImGui::Indent();
+		ImGui::Text("Queue depth: %d", GetQueueDepth());
+		ImGui::Text("Requests: %d", m_Statistics.nrOfRequests);
+		ImGui::Text("Found: %d", m_Statistics.nrOfFoundPaths);
+		ImGui::Text("Failed: %d", m_Statistics.nrOfFailedRequests);
+		ImGui::Text("Cancelled: %d", m_Statistics.nrOfCancelledRequests);
+		ImGui::Text("Deduplicated: %d", m_Statistics.nrOfDeduplicatedRequests);
+		ImGui::Text("Restarts: %d", m_Statistics.nrOfRestarts);
+		ImGui::Text("Latency: %.2f ms (max %.2f)", m_Statistics.averageLatency, m_Statistics.maxLatency);
+		ImGui::Text("Search time: %d us (max %d)", m_Statistics.lastUpdateTime, m_Statistics.maxUpdateTime);
+		ImGui::Unindent();
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline bool PathRequestService<T_NodeType, T_ConnectionType>::StartNextRequest()
+	{
+		while (!m_Queue.empty())
+		{
+			std::pop_heap(m_Queue.begin(), m_Queue.end());
+			const QueueEntry entry = m_Queue.back();
+			m_Queue.pop_back();
+
+			// Replaced or cancelled after this entry was queued
+			auto foundIt = m_Requests.find(entry.requesterId);
+			if (foundIt == m_Requests.end() || foundIt->second.sequence != entry.sequence)
+				continue;
+
+			m_ActiveRequesterId = entry.requesterId;
+			m_ActiveRequest = std::move(foundIt->second);
+			m_Requests.erase(foundIt);
+			m_IsSearching = true;
+			BeginActiveSearch();
+			return true;
+		}
+		return false;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::BeginActiveSearch()
+	{
+		m_IsRestartNeeded = false;
+		T_NodeType* pStartNode = m_pGraph->IsNodeValid(m_ActiveRequest.startIdx) ? m_pGraph->GetNode(m_ActiveRequest.startIdx) : nullptr;
+		T_NodeType* pGoalNode = m_pGraph->IsNodeValid(m_ActiveRequest.goalIdx) ? m_pGraph->GetNode(m_ActiveRequest.goalIdx) : nullptr;
+		m_AStar.BeginSearch(pStartNode, pGoalNode);
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::FinishActiveRequest(SearchStatus status)
+	{
+		m_IsSearching = false;
+		m_Statistics.nrOfRestarts += m_AStar.GetLastNrOfRestarts();
+
+		const float latency = std::chrono::duration<float, std::milli>(Clock::now() - m_ActiveRequest.requestTime).count();
+		if (status == SearchStatus::Found)
+			++m_Statistics.nrOfFoundPaths;
+		else
+			++m_Statistics.nrOfFailedRequests;
+
+		m_TotalLatency += latency;
+		m_Statistics.averageLatency = m_TotalLatency / float(m_Statistics.nrOfFoundPaths + m_Statistics.nrOfFailedRequests);
+		m_Statistics.maxLatency = std::max(m_Statistics.maxLatency, latency);
+
+		// The callback can request a new path, nothing of the active request is used after calling it
+		PathCallback callback = std::move(m_ActiveRequest.callback);
+		if (callback)
+			callback(PathResult{ m_ActiveRequesterId, m_AStar.GetPath(), m_AStar.GetLastPathCost() });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::OnNodeModified(int idx)
+	{
+		// Only removed nodes matter, a node added in the same slot later is another node
+		if (m_pGraph->IsNodeValid(idx))
+			return;
+
+		RemapRequests([idx](int requestIdx) { return requestIdx == idx ? invalid_node_index : requestIdx; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::OnGraphCleared()
+	{
+		RemapRequests([](int) { return invalid_node_index; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::OnNodesRemapped(const std::vector<int>& newIndices)
+	{
+		RemapRequests([&newIndices](int requestIdx) { return GetRemappedNodeIndex(newIndices, requestIdx); });
+		// The open and closed nodes of the active search moved as well
+		m_IsRestartNeeded = m_IsSearching;
+	}
+
+	template <class T_NodeType, class T_ConnectionType>
+	template <typename T_Func>
+	inline void PathRequestService<T_NodeType, T_ConnectionType>::RemapRequests(T_Func remap)
+	{
+		for (auto& requestPair : m_Requests)
+		{
+			requestPair.second.startIdx = remap(requestPair.second.startIdx);
+			requestPair.second.goalIdx = remap(requestPair.second.goalIdx);
+		}
+
+		if (!m_IsSearching)
+			return;
+
+		const int startIdx = remap(m_ActiveRequest.startIdx);
+		const int goalIdx = remap(m_ActiveRequest.goalIdx);
+		if (startIdx != m_ActiveRequest.startIdx || goalIdx != m_ActiveRequest.goalIdx)
+		{
+			m_ActiveRequest.startIdx = startIdx;
+			m_ActiveRequest.goalIdx = goalIdx;
+			m_IsRestartNeeded = true;
+		}
+	}
+}
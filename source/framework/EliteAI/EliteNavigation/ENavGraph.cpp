@@ -0,0 +1,91 @@
+#include "stdafx.h"
+#include "ENavGraph.h"
+
+using namespace Elite;
+
+NavGraph::NavGraph(const Polygon& contourMesh, float playerRadius)
+	: Graph2D(false)
+{
+	CreateNavigationMesh(contourMesh, PHYSICSWORLD->GetAllStaticShapesInWorld(PhysicsFlags::NavigationCollider), playerRadius);
+	CreateNavigationGraph();
+}
+
+NavGraph::NavGraph(const Polygon& contourMesh, const std::vector<Polygon>& obstacles, float playerRadius)
+	: Graph2D(false)
+{
+	CreateNavigationMesh(contourMesh, obstacles, playerRadius);
+	CreateNavigationGraph();
+}
+
+NavGraph::~NavGraph()
+{
+	SAFE_DELETE(m_pNavMeshPolygon);
+}
+
+int NavGraph::GetNodeIdxFromLineIdx(int lineIdx) const
+{
+	if (lineIdx < 0 || lineIdx >= int(m_LineNodeIndices.size()))
+		return invalid_node_index;
+
+	return m_LineNodeIndices[lineIdx];
+}
+
+void NavGraph::CreateNavigationMesh(const Polygon& contourMesh, const std::vector<Polygon>& obstacles, float playerRadius)
+{
+	// Walkable area: the contour with the obstacles as holes
+	// Holes are wound clockwise, which also makes ExpandShape grow them instead of shrinking them
+	m_pNavMeshPolygon = new Polygon(contourMesh);
+	for (auto obstacle : obstacles)
+	{
+		obstacle.OrientateWithChildren(Winding::CW);
+		obstacle.ExpandShape(playerRadius);
+		m_pNavMeshPolygon->AddChild(obstacle);
+	}
+
+	m_pNavMeshPolygon->Triangulate();
+}
+
+void NavGraph::CreateNavigationGraph()
+{
+	const auto& lines = m_pNavMeshPolygon->GetLines();
+	const auto& triangles = m_pNavMeshPolygon->GetTriangles();
+
+	// Lines used by two triangles are walkable portals, the others are on the border
+	std::vector<int> nrOfTriangles(lines.size(), 0);
+	for (const Triangle* pTriangle : triangles)
+	{
+		for (int lineIdx : pTriangle->metaData.IndexLines)
+			++nrOfTriangles[lineIdx];
+	}
+
+	m_LineNodeIndices.assign(lines.size(), invalid_node_index);
+	for (int lineIdx = 0; lineIdx < int(lines.size()); ++lineIdx)
+	{
+		if (nrOfTriangles[lineIdx] < 2)
+			continue;
+
+		const Vector2 center = (lines[lineIdx]->p1 + lines[lineIdx]->p2) / 2.f;
+		m_LineNodeIndices[lineIdx] = AddNode(AllocateNode(GetNextFreeNodeIndex(), lineIdx, center));
+	}
+
+	// Connect the portals of every triangle, two triangles never share more than one line so every pair is unique
+	for (const Triangle* pTriangle : triangles)
+	{
+		int nodeIndices[3]{};
+		int nrOfNodes = 0;
+		for (int lineIdx : pTriangle->metaData.IndexLines)
+		{
+			if (m_LineNodeIndices[lineIdx] != invalid_node_index)
+				nodeIndices[nrOfNodes++] = m_LineNodeIndices[lineIdx];
+		}
+
+		for (int i = 0; i < nrOfNodes; ++i)
+		{
+			for (int j = i + 1; j < nrOfNodes; ++j)
+			{
+				const float cost = Distance(GetNodePos(nodeIndices[i]), GetNodePos(nodeIndices[j]));
+				AddConnection(AllocateConnection(nodeIndices[i], nodeIndices[j], cost));
+			}
+		}
+	}
+}
@@ -0,0 +1,39 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ENavGraph.h: Navigation graph over a triangulated navigation mesh. Every edge shared by two triangles
+// gets a node in its middle, nodes are connected to the nodes on the other edges of the same triangles.
+// A navmesh needs far fewer nodes than a grid over the same level.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteGraphs\EGraph2D.h"
+#include "framework\EliteGeometry\EGeometry2DTypes.h"
+
+namespace Elite
+{
+	class NavGraph final : public Graph2D<NavGraphNode, GraphConnection2D>
+	{
+	public:
+		// The static physics shapes flagged as NavigationCollider are cut out of the contour
+		NavGraph(const Polygon& contourMesh, float playerRadius = 1.0f);
+		// Obstacles are cut out of the contour, grown by the radius of the player so it can't touch them
+		NavGraph(const Polygon& contourMesh, const std::vector<Polygon>& obstacles, float playerRadius = 1.0f);
+		virtual ~NavGraph();
+
+		// invalid_node_index for lines on the border of the mesh
+		int GetNodeIdxFromLineIdx(int lineIdx) const;
+		const Polygon* GetNavMeshPolygon() const { return m_pNavMeshPolygon; }
+
+		//C++ make the class non-copyable
+		NavGraph(const NavGraph&) = delete;
+		NavGraph& operator=(const NavGraph&) = delete;
+
+	private:
+		Polygon* m_pNavMeshPolygon = nullptr;
+		std::vector<int> m_LineNodeIndices;
+
+		void CreateNavigationMesh(const Polygon& contourMesh, const std::vector<Polygon>& obstacles, float playerRadius);
+		void CreateNavigationGraph();
+	};
+}
@@ -0,0 +1,69 @@
+#include "stdafx.h"
+#include "ENavGraphPathfinding.h"
+
+using namespace Elite;
+
+NavMeshPathfinder::NavMeshPathfinder(NavGraph* pNavGraph)
+	: m_pNavGraph(pNavGraph)
+	, m_Pathfinder(pNavGraph, HeuristicFunctions::Euclidean)
+{
+}
+
+std::vector<Vector2> NavMeshPathfinder::FindPath(const Vector2& startPos, const Vector2& endPos) const
+{
+	m_Portals.clear();
+	m_NodePath.clear();
+
+	const Polygon* pNavMesh = m_pNavGraph->GetNavMeshPolygon();
+	const Triangle* pStartTriangle = pNavMesh->GetTriangleFromPosition(startPos, true);
+	const Triangle* pEndTriangle = pNavMesh->GetTriangleFromPosition(endPos, true);
+	if (!pStartTriangle || !pEndTriangle)
+		return {};
+
+	// Inside one triangle the straight line is free
+	if (pStartTriangle == pEndTriangle)
+		return { endPos };
+
+	// Search from the portals of the start triangle to the portals of the end triangle
+	std::vector<PathEndpoint> starts{}, goals{};
+	GetTriangleEndpoints(pStartTriangle, startPos, starts);
+	GetTriangleEndpoints(pEndTriangle, endPos, goals);
+
+	m_NodePath = m_Pathfinder.FindPath(starts, goals, endPos);
+	if (m_NodePath.empty())
+		return {};
+
+	// Orient every portal: the previous point is on the side the path enters from
+	const auto& lines = pNavMesh->GetLines();
+	m_Portals.reserve(m_NodePath.size() + 2);
+	m_Portals.push_back({ startPos, startPos });
+
+	Vector2 previousPoint = pStartTriangle->GetCenter();
+	for (const NavGraphNode* pNode : m_NodePath)
+	{
+		const Line* pLine = lines[pNode->GetLineIndex()];
+		if (Cross(pLine->p2 - pLine->p1, previousPoint - pLine->p1) < 0.f)
+			m_Portals.push_back({ pLine->p1, pLine->p2 });
+		else
+			m_Portals.push_back({ pLine->p2, pLine->p1 });
+
+		previousPoint = pNode->GetPosition();
+	}
+
+	m_Portals.push_back({ endPos, endPos });
+
+	// The funnel path starts with the start position
+	std::vector<Vector2> path = SSFA::OptimizePortals(m_Portals);
+	path.erase(path.begin());
+	return path;
+}
+
+void NavMeshPathfinder::GetTriangleEndpoints(const Triangle* pTriangle, const Vector2& pos, std::vector<PathEndpoint>& endpoints) const
+{
+	for (int lineIdx : pTriangle->metaData.IndexLines)
+	{
+		const int nodeIdx = m_pNavGraph->GetNodeIdxFromLineIdx(lineIdx);
+		if (nodeIdx != invalid_node_index)
+			endpoints.push_back({ nodeIdx, Distance(pos, m_pNavGraph->GetNodePos(nodeIdx)) });
+	}
+}
@@ -0,0 +1,38 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ENavGraphPathfinding.h: Paths between two positions on a navigation mesh. A* finds the portals to cross
+// in the NavGraph, the funnel algorithm turns them into the corners of the shortest route through them.
+/*=============================================================================*/
+#pragma once
+
+#include "framework\EliteAI\EliteNavigation\ENavGraph.h"
+#include "framework\EliteAI\EliteNavigation\ESSFA.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAStar.h"
+
+namespace Elite
+{
+	class NavMeshPathfinder final
+	{
+	public:
+		explicit NavMeshPathfinder(NavGraph* pNavGraph);
+
+		// Corners to walk through, ending in endPos (the start position isn't included)
+		// Empty if a position is outside the mesh or there is no path
+		std::vector<Vector2> FindPath(const Vector2& startPos, const Vector2& endPos) const;
+
+		// Debug information of the last path
+		const std::vector<Portal>& GetLastPortals() const { return m_Portals; }
+		const std::vector<NavGraphNode*>& GetLastNodePath() const { return m_NodePath; }
+
+	private:
+		NavGraph* m_pNavGraph;
+		AStar<NavGraphNode, GraphConnection2D> m_Pathfinder;
+
+		mutable std::vector<Portal> m_Portals;
+		mutable std::vector<NavGraphNode*> m_NodePath;
+
+		// Nodes on the edges of the triangle, with the distance to pos as cost
+		void GetTriangleEndpoints(const Triangle* pTriangle, const Vector2& pos, std::vector<PathEndpoint>& endpoints) const;
+	};
+}
@@ -0,0 +1,97 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// ESSFA.h: Simple stupid funnel algorithm (Mikko Mononen). Pulls a path taut through a list of portals,
+// the lines the path has to cross, leaving only the corners where it has to turn.
+/*=============================================================================*/
+#pragma once
+
+namespace Elite
+{
+	// Line to cross, left and right as seen when walking through it
+	struct Portal
+	{
+		Vector2 left;
+		Vector2 right;
+	};
+
+	class SSFA final
+	{
+	public:
+		// The first portal is the start position and the last one the end position (both with left == right)
+		// Returns the start position, the corners and the end position
+		static std::vector<Vector2> OptimizePortals(const std::vector<Portal>& portals);
+	};
+
+	inline std::vector<Vector2> SSFA::OptimizePortals(const std::vector<Portal>& portals)
+	{
+		std::vector<Vector2> path{};
+		if (portals.empty())
+			return path;
+
+		// The funnel runs from the apex to the tightest left and right points so far
+		Vector2 apex = portals[0].left;
+		Vector2 portalLeft = portals[0].left;
+		Vector2 portalRight = portals[0].right;
+		int apexIdx = 0, leftIdx = 0, rightIdx = 0;
+
+		path.push_back(apex);
+
+		for (int i = 1; i < int(portals.size()); ++i)
+		{
+			const Vector2& left = portals[i].left;
+			const Vector2& right = portals[i].right;
+
+			// Right side: the new point narrows the funnel if it isn't to the right of the current right side
+			if (Cross(portalRight - apex, right - apex) >= 0.f)
+			{
+				if (apex == portalRight || Cross(portalLeft - apex, right - apex) < 0.f)
+				{
+					portalRight = right;
+					rightIdx = i;
+				}
+				else
+				{
+					// Crossed over the left side: the left point is a corner, restart from there
+					apex = portalLeft;
+					apexIdx = leftIdx;
+					path.push_back(apex);
+
+					portalLeft = portalRight = apex;
+					leftIdx = rightIdx = apexIdx;
+					i = apexIdx;
+					continue;
+				}
+			}
+
+			// Left side, mirrored
+			if (Cross(portalLeft - apex, left - apex) <= 0.f)
+			{
+				if (apex == portalLeft || Cross(portalRight - apex, left - apex) > 0.f)
+				{
+					portalLeft = left;
+					leftIdx = i;
+				}
+				else
+				{
+					// Crossed over the right side: the right point is a corner, restart from there
+					apex = portalRight;
+					apexIdx = rightIdx;
+					path.push_back(apex);
+
+					portalLeft = portalRight = apex;
+					leftIdx = rightIdx = apexIdx;
+					i = apexIdx;
+					continue;
+				}
+			}
+		}
+
+		// The end position closes the path unless it already became a corner
+		const Vector2& endPos = portals.back().left;
+		if (!(path.back() == endPos))
+			path.push_back(endPos);
+
+		return path;
+	}
+}
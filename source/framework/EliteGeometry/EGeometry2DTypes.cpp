@@ -352,7 +352,7 @@ void Elite::Polygon::OrientateWithChildren(Winding winding)
 
 	//Rewind the children if necessary
 	auto windingChildren = abs(winding - 1); //CCW -> CW, CW -> CCW ----- abs(0-1)=1, abs(1-1)=0
-	for (auto child : m_vChildren)
+	for (auto& child : m_vChildren)
 		child.OrientateWithChildren(static_cast<Winding>(windingChildren));
 }
 
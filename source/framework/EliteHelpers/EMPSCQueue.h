@@ -0,0 +1,88 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EMPSCQueue.h: Lock-free queue with many producers and a single consumer.
+// Producers push onto an atomic list head, the consumer takes the whole list at once and
+// reverses it, so values come out in the order they were pushed. Taking everything at once
+// means no node is freed while a producer could still be looking at it.
+/*=============================================================================*/
+#pragma once
+
+#include <atomic>
+
+namespace Elite
+{
+	template <class T>
+	class MPSCQueue final
+	{
+	public:
+		MPSCQueue() = default;
+		~MPSCQueue();
+
+		// Any thread
+		void Push(T value);
+
+		// Consumer thread only, calls func for every value pushed so far, oldest first
+		// Returns the number of values
+		template <class T_Func>
+		int PopAll(T_Func func);
+
+		bool IsEmpty() const { return m_pHead.load(std::memory_order_acquire) == nullptr; }
+
+		//C++ make the class non-copyable
+		MPSCQueue(const MPSCQueue&) = delete;
+		MPSCQueue& operator=(const MPSCQueue&) = delete;
+
+	private:
+		struct Node
+		{
+			T value;
+			Node* pNext;
+		};
+
+		std::atomic<Node*> m_pHead{ nullptr };
+	};
+
+	template <class T>
+	inline MPSCQueue<T>::~MPSCQueue()
+	{
+		PopAll([](T&) {});
+	}
+
+	template <class T>
+	inline void MPSCQueue<T>::Push(T value)
+	{
+		Node* pNode = new Node{ std::move(value), m_pHead.load(std::memory_order_relaxed) };
+		while (!m_pHead.compare_exchange_weak(pNode->pNext, pNode, std::memory_order_release, std::memory_order_relaxed))
+		{
+		}
+	}
+
+	template <class T>
+	template <class T_Func>
+	inline int MPSCQueue<T>::PopAll(T_Func func)
+	{
+		Node* pNode = m_pHead.exchange(nullptr, std::memory_order_acquire);
+
+		// Newest first, reverse it
+		Node* pOldest = nullptr;
+		while (pNode)
+		{
+			Node* pNext = pNode->pNext;
+			pNode->pNext = pOldest;
+			pOldest = pNode;
+			pNode = pNext;
+		}
+
+		int nrOfValues = 0;
+		while (pOldest)
+		{
+			Node* pNext = pOldest->pNext;
+			func(pOldest->value);
+			delete pOldest;
+			pOldest = pNext;
+			++nrOfValues;
+		}
+		return nrOfValues;
+	}
+}
@@ -0,0 +1,112 @@
+#include "stdafx.h"
+#include "EMemoryMappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace Elite;
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+	Close();
+}
+
+#ifdef _WIN32
+bool MemoryMappedFile::Open(const std::string& path)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_RANDOM_ACCESS, nullptr);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize{};
+	if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!hMapping)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	void* pView = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!pView)
+	{
+		CloseHandle(hMapping);
+		CloseHandle(hFile);
+		return false;
+	}
+
+	m_hFile = hFile;
+	m_hMapping = hMapping;
+	m_pData = static_cast<const uint8_t*>(pView);
+	m_Size = size_t(fileSize.QuadPart);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile)
+		CloseHandle(m_hFile);
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_hMapping = nullptr;
+	m_hFile = nullptr;
+}
+#else
+bool MemoryMappedFile::Open(const std::string& path)
+{
+	Close();
+
+	int fileDescriptor = open(path.c_str(), O_RDONLY);
+	if (fileDescriptor == -1)
+		return false;
+
+	struct stat fileStats{};
+	if (fstat(fileDescriptor, &fileStats) != 0 || fileStats.st_size == 0)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	void* pView = mmap(nullptr, size_t(fileStats.st_size), PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+	if (pView == MAP_FAILED)
+	{
+		close(fileDescriptor);
+		return false;
+	}
+
+	m_FileDescriptor = fileDescriptor;
+	m_pData = static_cast<const uint8_t*>(pView);
+	m_Size = size_t(fileStats.st_size);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_pData)
+		munmap(const_cast<uint8_t*>(m_pData), m_Size);
+	if (m_FileDescriptor != -1)
+		close(m_FileDescriptor);
+
+	m_pData = nullptr;
+	m_Size = 0;
+	m_FileDescriptor = -1;
+}
+#endif
@@ -0,0 +1,43 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EMemoryMappedFile.h: Read-only view of a whole file mapped into memory.
+// Pages are only read from disk when they are first touched.
+/*=============================================================================*/
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace Elite
+{
+	class MemoryMappedFile final
+	{
+	public:
+		MemoryMappedFile() = default;
+		~MemoryMappedFile();
+
+		// Closes the previously opened file, returns false if the file can't be opened or is empty
+		bool Open(const std::string& path);
+		void Close();
+
+		bool IsOpen() const { return m_pData != nullptr; }
+		const uint8_t* GetData() const { return m_pData; }
+		size_t GetSize() const { return m_Size; }
+
+		//C++ make the class non-copyable
+		MemoryMappedFile(const MemoryMappedFile&) = delete;
+		MemoryMappedFile& operator=(const MemoryMappedFile&) = delete;
+
+	private:
+		const uint8_t* m_pData = nullptr;
+		size_t m_Size = 0;
+
+#ifdef _WIN32
+		void* m_hFile = nullptr;
+		void* m_hMapping = nullptr;
+#else
+		int m_FileDescriptor = -1;
+#endif
+	};
+}
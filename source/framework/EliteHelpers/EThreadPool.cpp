@@ -0,0 +1,105 @@
+#include "stdafx.h"
+#include "EThreadPool.h"
+
+using namespace Elite;
+
+ThreadPool::ThreadPool(unsigned int nrOfThreads)
+{
+	if (nrOfThreads == 0)
+	{
+		const unsigned int nrOfHardwareThreads = std::thread::hardware_concurrency();
+		nrOfThreads = nrOfHardwareThreads > 1 ? nrOfHardwareThreads - 1 : 1;
+	}
+
+	m_Threads.reserve(nrOfThreads);
+	for (unsigned int i = 0; i < nrOfThreads; ++i)
+		m_Threads.emplace_back(&ThreadPool::WorkerLoop, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_IsStopping = true;
+	}
+	m_TaskAvailable.notify_all();
+
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push(std::move(task));
+	}
+	m_TaskAvailable.notify_one();
+}
+
+void ThreadPool::ParallelFor(int count, int minRangeSize, const std::function<void(int, int)>& func)
+{
+	if (count <= 0)
+		return;
+
+	const int maxNrOfRanges = int(m_Threads.size()) + 1;
+	const int nrOfRanges = std::max(1, std::min(maxNrOfRanges, count / std::max(1, minRangeSize)));
+	if (nrOfRanges == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	// Shared with the tasks, a task can still be in the queue (and find no range left) after this call returned
+	struct State
+	{
+		std::atomic<int> nextRange{ 0 };
+		int nrOfRangesLeft;
+		std::mutex doneMutex;
+		std::condition_variable done;
+	};
+	auto pState = std::make_shared<State>();
+	pState->nrOfRangesLeft = nrOfRanges;
+
+	// Ranges are claimed by whoever gets to them first, the calling thread included, so it only ever runs ranges of this call
+	const int rangeSize = (count + nrOfRanges - 1) / nrOfRanges;
+	const std::function<void(int, int)>* pFunc = &func;
+	auto runRanges = [pState, pFunc, count, rangeSize, nrOfRanges]()
+	{
+		for (int range = pState->nextRange++; range < nrOfRanges; range = pState->nextRange++)
+		{
+			const int begin = range * rangeSize;
+			if (begin < count)
+				(*pFunc)(begin, std::min(count, begin + rangeSize));
+
+			std::lock_guard<std::mutex> lock(pState->doneMutex);
+			if (--pState->nrOfRangesLeft == 0)
+				pState->done.notify_one();
+		}
+	};
+
+	for (int range = 1; range < nrOfRanges; ++range)
+		Enqueue(runRanges);
+	runRanges();
+
+	std::unique_lock<std::mutex> lock(pState->doneMutex);
+	pState->done.wait(lock, [&pState]() { return pState->nrOfRangesLeft == 0; });
+}
+
+void ThreadPool::WorkerLoop()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_TaskAvailable.wait(lock, [this]() { return m_IsStopping || !m_Tasks.empty(); });
+			if (m_Tasks.empty())
+				return;
+
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop();
+		}
+		task();
+	}
+}
@@ -0,0 +1,48 @@
+/*=============================================================================*/
+// Copyright 2020-2021 Elite Engine
+/*=============================================================================*/
+// EThreadPool.h: Fixed set of worker threads that run queued tasks, and a parallel for on top of it.
+/*=============================================================================*/
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace Elite
+{
+	class ThreadPool final
+	{
+	public:
+		// 0 threads: one less than the hardware threads, as the thread calling ParallelFor takes a range itself
+		explicit ThreadPool(unsigned int nrOfThreads = 0);
+		~ThreadPool();
+
+		unsigned int GetNrOfThreads() const { return static_cast<unsigned int>(m_Threads.size()); }
+
+		// Runs the task on one of the worker threads
+		void Enqueue(std::function<void()> task);
+
+		// Calls func(begin, end) for ranges covering [0, count), ranges are at least minRangeSize long
+		// Returns once all ranges are done, the calling thread takes ranges as well but never runs other queued tasks
+		void ParallelFor(int count, int minRangeSize, const std::function<void(int, int)>& func);
+
+		//C++ make the class non-copyable
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+	private:
+		std::vector<std::thread> m_Threads;
+		std::queue<std::function<void()>> m_Tasks;
+		std::mutex m_Mutex;
+		std::condition_variable m_TaskAvailable;
+		bool m_IsStopping = false;
+
+		void WorkerLoop();
+	};
+}
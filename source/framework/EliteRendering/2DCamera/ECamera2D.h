@@ -19,6 +19,8 @@ public:
 
 	Elite::Vector2 ConvertScreenToWorld(const Elite::Vector2& screenPoint) const;
 	Elite::Vector2 ConvertWorldToScreen(const Elite::Vector2& worldPoint) const;
+	//Bottom left and top right corner of the view in world space
+	void GetWorldBounds(Elite::Vector2& lower, Elite::Vector2& upper) const;
 	void BuildProjectionMatrix(float* m, float zBias) const;
 	void SetZoom(float z) { m_zoom = z; }
 	void SetCenter(Elite::Vector2 c) { m_center = c; }
@@ -26,6 +28,7 @@ public:
 	void SetMoveLocked(bool state) { m_isMoveLocked = state; }
 	unsigned int GetWidth() const { return m_width; }
 	unsigned int GetHeight() const { return m_height; }
+	float GetZoom() const { return m_zoom; }
 
 private:
 	//--- Datamembers ---
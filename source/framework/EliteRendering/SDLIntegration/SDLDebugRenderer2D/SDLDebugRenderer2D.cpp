@@ -42,6 +42,18 @@ void SDLDebugRenderer2D::Initialize(Camera2D* pActiveCamera)
 	glVertexAttribPointer(m_sizeAttribute, 1, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, size)));
 	glEnableVertexAttribArray(m_sizeAttribute);
 
+	//Color grids: position and texture coordinate per vertex
+	m_colorGridProgramID = DEBUGRENDERER2D->LoadShadersToProgramFromEmbeddedSource(ColorGridVertexShaderSource, ColorGridFragmentShaderSource);
+	m_colorGridProjectionUniform = glGetUniformLocation(m_colorGridProgramID, "projectionMatrix");
+	glGenVertexArrays(1, &m_colorGridVaoId);
+	glGenBuffers(1, &m_colorGridBufferID);
+	glBindVertexArray(m_colorGridVaoId);
+	glBindBuffer(GL_ARRAY_BUFFER, m_colorGridBufferID);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), reinterpret_cast<void*>(0));
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), reinterpret_cast<void*>(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+
 	//Cleanup
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glBindVertexArray(0);
@@ -76,6 +88,36 @@ void SDLDebugRenderer2D::Render()
 	m_pActiveCamera->BuildProjectionMatrix(proj, 0.0f);
 	glUniformMatrix4fv(m_projectionUniform, 1, GL_FALSE, proj);
 
+	//Draw Color Grids, a quad each with their own program
+	if (!m_vColorGridDraws.empty())
+	{
+		glUseProgram(m_colorGridProgramID);
+		glUniformMatrix4fv(m_colorGridProjectionUniform, 1, GL_FALSE, proj);
+		glBindVertexArray(m_colorGridVaoId);
+		glBindBuffer(GL_ARRAY_BUFFER, m_colorGridBufferID);
+		glActiveTexture(GL_TEXTURE0);
+
+		for (const auto& draw : m_vColorGridDraws)
+		{
+			const float quad[4 * 5] =
+			{
+				draw.lower.x, draw.lower.y, draw.depth, 0.0f, 0.0f,
+				draw.upper.x, draw.lower.y, draw.depth, 1.0f, 0.0f,
+				draw.lower.x, draw.upper.y, draw.depth, 0.0f, 1.0f,
+				draw.upper.x, draw.upper.y, draw.depth, 1.0f, 1.0f
+			};
+			glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_DYNAMIC_DRAW);
+			glBindTexture(GL_TEXTURE_2D, m_ColorGrids[draw.id].textureID);
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		}
+		m_vColorGridDraws.clear();
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glUseProgram(m_programID);
+		glBindVertexArray(m_vaoId);
+		glBindBuffer(GL_ARRAY_BUFFER, m_bufferIDs[0]);
+	}
+
 	//Copy Data and Draw Lines
 	int size = m_vLines.size();
 	if (size > 0)
@@ -137,6 +179,17 @@ void SDLDebugRenderer2D::Shutdown()
 	glDeleteBuffers(1, m_bufferIDs);
 	glDeleteVertexArrays(1, &m_vaoId);
 	glDeleteProgram(m_programID);
+
+	for (const auto& grid : m_ColorGrids)
+	{
+		if (grid.textureID != 0)
+			glDeleteTextures(1, &grid.textureID);
+	}
+	m_ColorGrids.clear();
+	m_vColorGridDraws.clear();
+	glDeleteBuffers(1, &m_colorGridBufferID);
+	glDeleteVertexArrays(1, &m_colorGridVaoId);
+	glDeleteProgram(m_colorGridProgramID);
 }
 
 void SDLDebugRenderer2D::DrawPolygon(Elite::Polygon* polygon, const Color& color, float depth)
@@ -467,6 +520,89 @@ void SDLDebugRenderer2D::DrawString(const Elite::Vector2& pw, const char* string
 	style.Colors[ImGuiCol_WindowBg] = colorWindowBg;
 }
 
+void SDLDebugRenderer2D::DrawStrings(const Elite::Vector2* pPositions, const char* const* pStrings, int count) const
+{
+	if (!m_pActiveCamera || count <= 0)
+		return;
+
+	auto& style = ImGui::GetStyle();
+	auto colorWindowBg = style.Colors[ImGuiCol_WindowBg];
+	const auto initialAlpha = colorWindowBg.w;
+	colorWindowBg.w = 0.0f;
+	style.Colors[ImGuiCol_WindowBg] = colorWindowBg;
+
+	ImGui::Begin("Overlay", nullptr, ImGuiWindowFlags_NoTitleBar | ImGuiWindowFlags_NoInputs | ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoScrollbar
+		| ImGuiWindowFlags_NoSavedSettings);
+	ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(ImColor(230, 153, 153, 255)));
+	for (int i = 0; i < count; ++i)
+	{
+		const auto ps = m_pActiveCamera->ConvertWorldToScreen(pPositions[i]);
+		ImGui::SetCursorPos(ImVec2(float(ps.x), float(ps.y)));
+		ImGui::TextUnformatted(pStrings[i]);
+	}
+	ImGui::PopStyleColor();
+	ImGui::End();
+
+	//Reset alpha
+	colorWindowBg.w = initialAlpha;
+	style.Colors[ImGuiCol_WindowBg] = colorWindowBg;
+}
+
+int SDLDebugRenderer2D::CreateColorGrid(int columns, int rows, const Color* pColors)
+{
+	unsigned int textureID = 0;
+	glGenTextures(1, &textureID);
+	glBindTexture(GL_TEXTURE_2D, textureID);
+	//A texel per cell, no blending between cells
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, columns, rows, 0, GL_RGBA, GL_FLOAT, pColors);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	const ColorGrid grid{ textureID, columns, rows };
+	for (size_t id = 0; id < m_ColorGrids.size(); ++id)
+	{
+		if (m_ColorGrids[id].textureID == 0)
+		{
+			m_ColorGrids[id] = grid;
+			return int(id);
+		}
+	}
+	m_ColorGrids.push_back(grid);
+	return int(m_ColorGrids.size()) - 1;
+}
+
+void SDLDebugRenderer2D::UpdateColorGrid(int id, int column, int row, int width, int height, const Color* pColors)
+{
+	assert(id >= 0 && id < int(m_ColorGrids.size()) && m_ColorGrids[id].textureID != 0 && "<SDLDebugRenderer2D::UpdateColorGrid>: invalid id");
+	const ColorGrid& grid = m_ColorGrids[id];
+	assert(column >= 0 && row >= 0 && column + width <= grid.columns && row + height <= grid.rows && "<SDLDebugRenderer2D::UpdateColorGrid>: cells outside the grid");
+
+	glBindTexture(GL_TEXTURE_2D, grid.textureID);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, column, row, width, height, GL_RGBA, GL_FLOAT, pColors);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void SDLDebugRenderer2D::DeleteColorGrid(int id)
+{
+	assert(id >= 0 && id < int(m_ColorGrids.size()) && m_ColorGrids[id].textureID != 0 && "<SDLDebugRenderer2D::DeleteColorGrid>: invalid id");
+
+	//Not drawn anymore this frame
+	m_vColorGridDraws.erase(std::remove_if(m_vColorGridDraws.begin(), m_vColorGridDraws.end(),
+		[id](const ColorGridDraw& draw) { return draw.id == id; }), m_vColorGridDraws.end());
+
+	glDeleteTextures(1, &m_ColorGrids[id].textureID);
+	m_ColorGrids[id].textureID = 0;
+}
+
+void SDLDebugRenderer2D::DrawColorGrid(int id, const Elite::Vector2& lower, const Elite::Vector2& upper, float depth)
+{
+	assert(id >= 0 && id < int(m_ColorGrids.size()) && m_ColorGrids[id].textureID != 0 && "<SDLDebugRenderer2D::DrawColorGrid>: invalid id");
+	m_vColorGridDraws.push_back(ColorGridDraw{ id, lower, upper, depth });
+}
+
 inline float SDLDebugRenderer2D::NextDepthSlice()
 {
 	m_CurrDepthSlice -= DEPTH_SLICE_OFFSET;
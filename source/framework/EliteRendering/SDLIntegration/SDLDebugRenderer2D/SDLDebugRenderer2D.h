@@ -45,6 +45,15 @@ namespace Elite
 		void DrawPoint(const Elite::Vector2& p, float size, const Color& color, float depth = 0.9f);
 		void DrawString(int x, int y, const char* string, ...) const;
 		void DrawString(const Elite::Vector2& pw, const char* string, ...) const;
+		//All strings in one overlay window, pStrings[i] is drawn at world position pPositions[i]
+		void DrawStrings(const Elite::Vector2* pPositions, const char* const* pStrings, int count) const;
+		//Persistent grid of colored cells, drawn as one textured quad. pColors holds columns * rows colors, row by row starting at the bottom
+		int CreateColorGrid(int columns, int rows, const Color* pColors);
+		//Replaces the colors of a rectangle of cells, pColors holds width * height colors
+		void UpdateColorGrid(int id, int column, int row, int width, int height, const Color* pColors);
+		void DeleteColorGrid(int id);
+		//The grid is stretched over lower-upper (world space), only drawn in the frame it is called
+		void DrawColorGrid(int id, const Elite::Vector2& lower, const Elite::Vector2& upper, float depth);
 
 		inline float NextDepthSlice();
 
@@ -59,6 +68,27 @@ namespace Elite
 		unsigned int m_vaoId = 0;
 		unsigned int m_bufferIDs[1] = {};
 
+		//COLOR GRIDS (textured quads, a texel per cell)
+		struct ColorGrid
+		{
+			unsigned int textureID;
+			int columns;
+			int rows;
+		};
+		struct ColorGridDraw
+		{
+			int id;
+			Elite::Vector2 lower;
+			Elite::Vector2 upper;
+			float depth;
+		};
+		unsigned int m_colorGridProgramID = 0;
+		int m_colorGridProjectionUniform = 0;
+		unsigned int m_colorGridVaoId = 0;
+		unsigned int m_colorGridBufferID = 0;
+		std::vector<ColorGrid> m_ColorGrids; //textureID 0 == free slot
+		std::vector<ColorGridDraw> m_vColorGridDraws;
+
 		//Functions
 		void Shutdown();
 	};
@@ -52,4 +52,29 @@ static const char* ImGuiFragmentShaderSource =
 "// Output data\n"
 "out vec4 color;\n"
 "void main(void)\n"
-"{ color = f_color * texture(_texture, f_uv.st); }\n";
\ No newline at end of file
+"{ color = f_color * texture(_texture, f_uv.st); }\n";
+
+static const char* ColorGridVertexShaderSource =
+"#version 400\n"
+"// Input vertex data\n"
+"uniform mat4 projectionMatrix;\n"
+"layout(location = 0) in vec3 v_position;\n"
+"layout(location = 1) in vec2 v_uv;\n"
+"// Output vertex data\n"
+"out vec2 f_uv;\n"
+"void main(void)\n"
+"{\n"
+"	f_uv = v_uv;\n"
+"	gl_Position = projectionMatrix * vec4(v_position.xy, 0.0f, 1.0f);\n"
+"	gl_Position.z = v_position.z;\n"
+"}\n";
+
+static const char* ColorGridFragmentShaderSource =
+"#version 400\n"
+"// Input data\n"
+"uniform sampler2D _texture;\n"
+"in vec2 f_uv;\n"
+"// Output data\n"
+"out vec4 color;\n"
+"void main(void)\n"
+"{ color = texture(_texture, f_uv.st); }\n";
@@ -3,13 +3,14 @@
 
 //Includes
 #include "App_GraphTheory.h"
-#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EEularianPath.h"
 
 using namespace Elite;
 using namespace std;
 //Destructor
 App_GraphTheory::~App_GraphTheory()
 {
+	SAFE_DELETE(m_pGraphAnalytics);
+	SAFE_DELETE(m_pEulerianPath);
 	SAFE_DELETE(m_pGraph2D);
 }
 
@@ -24,43 +25,19 @@ void App_GraphTheory::Start()
 	DEBUGRENDERER2D->GetActiveCamera()->SetZoomLocked(false);
 
 	m_pGraph2D = new Graph2D<GraphNode2D, GraphConnection2D>(false);
-	m_pGraph2D->AddNode(new GraphNode2D(0, {20, 30}));
-	m_pGraph2D->AddNode(new GraphNode2D(1, {-10, -10}));
-	m_pGraph2D->AddConnection(new GraphConnection2D(0,1));
+	m_pGraph2D->AddNode(m_pGraph2D->AllocateNode(0, Elite::Vector2{ 20, 30 }));
+	m_pGraph2D->AddNode(m_pGraph2D->AllocateNode(1, Elite::Vector2{ -10, -10 }));
+	m_pGraph2D->AddConnection(m_pGraph2D->AllocateConnection(0, 1));
+
+	m_pEulerianPath = new EulerianPath<GraphNode2D, GraphConnection2D>(m_pGraph2D);
+	m_pGraphAnalytics = new GraphAnalytics<GraphNode2D, GraphConnection2D>(m_pGraph2D);
 
 }
 
 void App_GraphTheory::Update(float deltaTime)
 {
 	m_GraphEditor.UpdateGraph(m_pGraph2D);
-	m_pGraph2D->SetConnectionCostsToDistance();
-
-	auto eulerFinder = EulerianPath<GraphNode2D, GraphConnection2D>(m_pGraph2D);
-	auto eulerianity = eulerFinder.IsEulerian();
-
-	/*switch (eulerianity)
-	{
-	case Eulerianity::eulerian:
-		cout << "eulerian" << endl;
-		break;
-	case Eulerianity::semiEulerian:
-		cout << "semi eulerian" << endl;
-		break;
-	case Eulerianity::notEulerian:
-		cout << "not eulerian" << endl;
-	default:
-		break;
-	}*/
-
-	auto path = eulerFinder.FindPath(eulerianity);
-	
-	for (auto node : path)
-	{
-		std::cout << node->GetIndex() << " - ";
-	}
-
-	std::cout << endl;
-
+	UpdateDerivedData();
 
 	//------- UI --------
 #ifdef PLATFORM_WINDOWS
@@ -102,6 +79,34 @@ void App_GraphTheory::Update(float deltaTime)
 		ImGui::Spacing();
 		ImGui::Spacing();
 
+		switch (m_Eulerianity)
+		{
+		case Eulerianity::eulerian:
+			ImGui::Text("Eulerian");
+			break;
+		case Eulerianity::semiEulerian:
+			ImGui::Text("Semi eulerian");
+			break;
+		case Eulerianity::notEulerian:
+		default:
+			ImGui::Text("Not eulerian");
+			break;
+		}
+		ImGui::TextWrapped("%s", m_EulerianPathText.c_str());
+		ImGui::Text("Connected components: %d", m_pGraphAnalytics->GetNrOfComponents());
+		ImGui::Text("Graph version: %u", m_pGraph2D->GetVersion());
+
+		ImGui::Spacing();
+		if (ImGui::Button("Save"))
+			WriteGraphFile(m_GraphFilePath, *m_pGraph2D);
+		ImGui::SameLine();
+		if (ImGui::Button("Load"))
+		{
+			GraphFileView graphFile{};
+			if (graphFile.Open(m_GraphFilePath))
+				LoadGraphFile(graphFile, m_pGraph2D);
+		}
+
 		//End
 		ImGui::PopAllowKeyboardFocus();
 		ImGui::End();
@@ -112,6 +117,51 @@ void App_GraphTheory::Update(float deltaTime)
 
 }
 
+void App_GraphTheory::UpdateDerivedData()
+{
+	// Connection costs: only the connections of moved nodes and added connections
+	// The lists are taken out first, setting a cost marks that connection dirty again
+	m_pGraph2D->ClearDirtyFlags(m_DirtyNodes, m_DirtyConnections);
+
+	m_IsNodeRefreshed.assign(m_pGraph2D->GetNrOfNodes(), false);
+	for (int idx : m_DirtyNodes)
+	{
+		m_pGraph2D->SetConnectionCostsToDistance(idx);
+		if (idx < (int)m_IsNodeRefreshed.size())
+			m_IsNodeRefreshed[idx] = true;
+	}
+
+	// Every connection of a dirty node was already refreshed above
+	const auto isRefreshed = [this](int idx) { return idx < (int)m_IsNodeRefreshed.size() && m_IsNodeRefreshed[idx]; };
+	for (const auto& connection : m_DirtyConnections)
+	{
+		if (isRefreshed(connection.first) || isRefreshed(connection.second))
+			continue;
+		m_pGraph2D->SetConnectionCostToDistance(connection.first, connection.second);
+	}
+
+	// Only the refresh itself marked the graph since, nothing left to process
+	m_pGraph2D->ClearDirtyFlags();
+
+	// Eulerianity and the path only depend on which nodes are connected, not on positions or costs
+	if (m_pGraph2D->GetTopologyVersion() == m_EulerianTopologyVersion)
+		return;
+
+	m_Eulerianity = m_pEulerianPath->IsEulerian();
+
+	auto path = m_pEulerianPath->FindPath(m_Eulerianity);
+	stringstream pathText;
+	for (size_t i = 0; i < path.size(); ++i)
+	{
+		if (i > 0)
+			pathText << " - ";
+		pathText << path[i]->GetIndex();
+	}
+	m_EulerianPathText = pathText.str();
+
+	m_EulerianTopologyVersion = m_pGraph2D->GetTopologyVersion();
+}
+
 void App_GraphTheory::Render(float deltaTime) const
 {
 	m_GraphRenderer.RenderGraph(m_pGraph2D, true, true);
@@ -11,6 +11,9 @@
 #include "framework\EliteAI\EliteGraphs\EGraph2D.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphRenderer.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphEditor.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphFile.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EEularianPath.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EGraphAnalytics.h"
 
 
 //-----------------------------------------------------------------
@@ -29,10 +32,24 @@ public:
 	void Render(float deltaTime) const override;
 
 private:
-	Elite::Graph2D<Elite::GraphNode2D, Elite::GraphConnection2D>* m_pGraph2D;
+	Elite::Graph2D<Elite::GraphNode2D, Elite::GraphConnection2D>* m_pGraph2D = nullptr;
 
 	Elite::GraphEditor m_GraphEditor{};
 	Elite::GraphRenderer m_GraphRenderer{};
+	const std::string m_GraphFilePath{ "GraphTheory.egraph" };
+
+	// Results derived from the graph, only recomputed for what changed since the last frame
+	Elite::EulerianPath<Elite::GraphNode2D, Elite::GraphConnection2D>* m_pEulerianPath = nullptr;
+	unsigned int m_EulerianTopologyVersion = 0;
+	Elite::Eulerianity m_Eulerianity = Elite::Eulerianity::notEulerian;
+	std::string m_EulerianPathText;
+	Elite::GraphAnalytics<Elite::GraphNode2D, Elite::GraphConnection2D>* m_pGraphAnalytics = nullptr;
+	// Dirty lists taken from the graph each frame, kept to reuse their memory
+	std::vector<int> m_DirtyNodes;
+	std::vector<std::pair<int, int>> m_DirtyConnections;
+	std::vector<bool> m_IsNodeRefreshed;
+
+	void UpdateDerivedData();
 
 	//C++ make the class non-copyable
 	App_GraphTheory(const App_GraphTheory&) = delete;